@@ -36,6 +36,8 @@ class VermicelliPointLightSystem {
 
   void createPipeline(VkRenderPass renderPass);
 
+  void recordLights(const FrameInfo &frameInfo, VkCommandBuffer commandBuffer);
+
 public:
   explicit VermicelliPointLightSystem(VermicelliDevice &device, VkRenderPass renderPass,
                                       VkDescriptorSetLayout globalSetLayout, bool verbose);
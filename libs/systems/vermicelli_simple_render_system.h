@@ -21,21 +21,97 @@
 #include "vermicelli_game_object.h"
 #include "vermicelli_camera.h"
 #include "vermicelli_frame_info.h"
+#include "vermicelli_buffer.h"
+#include "vermicelli_frustum_culler.h"
+#include "vermicelli_gpu_culling.h"
+#include "vermicelli_occlusion_rasterizer.h"
+#include <array>
 #include <memory>
 #include <vector>
 
 namespace vermicelli {
 
 class VermicelliSimpleRenderSystem {
+  /// One instanced draw of a model at one LOD; its instances are objects[mFirstInstance, + mInstanceCount)
+  using Batch = VermicelliGpuCulling::Batch;
+
+  /// A secondary holding every static draw, kept until something recorded into it changes
+  struct StaticCommands {
+      VkCommandBuffer                   mCommandBuffer = VK_NULL_HANDLE;
+      std::unique_ptr<VermicelliBuffer> mInstances;    ///< Instance data of the static batches
+      size_t                            mKey           = 0;
+      bool                              mRecorded      = false;
+  };
+
   bool                                mVerbose;
   VermicelliDevice                    &mDevice;
   std::unique_ptr<VermicelliPipeline> mPipeline;
+  std::unique_ptr<VermicelliPipeline> mCompactPipeline; ///< Same shaders, specialized for CompactVertex input
   VkPipelineLayout                    mPipelineLayout;
+  float                               mLodBias = 0.0f;
+  std::vector<VermicelliGameObject *> mDrawList;   ///< Dynamic objects drawn this frame, kept to reuse its storage
+  std::vector<VermicelliGameObject *> mStaticList; ///< Static objects drawn this frame
+  std::vector<Batch>                  mBatches;
+  std::vector<Batch>                  mStaticBatches;
+  size_t                              mStaticKey = 0; ///< Identifies mStaticList and its LODs, see renderStatic
+  VkCommandPool                       mStaticPool = VK_NULL_HANDLE;
+  std::array<StaticCommands, VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT> mStaticCommands{};
+  std::unique_ptr<VermicelliGpuCulling>        mCulling;       ///< Set while indexed objects are culled on the GPU
+  std::vector<VermicelliGameObject *>          mCullList;      ///< Objects handed to mCulling, static or not
+  std::vector<glm::vec4>                       mCullSpheres;   ///< Bounds of mCullList, for occlusion tests
+  std::vector<uint32_t>                        mCullVisible;   ///< Indices into mCullList the occluders left
+  std::vector<Batch>                           mCullBatches;
+  std::vector<VermicelliSceneBuffer::Slot>     mCullInstances; ///< Scene slots of mCullList, as instances
+  VermicelliFrustumCuller                      mFrustumCuller; ///< Holds the bounds of mCandidates
+  std::vector<VermicelliGameObject *>          mCandidates;    ///< Objects drawn from the CPU if they survive culling
+  std::vector<uint32_t>                        mVisible;       ///< Indices into mCandidates that survived
+  std::vector<glm::vec4>                       mCandidateSpheres; ///< The bounds again, for occlusion tests
+  float                                        mMinPixels = 1.0f;
+
+  std::unique_ptr<VermicelliOcclusionRasterizer> mOcclusion; ///< Set while mCandidates are culled by occluders
 
   void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
 
   void createPipeline(VkRenderPass renderPass);
 
+  void createStaticCommandBuffers();
+
+  /**
+   * @brief Picks the coarsest level whose error, projected to pixels, stays under the threshold, moving at most
+   * through a hysteresis band around it so objects near a boundary do not flicker between levels
+   */
+  uint32_t selectLod(const FrameInfo &frameInfo, const VermicelliGameObject &obj, const glm::vec4 &sphere) const;
+
+  /**
+   * @brief Sorts objects by model and LOD and splits them into batches, whose instances are then contiguous in
+   * objects. LODs must have been selected.
+   */
+  static void buildBatches(std::vector<VermicelliGameObject *> &objects, std::vector<Batch> &batches);
+
+  /// Writes the InstanceData of batches[begin, end), indexed like objects; runs on any recording thread
+  static void writeInstances(const std::vector<VermicelliGameObject *> &objects, const std::vector<Batch> &batches,
+                             size_t begin, size_t end, void *instances);
+
+  /// Records batches[begin, end) into one secondary, reading instances from instanceBuffer at instanceOffset
+  void renderBatches(const FrameInfo &frameInfo, VkCommandBuffer commandBuffer, const std::vector<Batch> &batches,
+                     size_t begin, size_t end, VkBuffer instanceBuffer, VkDeviceSize instanceOffset);
+
+  /**
+   * @brief Executes the slot's recording of mStaticList, recording it again first if key, or anything else it baked
+   * in, differs from last time
+   * @param key Hash of the static objects' identity, model, LOD and scene slot
+   */
+  void renderStatic(const FrameInfo &frameInfo, size_t key);
+
+  /**
+   * @brief Rasterizes the occluders of what survived frustum culling, and of what GPU culling is given, and drops
+   * whatever they hide from both
+   */
+  void cullOccluded(const FrameInfo &frameInfo);
+
+  /// Records groups [begin, end) of what mCulling left into one secondary
+  void renderCulled(const FrameInfo &frameInfo, VkCommandBuffer commandBuffer, size_t begin, size_t end);
+
 public:
   explicit VermicelliSimpleRenderSystem(VermicelliDevice &device, VkRenderPass renderPass,
                                         VkDescriptorSetLayout globalSetLayout, bool verbose);
@@ -46,8 +122,74 @@ public:
 
   VermicelliSimpleRenderSystem &operator=(const VermicelliSimpleRenderSystem &) = delete;
 
+  /**
+   * @brief Gathers this frame's draws, picks their LODs and writes the scene records of objects that changed. Call
+   * before the scene buffer is flushed and the render pass begins.
+   */
+  void update(FrameInfo &frameInfo);
+
+  /**
+   * @brief Culls what update() gathered for the GPU path; call after the scene buffer is flushed and before the
+   * render pass begins. Does nothing unless GPU culling is on.
+   * @param pyramid Also culls what the last frame's depth hides, to be tested again by cullLate(), unless null
+   */
+  void cull(FrameInfo &frameInfo, const VermicelliDepthPyramid *pyramid = nullptr);
+
+  /**
+   * @brief Tests what cull() found hidden against pyramid, just rebuilt from this frame's depth; call after the render
+   * pass renderGameObjects() drew in has ended
+   */
+  void cullLate(FrameInfo &frameInfo, const VermicelliDepthPyramid &pyramid);
+
+  /**
+   * @brief Draws what update() gathered; call inside the swap chain render pass
+   */
   void renderGameObjects(FrameInfo &frameInfo);
 
+  /**
+   * @brief Draws what cullLate() found no longer hidden; call inside the resumed swap chain render pass
+   */
+  void renderLate(FrameInfo &frameInfo);
+
+  /**
+   * @brief Global LOD knob: every step of +1 doubles the on-screen error allowed (coarser), -1 halves it
+   */
+  void setLodBias(float bias) { mLodBias = bias; }
+
+  /**
+   * @brief Has indexed objects frustum culled by compute passes and drawn indirectly, instead of all being drawn from
+   * the CPU; static ones are then no longer prerecorded. Call before the first frame.
+   */
+  void setGpuCulling(bool enabled);
+
+  [[nodiscard]] bool isGpuCulling() const { return mCulling != nullptr; }
+
+  /**
+   * @brief Objects whose bounds project to fewer pixels across than this are skipped, whether culled on the CPU or
+   * the GPU; 0 draws everything in the frustum
+   */
+  void setMinPixelSize(float pixels) { mMinPixels = pixels; }
+
+  /**
+   * @brief Has every object also culled by the occluders of the models in view, rasterized on the CPU in update(),
+   * so it works with or without GPU culling and before anything is recorded. Only models with an occluder hide
+   * anything.
+   */
+  void setCpuOcclusion(bool enabled);
+
+  [[nodiscard]] bool isCpuOcclusion() const { return mOcclusion != nullptr; }
+
+  /// How many objects the CPU culled in the last update()
+  [[nodiscard]] const VermicelliFrustumCuller::Stats &cullStats() const { return mFrustumCuller.stats(); }
+
+  /// What the occluders hid in the last update(); CPU occlusion must be on
+  [[nodiscard]] const VermicelliOcclusionRasterizer::Stats &cpuOcclusionStats() const { return mOcclusion->stats(); }
+
+  /// What GPU culling did with a recent frame, once it has culled by occlusion; GPU culling must be on
+  [[nodiscard]] const VermicelliGpuCulling::OcclusionStats &occlusionStats() const {
+    return mCulling->occlusionStats();
+  }
+
 };
 
 }
@@ -19,7 +19,10 @@
 #include "vermicelli_device.h"
 #include "vermicelli_renderer.h"
 #include "vermicelli_game_object.h"
+#include "vermicelli_geometry_arena.h"
+#include "vermicelli_model_registry.h"
 #include "vermicelli_descriptors.h"
+#include "vermicelli_scene_buffer.h"
 #include <memory>
 #include <vector>
 
@@ -28,15 +31,24 @@ namespace vermicelli {
 class Application {
   VermicelliWindow                          mWindow{"Vermicelli", mDim};
   bool                                      mVerbose;
+  bool                                      mCompactVertices;
+  float                                     mLodBias;
+  bool                                      mGpuCulling;
+  bool                                      mOcclusionCulling; ///< Implies mGpuCulling
+  bool                                      mCpuOcclusion;     ///< Occluders rasterized on the CPU
   VermicelliDevice                          mDevice{mWindow, mVerbose};
   VermicelliRenderer                        mRenderer{mWindow, mDevice, mVerbose};
+  VermicelliGeometryArena                   mGeometry{mDevice, mVerbose};
+  VermicelliModelRegistry                   mModels{mGeometry, mVerbose};
   std::unique_ptr<VermicelliDescriptorPool> mGlobalPool{};
-  VermicelliGameObject::Map                 mGameObjects;
+  VermicelliSceneBuffer                     mScene{mDevice, VermicelliSceneBuffer::DEFAULT_CAPACITY, mVerbose};
+  VermicelliGameObject::Map                 mGameObjects; ///< Holds slots in mScene, so is destroyed first
 
   void loadGameObjects();
 
 public:
-  explicit Application(bool verbose);
+  explicit Application(bool verbose, bool compactVertices = false, float lodBias = 0.0f, bool gpuCulling = false,
+                       bool occlusionCulling = false, bool cpuOcclusion = false);
 
   ~Application();
 
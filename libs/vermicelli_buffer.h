@@ -23,6 +23,7 @@ public:
           uint32_t instanceCount,
           VkBufferUsageFlags usageFlags,
           VkMemoryPropertyFlags memoryPropertyFlags,
+          VermicelliMemoryAllocator::Category category,
           VkDeviceSize minOffsetAlignment = 1);
 
   ~VermicelliBuffer();
@@ -72,8 +73,8 @@ private:
 
   VermicelliDevice &vermicelliDevice;
   void             *mMapped = nullptr;
-  VkBuffer       mBuffer = VK_NULL_HANDLE;
-  VkDeviceMemory mMemory = VK_NULL_HANDLE;
+  VkBuffer                              mBuffer = VK_NULL_HANDLE;
+  VermicelliMemoryAllocator::Allocation mMemory{};
 
   VkDeviceSize          mBufferSize;
   uint32_t              mInstanceCount;
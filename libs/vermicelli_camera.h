@@ -15,6 +15,7 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 
 #include <glm/glm.hpp>
+#include <array>
 
 namespace vermicelli {
 
@@ -40,6 +41,12 @@ public:
   [[nodiscard]] const glm::mat4 &getView() const { return mViewMatrix; }
 
   [[nodiscard]] const glm::mat4 &getInverseView() const { return mInverseViewMatrix; }
+
+  /**
+   * @brief World-space planes of the view frustum, left, right, top, bottom, near and far. xyz is the unit normal,
+   * pointing inwards, and w the offset, so dot(xyz, p) + w is the signed distance of p from the plane.
+   */
+  [[nodiscard]] std::array<glm::vec4, 6> getFrustumPlanes() const;
 };
 
 }
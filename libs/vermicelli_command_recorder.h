@@ -0,0 +1,129 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Records secondary command buffers for the swap chain render pass across worker threads
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_COMMAND_RECORDER_H__
+#define __VERMICELLI_VERMICELLI_COMMAND_RECORDER_H__
+#pragma once
+
+#include "vermicelli_swap_chain.h"
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vermicelli {
+
+class VermicelliDevice;
+
+/**
+ * Every recording thread, the calling thread being the first, owns one command pool per frame in flight, so no pool
+ * is ever touched by two threads and a frame's secondaries are reset in bulk with their pool when the slot comes
+ * around again. record() splits a range of work items into contiguous chunks that any thread may pick up, records
+ * each chunk into its own secondary, and executes them in chunk order, so draw order is the same as recording
+ * serially. Secondaries inherit nothing but the render pass, so each chunk binds its own pipeline, descriptor sets
+ * and vertex buffers; the viewport and scissor are set for it.
+ */
+class VermicelliCommandRecorder {
+public:
+  /**
+   * @brief Records items [begin, end) into commandBuffer, which has begun and has the viewport and scissor set.
+   * Called concurrently for different ranges, so it may only write to state owned by those items.
+   */
+  using RecordFn = std::function<void(VkCommandBuffer commandBuffer, size_t begin, size_t end)>;
+
+  /**
+   * @param threadCount Recording threads including the caller, 0 for one per hardware thread
+   */
+  VermicelliCommandRecorder(VermicelliDevice &device, uint32_t threadCount = 0, bool verbose = false);
+
+  ~VermicelliCommandRecorder();
+
+  VermicelliCommandRecorder(const VermicelliCommandRecorder &) = delete;
+
+  VermicelliCommandRecorder &operator=(const VermicelliCommandRecorder &) = delete;
+
+  /**
+   * @brief Resets every pool of frameIndex. Call once the renderer has waited for the frame last recorded in it.
+   */
+  void beginFrame(int frameIndex);
+
+  /**
+   * @brief Sets the render pass instance the secondaries recorded from now on are executed in
+   */
+  void beginRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent);
+
+  /**
+   * @brief Records count items through fn in chunks of at least minChunk, spread across the threads, and executes
+   * the secondaries in primary. Small counts stay on the calling thread.
+   */
+  void record(VkCommandBuffer primary, size_t count, size_t minChunk, const RecordFn &fn);
+
+  /**
+   * @brief Begins commandBuffer as a secondary for the current render pass and sets the viewport and scissor
+   * @param reusable Leaves out the framebuffer and ONE_TIME_SUBMIT, so it can be executed again in later frames for
+   * any image of the swap chain, as long as renderPass() and extent() stay the same
+   */
+  void beginSecondary(VkCommandBuffer commandBuffer, bool reusable = false) const;
+
+  [[nodiscard]] VkRenderPass renderPass() const { return mInheritance.renderPass; }
+
+  [[nodiscard]] VkExtent2D extent() const { return mExtent; }
+
+  [[nodiscard]] uint32_t threadCount() const { return static_cast<uint32_t>(mThreads.size()); }
+
+private:
+  /// Command pools are externally synchronized, so each thread records from its own
+  struct ThreadState {
+      std::array<VkCommandPool, VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT>                mPools{};
+      std::array<std::vector<VkCommandBuffer>, VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT> mBuffers{};
+      std::array<size_t, VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT>                       mUsed{};
+  };
+
+  VermicelliDevice         &mDevice;
+  bool                     mVerbose;
+  std::vector<ThreadState> mThreads;   ///< [0] is the calling thread
+  std::vector<std::thread> mWorkers;   ///< Run mThreads[1..]
+  int                      mFrameIndex = 0;
+
+  VkCommandBufferInheritanceInfo mInheritance{};
+  VkExtent2D                     mExtent{};
+
+  /// The job being recorded; workers sleep until mGeneration moves past the last one they saw
+  std::mutex                   mMutex;
+  std::condition_variable      mWake;
+  std::condition_variable      mDone;
+  uint64_t                     mGeneration = 0;
+  bool                         mStopping   = false;
+  const RecordFn               *mJob       = nullptr;
+  size_t                       mCount      = 0;
+  size_t                       mChunkCount = 0;
+  std::atomic<size_t>          mNextChunk{0};
+  size_t                       mChunksDone = 0;
+  uint32_t                     mActive     = 0; ///< Workers inside recordChunks()
+  std::vector<VkCommandBuffer> mChunkBuffers;
+  std::exception_ptr           mError;
+
+  void workerLoop(uint32_t thread);
+
+  /// Takes chunks until there are none left
+  void recordChunks(uint32_t thread);
+
+  VkCommandBuffer acquireBuffer(ThreadState &state);
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_COMMAND_RECORDER_H__
@@ -0,0 +1,119 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Defers destroying GPU objects until the frames that may still use them have finished
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_DELETION_QUEUE_H__
+#define __VERMICELLI_VERMICELLI_DELETION_QUEUE_H__
+#pragma once
+
+#include "vermicelli_memory_allocator.h"
+#include "vermicelli_uploader.h"
+
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace vermicelli {
+
+class VermicelliDevice;
+
+class VermicelliDescriptorPool;
+
+/**
+ * Frames are numbered from 1 as the renderer begins them. Anything retired is stamped with the number of the frame
+ * being recorded, or of the last one submitted between frames, and with the newest upload ticket, since a copy into
+ * it may still be pending. It is destroyed once the device's frame timeline has passed that frame and the upload has
+ * landed. Frames finish in submission order, so the queue is drained from the front.
+ */
+class VermicelliDeletionQueue {
+public:
+  using Frame = uint64_t;
+
+  VermicelliDeletionQueue(VermicelliDevice &device, bool verbose = false);
+
+  /**
+   * @brief Destroys everything still queued; the GPU must be idle by then
+   */
+  ~VermicelliDeletionQueue();
+
+  VermicelliDeletionQueue(const VermicelliDeletionQueue &) = delete;
+
+  VermicelliDeletionQueue &operator=(const VermicelliDeletionQueue &) = delete;
+
+  /**
+   * @brief Runs deleter once the GPU is done with the current frame
+   */
+  void push(std::function<void()> deleter);
+
+  /**
+   * @brief Keeps object alive until the GPU is done with the current frame, for any owner of Vulkan objects such as
+   * VermicelliBuffer, VermicelliModel or VermicelliSwapChain
+   */
+  template<typename T>
+  void retire(std::shared_ptr<T> object) {
+    if (object) {
+      push([object]() mutable { object.reset(); });
+    }
+  }
+
+  template<typename T>
+  void retire(std::unique_ptr<T> object) { retire(std::shared_ptr<T>(std::move(object))); }
+
+  void destroyBuffer(VkBuffer buffer, VermicelliMemoryAllocator::Allocation memory);
+
+  void destroyImage(VkImage image, VkImageView view, VermicelliMemoryAllocator::Allocation memory);
+
+  void destroyPipeline(VkPipeline pipeline);
+
+  void destroyPipelineLayout(VkPipelineLayout layout);
+
+  /**
+   * @param pool Must outlive the queued free and have been created with FREE_DESCRIPTOR_SET
+   */
+  void freeDescriptorSets(const VermicelliDescriptorPool &pool, std::vector<VkDescriptorSet> sets);
+
+  /**
+   * @brief Called by the renderer as it starts recording frame; everything retired from now on waits for it
+   */
+  void beginFrame(Frame frame) { mCurrentFrame = frame; }
+
+  /**
+   * @brief Destroys everything whose frame the frame timeline has passed, without blocking
+   */
+  void collect();
+
+  /**
+   * @brief Destroys everything right away, for when the caller knows the GPU is idle
+   */
+  void flush();
+
+  [[nodiscard]] Frame currentFrame() const { return mCurrentFrame; }
+
+  [[nodiscard]] Frame completedFrame() const { return mCompletedFrame; }
+
+  [[nodiscard]] size_t size() const { return mEntries.size(); }
+
+private:
+  struct Entry {
+      Frame                      mFrame;
+      VermicelliUploader::Ticket mTicket;
+      std::function<void()>      mDeleter;
+  };
+
+  VermicelliDevice  &mDevice;
+  bool              mVerbose;
+  std::deque<Entry> mEntries{};
+  Frame             mCurrentFrame   = 0;
+  Frame             mCompletedFrame = 0;
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_DELETION_QUEUE_H__
@@ -0,0 +1,99 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Hierarchical-Z: the swap chain's depth reduced to a mip chain of farthest depths, for occlusion tests
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_DEPTH_PYRAMID_H__
+#define __VERMICELLI_VERMICELLI_DEPTH_PYRAMID_H__
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#include <glm/glm.hpp>
+#include "vermicelli_descriptors.h"
+#include "vermicelli_device.h"
+#include "vermicelli_pipeline.h"
+#include "vermicelli_swap_chain.h"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vermicelli {
+
+/**
+ * Level 0 is the largest power of two no bigger than the swap chain in each direction, and each texel of every level
+ * holds the farthest depth of the texels it covers in the level below, the depth attachment for level 0. Anything
+ * whose nearest depth is beyond the farthest one over its screen rectangle, at a level where that rectangle is at most
+ * two texels across, is hidden. The image stays in GENERAL, written level by level as storage and sampled whole.
+ *
+ * It belongs to one swap chain, whose depth images it reads, and goes with it; the renderer makes a new one when the
+ * swap chain is recreated.
+ */
+class VermicelliDepthPyramid {
+public:
+  VermicelliDepthPyramid(VermicelliDevice &device, VermicelliSwapChain &swapChain, bool verbose = false);
+
+  ~VermicelliDepthPyramid();
+
+  VermicelliDepthPyramid(const VermicelliDepthPyramid &) = delete;
+
+  VermicelliDepthPyramid &operator=(const VermicelliDepthPyramid &) = delete;
+
+  /**
+   * @brief Records the reduction of imageIndex's depth into every level, outside any render pass and after the depth
+   * has been stored. The depth attachment is back in its attachment layout afterwards, and the pyramid readable by
+   * compute shaders.
+   * @param viewProjection The view-projection the depth was rendered with, to test bounds against the pyramid with
+   */
+  void build(VkCommandBuffer commandBuffer, uint32_t imageIndex, const glm::mat4 &viewProjection);
+
+  /// Whether build() has been recorded since this pyramid was made; until then it holds nothing
+  [[nodiscard]] bool isBuilt() const { return mBuilt; }
+
+  /// Of the last build()
+  [[nodiscard]] const glm::mat4 &viewProjection() const { return mViewProjection; }
+
+  /// Every level, for a combined image sampler; read it with texelFetch
+  [[nodiscard]] VkDescriptorImageInfo descriptorInfo() const { return {mSampler, mView, VK_IMAGE_LAYOUT_GENERAL}; }
+
+  [[nodiscard]] VkExtent2D extent() const { return mExtent; }
+
+  [[nodiscard]] uint32_t levelCount() const { return static_cast<uint32_t>(mLevelViews.size()); }
+
+private:
+  VermicelliDevice                               &mDevice;
+  bool                                           mVerbose;
+  std::vector<VkImage>                           mDepthImages;
+  VkFormat                                       mDepthFormat;
+  VkExtent2D                                     mExtent;
+  VkImage                                        mImage = VK_NULL_HANDLE;
+  VermicelliMemoryAllocator::Allocation          mMemory{};
+  VkImageView                                    mView = VK_NULL_HANDLE;
+  std::vector<VkImageView>                       mLevelViews;
+  VkSampler                                      mSampler = VK_NULL_HANDLE;
+  std::unique_ptr<VermicelliDescriptorSetLayout> mSetLayout;
+  std::unique_ptr<VermicelliDescriptorPool>      mPool;
+  std::vector<VkDescriptorSet>                   mDepthSets; ///< Level 0 from each swap chain depth image
+  std::vector<VkDescriptorSet>                   mLevelSets; ///< Level i + 1 from level i
+  VkPipelineLayout                               mPipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<VermicelliComputePipeline>     mReduce;
+  glm::mat4                                      mViewProjection{1.0f};
+  bool                                           mBuilt = false;
+
+  void createImage();
+
+  void createDescriptorSets(VermicelliSwapChain &swapChain);
+
+  void createPipeline();
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_DEPTH_PYRAMID_H__
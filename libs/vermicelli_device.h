@@ -10,12 +10,20 @@
 #define __VERMICELLI_VERMICELLI_DEVICE_H__
 
 #include "vermicelli_window.h"
+#include "vermicelli_memory_allocator.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace vermicelli {
 
+class VermicelliUploader;
+
+class VermicelliDeletionQueue;
+
+class VermicelliFrameTimeline;
+
 struct SwapChainSupportDetails {
     VkSurfaceCapabilitiesKHR        mCapabilities;
     std::vector<VkSurfaceFormatKHR> mFormats;
@@ -25,8 +33,10 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
     uint32_t mGraphicsFamily;
     uint32_t mPresentFamily;
+    uint32_t mTransferFamily;
     bool     mGraphicsFamilyHasValue = false;
     bool     mPresentFamilyHasValue  = false;
+    bool     mTransferFamilyHasValue = false; ///< Only set for a family without graphics; uploads use graphics otherwise
 
     [[nodiscard]] bool isComplete() const { return mGraphicsFamilyHasValue && mPresentFamilyHasValue; }
 };
@@ -67,11 +77,25 @@ class VermicelliDevice {
   VermicelliWindow         &mWindow;
   VkCommandPool            mCommandPool;
   bool                     mVerbose;
+  bool                     mProperties2  = false; ///< VK_KHR_get_physical_device_properties2 is enabled
+  bool                     mMemoryBudget = false; ///< VK_EXT_memory_budget is enabled
+  bool                     mTimelineSemaphores = false; ///< VK_KHR_timeline_semaphore and its feature are enabled
+  bool                     mDrawIndirectCountExtension = false; ///< VK_KHR_draw_indirect_count is enabled
+  bool                     mMultiDrawIndirect          = false; ///< The multiDrawIndirect feature is enabled
+  bool                     mDrawIndirectFirstInstance  = false; ///< The drawIndirectFirstInstance feature is enabled
+
+  PFN_vkCmdDrawIndexedIndirectCountKHR mDrawIndexedIndirectCount = nullptr;
 
   VkDevice     mDevice_;
   VkSurfaceKHR mSurface_;
+
+  std::unique_ptr<VermicelliMemoryAllocator> mAllocator;
+  std::unique_ptr<VermicelliUploader>        mUploader;
+  std::unique_ptr<VermicelliDeletionQueue>   mDeletionQueue;
+  std::unique_ptr<VermicelliFrameTimeline>   mFrameTimeline;
   VkQueue      mGraphicsQueue_;
   VkQueue      mPresentQueue_;
+  VkQueue      mTransferQueue_;
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
   const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
@@ -105,10 +129,37 @@ public:
 
   VkQueue presentQueue() { return mPresentQueue_; }
 
+  /// The graphics queue when there is no separate transfer family
+  VkQueue transferQueue() { return mTransferQueue_; }
+
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(mPhysicalDevice); }
 
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
+  VermicelliMemoryAllocator &allocator() { return *mAllocator; }
+
+  VermicelliUploader &uploader() { return *mUploader; }
+
+  /// Where anything a frame in flight might still use goes instead of being destroyed
+  VermicelliDeletionQueue &deletionQueue() { return *mDeletionQueue; }
+
+  /// Reaches frame number N once frame N has finished on the GPU
+  VermicelliFrameTimeline &frameTimeline() { return *mFrameTimeline; }
+
+  /// Whether VK_KHR_timeline_semaphore and its feature are enabled, for VermicelliFrameTimeline
+  [[nodiscard]] bool timelineSemaphores() const { return mTimelineSemaphores; }
+
+  /// Whether indirect draws may read more than one command per call
+  [[nodiscard]] bool multiDrawIndirect() const { return mMultiDrawIndirect; }
+
+  /// Whether indirect draws may start at an instance other than 0
+  [[nodiscard]] bool drawIndirectFirstInstance() const { return mDrawIndirectFirstInstance; }
+
+  /// vkCmdDrawIndexedIndirectCountKHR, or nullptr if the device does not have VK_KHR_draw_indirect_count
+  [[nodiscard]] PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount() const {
+    return mDrawIndexedIndirectCount;
+  }
+
   QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(mPhysicalDevice); }
 
   VkFormat findSupportedFormat(
@@ -120,13 +171,15 @@ public:
           VkBufferUsageFlags usage,
           VkMemoryPropertyFlags properties,
           VkBuffer &buffer,
-          VkDeviceMemory &bufferMemory);
+          VermicelliMemoryAllocator::Allocation &bufferMemory,
+          VermicelliMemoryAllocator::Category category);
 
   VkCommandBuffer beginSingleTimeCommands();
 
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 
-  void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+  void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0,
+                  VkDeviceSize dstOffset = 0);
 
   void copyBufferToImage(
           VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
@@ -135,7 +188,8 @@ public:
           const VkImageCreateInfo &imageInfo,
           VkMemoryPropertyFlags properties,
           VkImage &image,
-          VkDeviceMemory &imageMemory);
+          VermicelliMemoryAllocator::Allocation &imageMemory,
+          VermicelliMemoryAllocator::Category category);
 
   VkPhysicalDeviceProperties mProperties;
 };
@@ -0,0 +1,112 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Linear allocator for data that only lives for one frame, backed by one persistently mapped buffer
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_FRAME_ALLOCATOR_H__
+#define __VERMICELLI_VERMICELLI_FRAME_ALLOCATOR_H__
+#pragma once
+
+#include "vermicelli_buffer.h"
+#include "vermicelli_swap_chain.h"
+
+#include <cstring>
+#include <memory>
+
+namespace vermicelli {
+
+/**
+ * The buffer is split into MAX_FRAMES_IN_FLIGHT equal partitions. beginFrame() rewinds the partition of the frame
+ * being recorded, whose previous contents the GPU is done with once the renderer has waited for the frame last
+ * recorded in that slot, and every allocation after it is a bump of the partition's head. Offsets are relative to the
+ * start of the whole buffer, so one descriptor with a dynamic offset, or one vertex buffer binding with an offset,
+ * covers every frame.
+ */
+class VermicelliFrameAllocator {
+public:
+  static constexpr VkDeviceSize DEFAULT_FRAME_SIZE = 4 << 20;
+
+  /// Decides the alignment of an allocation, which differs between the ways the buffer can be bound
+  enum class Usage {
+      UNIFORM,
+      STORAGE,
+      VERTEX,  ///< Vertex and index data
+      TRANSFER ///< Source of copies into device-local buffers
+  };
+
+  struct Allocation {
+      void         *mData   = nullptr;
+      VkDeviceSize mOffset = 0;
+      VkDeviceSize mSize   = 0;
+
+      /// For vkCmdBindDescriptorSets with a dynamic uniform or storage buffer descriptor
+      [[nodiscard]] uint32_t dynamicOffset() const { return static_cast<uint32_t>(mOffset); }
+  };
+
+  VermicelliFrameAllocator(VermicelliDevice &device, VkDeviceSize frameSize = DEFAULT_FRAME_SIZE,
+                           bool verbose = false);
+
+  VermicelliFrameAllocator(const VermicelliFrameAllocator &) = delete;
+
+  VermicelliFrameAllocator &operator=(const VermicelliFrameAllocator &) = delete;
+
+  /**
+   * @brief Discards everything allocated the last time frameIndex was recorded. Call after the renderer has begun
+   * the frame, which guarantees the GPU no longer reads that partition.
+   */
+  void beginFrame(int frameIndex);
+
+  /**
+   * @brief Reserves size bytes in the current frame's partition, aligned for usage. The memory is write-only from
+   * the host's point of view and must be filled before flush().
+   */
+  Allocation allocate(VkDeviceSize size, Usage usage);
+
+  /**
+   * @brief Allocates room for value and copies it in
+   */
+  template<typename T>
+  Allocation push(const T &value, Usage usage) {
+    Allocation allocation = allocate(sizeof(T), usage);
+    std::memcpy(allocation.mData, &value, sizeof(T));
+    return allocation;
+  }
+
+  /**
+   * @brief Makes everything written this frame visible to the device; call once before submitting the frame
+   */
+  void flush();
+
+  /**
+   * @brief Describes the first range bytes of the buffer, for a dynamic descriptor that is then offset per draw
+   */
+  [[nodiscard]] VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) const;
+
+  [[nodiscard]] VkBuffer buffer() const { return mBuffer->getBuffer(); }
+
+  [[nodiscard]] VkDeviceSize frameSize() const { return mFrameSize; }
+
+  /// Bytes allocated in the current frame so far
+  [[nodiscard]] VkDeviceSize used() const { return mHead; }
+
+  /// Most bytes any frame has needed, for sizing the partitions
+  [[nodiscard]] VkDeviceSize peakUsed() const { return mPeakUsed; }
+
+private:
+  bool                              mVerbose;
+  VkDeviceSize                      mFrameSize;
+  VkDeviceSize                      mUniformAlignment;
+  VkDeviceSize                      mStorageAlignment;
+  std::unique_ptr<VermicelliBuffer> mBuffer;
+  VkDeviceSize                      mFrameBase = 0;
+  VkDeviceSize                      mHead      = 0;
+  VkDeviceSize                      mPeakUsed  = 0;
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_FRAME_ALLOCATOR_H__
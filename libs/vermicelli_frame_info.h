@@ -12,7 +12,10 @@
 #pragma once
 
 #include "vermicelli_camera.h"
+#include "vermicelli_command_recorder.h"
+#include "vermicelli_frame_allocator.h"
 #include "vermicelli_game_object.h"
+#include "vermicelli_scene_buffer.h"
 #include <vulkan/vulkan.h>
 
 namespace vermicelli {
@@ -27,10 +30,15 @@ struct PointLight {
 struct FrameInfo {
     int                       mFrameIndex;
     float                     mFrameTime;
-    VkCommandBuffer           mCommandBuffer;
+    VkCommandBuffer           mCommandBuffer;       ///< Primary; inside the render pass, draws go through mRecorder
+    VermicelliCommandRecorder &mRecorder;
     VermicelliCamera          &mCamera;
-    VkDescriptorSet           mGlobalDescriptorSet;
+    VkDescriptorSet           mGlobalDescriptorSet; ///< Its uniform buffer is dynamic, bind with mGlobalUboOffset
+    uint32_t                  mGlobalUboOffset;
+    VermicelliFrameAllocator  &mFrameAllocator;     ///< For anything else streamed to the GPU this frame
     VermicelliGameObject::Map &mGameObjects;
+    VermicelliSceneBuffer     &mScene;              ///< Bound at binding 1 of the global set
+    VkExtent2D                mExtent; ///< Size of the render target, for anything measured in pixels
 };
 
 struct GlobalUbo {
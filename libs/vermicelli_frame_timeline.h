@@ -0,0 +1,91 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   One increasing counter the GPU advances as frames finish, for asking whether frame N is done
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_FRAME_TIMELINE_H__
+#define __VERMICELLI_VERMICELLI_FRAME_TIMELINE_H__
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace vermicelli {
+
+class VermicelliDevice;
+
+/**
+ * Every frame submission signals the timeline with its frame number, so anything that remembers the frame it was
+ * last used in can ask whether the GPU has passed it, or wait for it, without its own fence. With
+ * VK_KHR_timeline_semaphore this is a single timeline semaphore. Without it, the same interface is kept with one
+ * fence per submission still in flight, recycled as the counter advances. The acquire and present semaphores stay
+ * binary either way, since presentation cannot wait on a timeline.
+ *
+ * Nothing in it is specific to frames: VermicelliUploader keeps one of its own, counting batches, since its values
+ * are not frame numbers and one semaphore's values have to increase in the order they are signalled.
+ */
+class VermicelliFrameTimeline {
+public:
+  using Value = uint64_t;
+
+  /**
+   * @param timelineSemaphores Whether VK_KHR_timeline_semaphore and its feature are enabled on the device
+   */
+  VermicelliFrameTimeline(VermicelliDevice &device, bool timelineSemaphores, bool verbose = false);
+
+  ~VermicelliFrameTimeline();
+
+  VermicelliFrameTimeline(const VermicelliFrameTimeline &) = delete;
+
+  VermicelliFrameTimeline &operator=(const VermicelliFrameTimeline &) = delete;
+
+  /**
+   * @brief Submits submitInfo to queue and has the timeline reach value once it has executed. Values must increase
+   * from one submission to the next.
+   */
+  void submit(VkQueue queue, const VkSubmitInfo &submitInfo, Value value);
+
+  /**
+   * @brief Highest value the GPU is known to have reached, without blocking
+   */
+  [[nodiscard]] Value completedValue();
+
+  [[nodiscard]] bool isComplete(Value value) { return value <= mCompleted || value <= completedValue(); }
+
+  /**
+   * @brief Blocks until the timeline reaches value, which must already have been submitted
+   */
+  void wait(Value value);
+
+  [[nodiscard]] Value lastSubmitted() const { return mSubmitted; }
+
+  [[nodiscard]] bool usesTimelineSemaphore() const { return mSemaphore != VK_NULL_HANDLE; }
+
+private:
+  struct PendingFence {
+      Value   mValue;
+      VkFence mFence;
+  };
+
+  VermicelliDevice                  &mDevice;
+  bool                              mVerbose;
+  VkSemaphore                       mSemaphore       = VK_NULL_HANDLE;
+  PFN_vkWaitSemaphoresKHR           mWaitSemaphores  = nullptr;
+  PFN_vkGetSemaphoreCounterValueKHR mGetCounterValue = nullptr;
+  Value                             mCompleted       = 0;
+  Value                             mSubmitted       = 0;
+  std::deque<PendingFence>          mPending{};     ///< Fallback only, oldest first
+  std::vector<VkFence>              mFreeFences{};  ///< Fallback only
+
+  void retire(const PendingFence &pending);
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_FRAME_TIMELINE_H__
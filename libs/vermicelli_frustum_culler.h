@@ -0,0 +1,103 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Frustum and small-feature culling of bounding spheres on the CPU, several at a time
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_FRUSTUM_CULLER_H__
+#define __VERMICELLI_VERMICELLI_FRUSTUM_CULLER_H__
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#include <glm/glm.hpp>
+#include "vermicelli_camera.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace vermicelli {
+
+/**
+ * Spheres are added one by one and kept as separate x, y, z and radius arrays, so cull() tests eight of them per
+ * instruction with AVX2 or four with SSE, whichever the CPU running it has, against every plane of the frustum. A
+ * sphere that survives is still dropped if its projected diameter is under View::mMinPixels, since objects that small
+ * cost a draw and show as a pixel at most. The indices that survive are in the order the spheres were added.
+ */
+class VermicelliFrustumCuller {
+public:
+  enum class Path {
+      SCALAR,
+      SSE,  ///< Four spheres per instruction, always there on x86-64
+      AVX2  ///< Eight spheres per instruction
+  };
+
+  /// What the spheres are tested against
+  struct View {
+      std::array<glm::vec4, 6> mPlanes;        ///< See VermicelliCamera::getFrustumPlanes()
+      glm::vec4                mDepthPlane;    ///< View-space depth as a plane, the view matrix's third row
+      float                    mPixelsPerUnit; ///< Pixels one world unit covers at a depth of 1
+      float                    mMinPixels;     ///< Smallest projected diameter kept, 0 to keep everything
+
+      /**
+       * @brief The camera's frustum, with pixels measured against height, the height of the render target
+       */
+      static View fromCamera(const VermicelliCamera &camera, uint32_t height, float minPixels);
+  };
+
+  /// Counts of the last cull()
+  struct Stats {
+      uint32_t mTested        = 0;
+      uint32_t mFrustumCulled = 0; ///< Entirely outside a plane
+      uint32_t mSmallCulled   = 0; ///< In the frustum, but smaller than View::mMinPixels
+      uint32_t mVisible       = 0;
+      float    mMilliseconds  = 0.0f;
+  };
+
+  explicit VermicelliFrustumCuller(Path path = bestPath());
+
+  /// The widest path this CPU runs
+  static Path bestPath();
+
+  static const char *pathName(Path path);
+
+  void clear();
+
+  /**
+   * @brief Adds a world-space sphere, center in xyz and radius in w; its index is the number added before it
+   */
+  void add(const glm::vec4 &sphere);
+
+  [[nodiscard]] size_t size() const { return mRadius.size(); }
+
+  /**
+   * @brief Replaces visible with the indices of the spheres that survive view
+   */
+  const Stats &cull(const View &view, std::vector<uint32_t> &visible);
+
+  [[nodiscard]] const Stats &stats() const { return mStats; }
+
+  [[nodiscard]] Path path() const { return mPath; }
+
+  /**
+   * @brief Times every path this CPU runs on objectCount random spheres around a camera and prints the results
+   */
+  static void benchmark(uint32_t objectCount);
+
+private:
+  Path               mPath;
+  std::vector<float> mX;
+  std::vector<float> mY;
+  std::vector<float> mZ;
+  std::vector<float> mRadius;
+  Stats              mStats{};
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_FRUSTUM_CULLER_H__
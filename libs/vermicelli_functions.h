@@ -18,6 +18,7 @@
 #include <glm/gtc/constants.hpp> // PI
 #include <iostream>
 #include <functional>
+#include <cstring>
 
 namespace vermicelli {
 namespace color {
@@ -62,6 +63,47 @@ void hashCombine(std::size_t &seed, const T &v, const Rest &... rest) {
   (hashCombine(seed, rest), ...);
 }
 
+/**
+ * @brief Folds the full 128-bit product of two words back down to 64 bits. This is the mixing step of hashBytes.
+ */
+inline uint64_t hashMix(uint64_t a, uint64_t b) {
+  __uint128_t product = static_cast<__uint128_t>(a) * b;
+  return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+}
+
+/**
+ * @brief Fast non-cryptographic hash over raw bytes, consuming 16 bytes per multiply. Used for file fingerprints and
+ * for hashing plain-old-data keys such as vertices.
+ * @param data Pointer to the bytes to hash
+ * @param size Number of bytes
+ * @param seed (Optional) Seed to start from
+ * @return 64-bit hash of the bytes
+ */
+inline uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 0) {
+  constexpr uint64_t prime0 = 0xa0761d6478bd642full;
+  constexpr uint64_t prime1 = 0xe7037ed1a0b428dbull;
+  constexpr uint64_t prime2 = 0x8ebc6af09c88c6e3ull;
+
+  auto     *bytes = static_cast<const uint8_t *>(data);
+  uint64_t hash   = seed ^ hashMix(size ^ prime0, prime1);
+  uint64_t a, b;
+  while (size >= 16) {
+    std::memcpy(&a, bytes, 8);
+    std::memcpy(&b, bytes + 8, 8);
+    hash = hashMix(a ^ prime1, b ^ hash);
+    bytes += 16;
+    size -= 16;
+  }
+  a = b = 0;
+  if (size >= 8) {
+    std::memcpy(&a, bytes, 8);
+    std::memcpy(&b, bytes + size - 8, 8);
+  } else if (size > 0) {
+    std::memcpy(&a, bytes, size);
+  }
+  return hashMix(hashMix(a ^ prime2, b ^ hash), size ^ prime0);
+}
+
 }
 
 #endif //__VERMICELLI_VERMICELLI_FUNCTIONS_H__
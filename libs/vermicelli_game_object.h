@@ -19,13 +19,15 @@
 
 namespace vermicelli {
 
+class VermicelliSceneBuffer;
+
 struct TransformComponent {
     glm::vec3 mTranslation{}; ///< Position Offset
     glm::vec3 mScale{1.0f, 1.0f, 1.0f}; ///< Object scale
     glm::vec3 mRotation{}; ///< Object rotation
-    glm::mat4 mat4();
+    glm::mat4 mat4() const;
 
-    glm::mat3 normalMatrix();
+    glm::mat3 normalMatrix() const;
 };
 
 struct VermicelliPointLightComponent {
@@ -54,17 +56,34 @@ public:
 
   id_t getID() const { return mID; }
 
+  /**
+   * @brief Gives the object a slot of scene for its record, which it hands back when it is destroyed
+   */
+  void acquireSceneSlot(VermicelliSceneBuffer &scene);
+
   glm::vec3          mColor{};
   TransformComponent mTransform{};
+  uint32_t           mLod    = 0; ///< Level of detail drawn last frame, so LOD switches can lag a little
+  bool               mStatic = false; ///< Rarely changes, so its draw can be recorded once and replayed
+  uint32_t           mSceneSlot  = UINT32_MAX; ///< Its record in VermicelliSceneBuffer, once it has been drawn
+  bool               mSceneDirty = true;       ///< Set after changing the transform or model, to upload its record
 
   // Optional pointer components;
   std::shared_ptr<VermicelliModel>               mModel{};
   std::unique_ptr<VermicelliPointLightComponent> mPointLight = nullptr;
 
 private:
+  /// Releases mSlot when the owning pointer goes, which moves leave with the object they move to
+  struct SceneSlotRelease {
+      uint32_t mSlot;
+
+      void operator()(VermicelliSceneBuffer *scene) const;
+  };
+
   explicit VermicelliGameObject(id_t objID) : mID{objID} {}
 
-  id_t mID;
+  id_t                                                      mID;
+  std::unique_ptr<VermicelliSceneBuffer, SceneSlotRelease> mSceneSlotOwner{nullptr, SceneSlotRelease{UINT32_MAX}};
 };
 }
 
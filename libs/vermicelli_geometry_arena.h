@@ -0,0 +1,177 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Shared device-local vertex and index buffers that every model suballocates from
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_GEOMETRY_ARENA_H__
+#define __VERMICELLI_VERMICELLI_GEOMETRY_ARENA_H__
+#pragma once
+
+#include "vermicelli_buffer.h"
+#include "vermicelli_model.h"
+#include "vermicelli_uploader.h"
+
+#include <memory>
+#include <vector>
+
+namespace vermicelli {
+
+/**
+ * All model geometry lives in one vertex buffer per vertex format and one index buffer per index type, so a render
+ * system only rebinds when the format or index type changes. Models hold handles rather than offsets: growing or
+ * compacting a pool moves ranges around, and the current offset is looked up through the handle when drawing.
+ */
+class VermicelliGeometryArena {
+public:
+  using Handle = uint32_t;
+  static constexpr Handle INVALID_HANDLE = UINT32_MAX;
+
+  /**
+   * One device-local buffer carved into ranges of whole elements. Free space is kept as a sorted, coalesced list and
+   * allocated first fit. When nothing fits, the pool moves to a new buffer with every live range packed to the
+   * front, doubling the capacity if packing alone would not make room. The copy itself is only queued and recorded at
+   * the start of the next frame by recordCopies, so allocations that relocate the pool belong between frames.
+   */
+  class Pool {
+  public:
+    Pool(VermicelliDevice &device, uint32_t elementSize, VkBufferUsageFlags usage, const char *name, bool verbose);
+
+    Pool(const Pool &) = delete;
+
+    Pool &operator=(const Pool &) = delete;
+
+    /**
+     * @brief Reserves count elements and queues their upload from data
+     * @param ticket Receives the upload's ticket; the range must not be drawn before it completes
+     */
+    Handle allocate(const void *data, uint32_t count, VermicelliUploader::Ticket &ticket);
+
+    void free(Handle handle);
+
+    /**
+     * @brief Packs all live ranges to the front of a buffer of the same capacity, merging the free space into one
+     * range at the end. Like growing, the copy is queued for the next recordCopies.
+     */
+    void compact();
+
+    /**
+     * @brief Records the copies queued by relocations since the last call, oldest first, and retires the buffers
+     * they read from. Uploads into those buffers are submitted ahead of commandBuffer, which must be the frame
+     * currently being recorded and must not have drawn from the pool yet.
+     * @return Whether anything was recorded
+     */
+    bool recordCopies(VkCommandBuffer commandBuffer);
+
+    /// First element of the range; changes whenever the pool grows or compacts
+    [[nodiscard]] uint32_t offset(Handle handle) const { return mRanges[handle].mOffset; }
+
+    [[nodiscard]] uint32_t count(Handle handle) const { return mRanges[handle].mCount; }
+
+    [[nodiscard]] VkBuffer buffer() const { return mBuffer ? mBuffer->getBuffer() : VK_NULL_HANDLE; }
+
+    [[nodiscard]] uint32_t used() const { return mUsed; }
+
+    [[nodiscard]] uint32_t capacity() const { return mCapacity; }
+
+    /// Free elements between live ranges, which only compacting gets back for large allocations
+    [[nodiscard]] uint32_t holes() const;
+
+    /// Times the pool moved to a new buffer, so anything that baked in its buffer or offsets can tell it is stale
+    [[nodiscard]] uint32_t relocations() const { return mRelocations; }
+
+  private:
+    struct Range {
+        uint32_t mOffset;
+        uint32_t mCount;
+    };
+
+    /// A relocation waiting for a frame to copy it; mDestination is the next copy's source or the current mBuffer
+    struct PendingCopy {
+        std::unique_ptr<VermicelliBuffer> mSource;
+        VkBuffer                          mDestination;
+        std::vector<VkBufferCopy>         mRegions;
+    };
+
+    /// Pools start out with room for this many bytes so small scenes never relocate
+    static constexpr uint32_t INITIAL_BYTES = 8 << 20;
+
+    VermicelliDevice                  &mDevice;
+    uint32_t                          mElementSize;
+    VkBufferUsageFlags                mUsage;
+    const char                        *mName;
+    bool                              mVerbose;
+    std::unique_ptr<VermicelliBuffer> mBuffer;
+    uint32_t                          mCapacity    = 0;
+    uint32_t                          mUsed        = 0;
+    uint32_t                          mRelocations = 0;
+    VermicelliUploader::Ticket        mLastTicket  = 0;  ///< Newest upload into any of the pool's buffers
+    std::vector<Range>                mRanges{};      ///< Indexed by handle; mCount 0 marks a recycled handle
+    std::vector<Handle>               mFreeHandles{};
+    std::vector<Range>                mFreeList{};    ///< Sorted by offset, neighbours always merged
+    std::vector<PendingCopy>          mPendingCopies{};
+
+    bool tryAllocate(uint32_t count, uint32_t &offset);
+
+    /**
+     * @brief Moves every live range, in order and without gaps, into a new buffer of the given capacity and queues
+     * the copy from the old one
+     */
+    void relocate(uint32_t capacity);
+  };
+
+  explicit VermicelliGeometryArena(VermicelliDevice &device, bool verbose = false);
+
+  VermicelliGeometryArena(const VermicelliGeometryArena &) = delete;
+
+  VermicelliGeometryArena &operator=(const VermicelliGeometryArena &) = delete;
+
+  [[nodiscard]] VermicelliDevice &device() { return mDevice; }
+
+  Pool &vertices(VermicelliModel::VertexFormat format);
+
+  Pool &indices(VkIndexType indexType);
+
+  /**
+   * @brief Binds the vertex buffer of the format and the index buffer of the index type. Every model with the same
+   * pair draws from these, so render systems only call this when the pair changes.
+   */
+  void bind(VkCommandBuffer commandBuffer, VermicelliModel::VertexFormat format, VkIndexType indexType);
+
+  /// Pools compact once their holes add up to more than this fraction of the capacity
+  static constexpr float FRAGMENTATION_LIMIT = 0.25f;
+
+  /**
+   * @brief Compacts every pool fragmented past FRAGMENTATION_LIMIT, see Pool::compact. Application::run calls this
+   * as each frame begins, once the deletion queue has handed back the ranges of released models and before
+   * recordCopies.
+   */
+  void compact();
+
+  /**
+   * @brief Records every pool's queued copies into the frame being recorded, followed by a barrier that makes them
+   * visible to the vertex input, shaders and indirect draws. Call right after the renderer begins each frame; frames
+   * with nothing queued record nothing.
+   */
+  void recordCopies(VkCommandBuffer commandBuffer);
+
+  /**
+   * @brief Changes whenever any pool moves to a new buffer, invalidating command buffers recorded against it
+   */
+  [[nodiscard]] uint64_t layoutVersion() const;
+
+private:
+  VermicelliDevice &mDevice;
+  bool             mVerbose;
+  Pool             mFullVertices;
+  Pool             mCompactVertices;
+  Pool             mShortIndices;
+  Pool             mIndices;
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_GEOMETRY_ARENA_H__
@@ -0,0 +1,192 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Frustum culls instanced batches on the GPU and turns the survivors into indirect draws
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_GPU_CULLING_H__
+#define __VERMICELLI_VERMICELLI_GPU_CULLING_H__
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#include <glm/glm.hpp>
+#include "vermicelli_buffer.h"
+#include "vermicelli_depth_pyramid.h"
+#include "vermicelli_descriptors.h"
+#include "vermicelli_frame_info.h"
+#include "vermicelli_pipeline.h"
+#include "vermicelli_swap_chain.h"
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vermicelli {
+
+class VermicelliModel;
+
+/**
+ * Takes the same batches the CPU path draws, and the scene slot of every instance in them, and lets two compute passes
+ * decide what is drawn. The first tests each instance's bounding sphere from the scene buffer against the frustum of
+ * the global UBO and compacts the visible slots within their batch's instance range; the second gives each of the
+ * batch's submesh commands that count and compacts the commands that still draw something within their group. Both
+ * compact with a workgroup prefix sum rather than atomics, so survivors keep their order and what is drawn, and in
+ * which order, is exactly what the CPU path draws minus what lies outside the frustum.
+ *
+ * Each group is then one vkCmdDrawIndexedIndirectCountKHR. Without VK_KHR_draw_indirect_count the whole group is
+ * drawn with vkCmdDrawIndexedIndirect, the commands past the count having been zeroed, and without multiDrawIndirect
+ * that is one call per command. Only indexed models can be drawn this way.
+ *
+ * Given a depth pyramid, the first pass also drops instances whose bounds the pyramid, still holding the last frame's
+ * depth, hides, keeping them as candidates. Once the frame's first draws are in the depth buffer and the pyramid has
+ * been rebuilt from it, cullLate() tests the candidates again and both passes run over what they leave, reusing the
+ * same buffers; the render pass those draws were in has to have ended. What is drawn then is whatever the first draws
+ * did not hide, so nothing goes missing for a frame when it comes out from behind something.
+ */
+class VermicelliGpuCulling {
+public:
+  /// One instanced draw of a model at one LOD; its instances are [mFirstInstance, + mInstanceCount)
+  struct Batch {
+      const VermicelliModel *mModel;
+      uint32_t              mLod;
+      uint32_t              mFirstInstance;
+      uint32_t              mInstanceCount;
+  };
+
+  /// Consecutive commands that share a pipeline and index buffer, drawn by one indirect call; mModel is any of them
+  struct Group {
+      const VermicelliModel *mModel;
+      uint32_t              mFirstCommand;
+      uint32_t              mCommandCount;
+  };
+
+  /// What occlusion culling did with the instances of a frame
+  struct OcclusionStats {
+      uint32_t mTested        = 0;
+      uint32_t mFrustumCulled = 0; ///< Outside the frustum or under the smallest projected diameter kept
+      uint32_t mOccluded      = 0; ///< In the frustum, but hidden from both passes
+      uint32_t mDisoccluded   = 0; ///< Hidden by the last frame's depth but not this frame's, drawn by cullLate()
+  };
+
+  VermicelliGpuCulling(VermicelliDevice &device, bool verbose = false);
+
+  ~VermicelliGpuCulling();
+
+  VermicelliGpuCulling(const VermicelliGpuCulling &) = delete;
+
+  VermicelliGpuCulling &operator=(const VermicelliGpuCulling &) = delete;
+
+  /**
+   * @brief Records both passes into the frame's primary, outside the render pass and after the scene buffer has been
+   * flushed
+   * @param instances Scene slots, indexed by instance
+   * @param batches Sorted so that batches sharing a vertex format and index type are next to each other
+   * @param minPixels Instances whose bounds project to fewer pixels across are dropped, as by the CPU culler
+   * @param pyramid Culls by occlusion too unless null; nothing is, though, until the pyramid has been built once
+   */
+  void cull(const FrameInfo &frameInfo, const std::vector<VermicelliSceneBuffer::Slot> &instances,
+            const std::vector<Batch> &batches, float minPixels, const VermicelliDepthPyramid *pyramid = nullptr);
+
+  /**
+   * @brief Records both passes again over what cull() found hidden, against pyramid as just rebuilt, outside the
+   * render pass and after everything cull() left has been drawn. The groups are then drawn again.
+   */
+  void cullLate(const FrameInfo &frameInfo, const VermicelliDepthPyramid &pyramid);
+
+  /// Whether the last cull() tested occlusion, so cullLate() has candidates to draw
+  [[nodiscard]] bool hasLatePass() const { return mOccluding; }
+
+  /**
+   * @brief Counts of the last frame occlusion culled in the current frame's slot, read back as the slot came around
+   */
+  [[nodiscard]] const OcclusionStats &occlusionStats() const { return mOcclusionStats; }
+
+  /// What the last cull() left to draw, one indirect call each
+  [[nodiscard]] const std::vector<Group> &groups() const { return mGroups; }
+
+  /// Visible scene slots of the frame, for the instance-rate binding; indexed like the instances given to cull()
+  [[nodiscard]] VkBuffer instanceBuffer(int frameIndex) const { return mFrames[frameIndex].mVisible->getBuffer(); }
+
+  /**
+   * @brief Draws groups()[group] with whatever pipeline and index buffer are bound
+   */
+  void draw(const FrameInfo &frameInfo, VkCommandBuffer commandBuffer, size_t group) const;
+
+private:
+  /// Written by the passes, so one set per frame in flight; each grows to the largest frame it has seen
+  struct FrameBuffers {
+      std::unique_ptr<VermicelliBuffer> mVisible;        ///< Scene slot per instance
+      std::unique_ptr<VermicelliBuffer> mInstanceCounts; ///< Visible instances per batch
+      std::unique_ptr<VermicelliBuffer> mCommands;       ///< VkDrawIndexedIndirectCommand
+      std::unique_ptr<VermicelliBuffer> mDrawCounts;     ///< Commands left per group
+      std::unique_ptr<VermicelliBuffer> mCandidates;      ///< Scene slot per instance hidden from the first pass
+      std::unique_ptr<VermicelliBuffer> mCandidateCounts; ///< Hidden instances per batch
+      std::unique_ptr<VermicelliBuffer> mStats;           ///< Host-visible, added to by the occlusion passes
+      bool                              mStatsWritten  = false;
+      VkDescriptorSet                   mDescriptorSet = VK_NULL_HANDLE;
+      VkBuffer                          mFrameData     = VK_NULL_HANDLE; ///< Frame allocator the set was written with
+      VkImageView                       mPyramid       = VK_NULL_HANDLE; ///< Depth pyramid the set was written with
+  };
+
+  /// Word offsets of this frame's arrays in the frame allocator, see cull_instances.comp
+  struct PushConstants {
+      uint32_t  mInstances;
+      uint32_t  mBatches;
+      uint32_t  mCommands;
+      uint32_t  mGroups;
+      glm::mat4 mViewProjection; ///< That of the depth pyramid, read by cull_occlusion.comp only
+      float     mPixelsPerUnit;  ///< As in VermicelliFrustumCuller::View
+      float     mMinPixels;
+  };
+
+  /// VkDrawIndexedIndirectCommand followed by the batch it draws, as the second pass reads it
+  struct CommandTemplate {
+      VkDrawIndexedIndirectCommand mCommand;
+      uint32_t                     mBatch;
+  };
+
+  VermicelliDevice                                                       &mDevice;
+  bool                                                                   mVerbose;
+  std::unique_ptr<VermicelliDescriptorSetLayout>                         mSetLayout;
+  std::unique_ptr<VermicelliDescriptorPool>                              mPool;
+  VkPipelineLayout                                                       mPipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<VermicelliComputePipeline>                             mInstancePass;
+  std::unique_ptr<VermicelliComputePipeline>                             mCommandPass;
+  std::unique_ptr<VermicelliComputePipeline>                             mEarlyPass; ///< mInstancePass with occlusion
+  std::unique_ptr<VermicelliComputePipeline>                             mLatePass;
+  std::array<FrameBuffers, VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT>   mFrames{};
+  std::vector<CommandTemplate>                                           mTemplates;
+  std::vector<Group>                                                     mGroups;
+  PushConstants                                                          mPush{};       ///< Of the last cull()
+  uint32_t                                                               mBatchCount = 0;
+  bool                                                                   mOccluding = false;
+  OcclusionStats                                                         mOcclusionStats{};
+
+  void createPipelines();
+
+  /// Both variants of cull_occlusion.comp, made the first time there is a pyramid to cull against
+  void createOcclusionPipelines();
+
+  /// Records the instance pass, then the command pass over its counts, with mPush
+  void dispatch(const FrameInfo &frameInfo, VermicelliComputePipeline &instancePass);
+
+  /**
+   * @brief Makes sure buffer holds count elements, replacing it with a larger one if not
+   * @return Whether buffer was replaced, so the descriptor set has to be written again
+   */
+  bool reserve(std::unique_ptr<VermicelliBuffer> &buffer, VkDeviceSize elementSize, size_t count,
+               VkBufferUsageFlags usage);
+
+  void writeDescriptorSet(const FrameInfo &frameInfo, FrameBuffers &frame, const VermicelliDepthPyramid *pyramid);
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_GPU_CULLING_H__
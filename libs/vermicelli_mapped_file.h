@@ -0,0 +1,46 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Read-only memory mapping of a file on disk
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_MAPPED_FILE_H__
+#define __VERMICELLI_VERMICELLI_MAPPED_FILE_H__
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vermicelli {
+
+class VermicelliMappedFile {
+  const char *mData = nullptr;
+  size_t     mSize  = 0;
+
+public:
+  explicit VermicelliMappedFile(const std::string &filePath);
+
+  ~VermicelliMappedFile();
+
+  VermicelliMappedFile(const VermicelliMappedFile &) = delete;
+
+  VermicelliMappedFile &operator=(const VermicelliMappedFile &) = delete;
+
+  [[nodiscard]] const char *data() const { return mData; }
+
+  [[nodiscard]] size_t size() const { return mSize; }
+
+  /**
+   * @brief Modification time (nanoseconds since epoch) and size of a file, without opening it.
+   * @return false if the file does not exist
+   */
+  static bool stat(const std::string &filePath, int64_t &mTimeNs, uint64_t &size);
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_MAPPED_FILE_H__
@@ -0,0 +1,188 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Suballocates buffers and images from large device memory blocks, one set of blocks per memory type
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_MEMORY_ALLOCATOR_H__
+#define __VERMICELLI_VERMICELLI_MEMORY_ALLOCATOR_H__
+#pragma once
+
+#include "vermicelli_tlsf.h"
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vermicelli {
+
+/**
+ * Every vkAllocateMemory counts against maxMemoryAllocationCount and is a round trip into the driver, so resources
+ * share large blocks instead. Each memory type has two sets of blocks, one for buffers and linear images and one for
+ * optimal-tiling images, so the two kinds never sit next to each other and bufferImageGranularity never applies.
+ * Resources of at least half a block get memory of their own. Host-visible blocks stay mapped for their whole
+ * lifetime, since a VkDeviceMemory can only be mapped once at a time.
+ *
+ * Every allocation is tagged with what it is for, and usage is tracked per category and per heap. Heap usage and
+ * budget come from VK_EXT_memory_budget when the device has it, refreshed whenever device memory is allocated or
+ * freed; otherwise usage is what this allocator holds and the budget is a fixed share of the heap. A callback can be
+ * set to hear about a heap going over a fraction of its budget, before an allocation actually fails.
+ */
+class VermicelliMemoryAllocator {
+  struct Block;
+
+public:
+  enum class Category {
+      GEOMETRY,
+      UNIFORMS,    ///< Per-frame and other host-written shader data
+      ATTACHMENTS, ///< Depth buffers and render targets
+      STAGING,
+      TEXTURES,
+      OTHER
+  };
+  static constexpr uint32_t CATEGORY_COUNT = static_cast<uint32_t>(Category::OTHER) + 1;
+
+  /// Called with the heap index, its usage and its budget
+  using BudgetCallback = std::function<void(uint32_t, VkDeviceSize, VkDeviceSize)>;
+
+  struct Allocation {
+      VkDeviceMemory mMemory     = VK_NULL_HANDLE;
+      VkDeviceSize   mOffset     = 0;
+      VkDeviceSize   mSize       = 0;
+      void           *mMapped    = nullptr; ///< Host address of mOffset, for host-visible memory only
+      uint32_t       mMemoryType = 0;
+      Block          *mBlock     = nullptr; ///< nullptr for dedicated allocations
+      uint32_t       mNode       = VermicelliTlsf::NO_NODE;
+      Category       mCategory   = Category::OTHER;
+  };
+
+  struct Stats {
+      uint32_t     mBlockCount           = 0;
+      uint32_t     mDedicatedCount       = 0;
+      uint32_t     mAllocationCount      = 0; ///< Suballocations plus dedicated allocations
+      VkDeviceSize mBlockBytes           = 0; ///< Reserved in blocks, used or not
+      VkDeviceSize mDedicatedBytes       = 0;
+      VkDeviceSize mUsedBytes            = 0; ///< Handed out from blocks
+      VkDeviceSize mHeapBytes[VK_MAX_MEMORY_HEAPS]{}; ///< Blocks and dedicated allocations per heap
+      VkDeviceSize mHeapUsage[VK_MAX_MEMORY_HEAPS]{};  ///< Process-wide with the budget extension, else mHeapBytes
+      VkDeviceSize mHeapBudget[VK_MAX_MEMORY_HEAPS]{};
+      VkDeviceSize mCategoryBytes[CATEGORY_COUNT][VK_MAX_MEMORY_HEAPS]{}; ///< Handed out, per category and heap
+      uint32_t     mHeapCount            = 0;
+      bool         mDriverBudget         = false; ///< Whether usage and budget came from VK_EXT_memory_budget
+  };
+
+  /// Share of each heap assumed to be available when the driver cannot tell
+  static constexpr float FALLBACK_BUDGET = 0.8f;
+
+  /**
+   * @param memoryBudget Whether VK_EXT_memory_budget, and the properties2 instance extension it needs, are enabled
+   */
+  VermicelliMemoryAllocator(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, bool memoryBudget,
+                            bool verbose = false);
+
+  ~VermicelliMemoryAllocator();
+
+  VermicelliMemoryAllocator(const VermicelliMemoryAllocator &) = delete;
+
+  VermicelliMemoryAllocator &operator=(const VermicelliMemoryAllocator &) = delete;
+
+  /**
+   * @param linear true for buffers and linear images, false for optimal-tiling images
+   */
+  Allocation allocate(const VkMemoryRequirements &requirements, uint32_t memoryType, bool linear, Category category);
+
+  void free(Allocation &allocation);
+
+  /**
+   * @brief Flushes a range of a mapped allocation, widened to nonCoherentAtomSize. A no-op on coherent memory.
+   * @param size VK_WHOLE_SIZE for the rest of the allocation
+   */
+  VkResult flush(const Allocation &allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+  /**
+   * @brief Invalidates a range of a mapped allocation, see flush
+   */
+  VkResult invalidate(const Allocation &allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+  [[nodiscard]] Stats stats();
+
+  /**
+   * @brief Calls callback, outside the allocator's lock, whenever a heap's usage rises past threshold times its
+   * budget. It is called again for that heap only after usage has dropped back below.
+   */
+  void setBudgetCallback(BudgetCallback callback, float threshold = 0.9f);
+
+  static const char *categoryName(Category category);
+
+private:
+  struct Block {
+      VkDeviceMemory mMemory;
+      void           *mMapped;
+      VermicelliTlsf mTlsf;
+  };
+
+  /// Blocks of one memory type and one resource kind
+  struct Pool {
+      std::vector<std::unique_ptr<Block>> mBlocks{};
+  };
+
+  VkPhysicalDevice                 mPhysicalDevice;
+  VkDevice                         mDevice;
+  bool                             mVerbose;
+  VkPhysicalDeviceMemoryProperties mMemoryProperties;
+  VkDeviceSize                     mNonCoherentAtomSize;
+  std::vector<Pool>                mPools;            ///< Two per memory type, linear first
+  uint32_t                         mDedicatedCount = 0;
+  VkDeviceSize                     mDedicatedBytes = 0;
+  VkDeviceSize                     mDedicatedHeapBytes[VK_MAX_MEMORY_HEAPS]{};
+  VkDeviceSize                     mHeapBytes[VK_MAX_MEMORY_HEAPS]{};      ///< Device memory held, blocks or not
+  VkDeviceSize                     mCategoryBytes[CATEGORY_COUNT][VK_MAX_MEMORY_HEAPS]{};
+  VkDeviceSize                     mHeapUsage[VK_MAX_MEMORY_HEAPS]{};
+  VkDeviceSize                     mHeapBudget[VK_MAX_MEMORY_HEAPS]{};
+  bool                             mOverBudget[VK_MAX_MEMORY_HEAPS]{};
+  PFN_vkGetPhysicalDeviceMemoryProperties2KHR mGetMemoryProperties2 = nullptr;
+  BudgetCallback                   mBudgetCallback{};
+  float                            mBudgetThreshold = 0.9f;
+  std::mutex                       mMutex;
+
+  [[nodiscard]] VkDeviceSize blockSize(uint32_t memoryType) const;
+
+  [[nodiscard]] bool isHostVisible(uint32_t memoryType) const;
+
+  [[nodiscard]] bool isCoherent(uint32_t memoryType) const;
+
+  /**
+   * @param crossedBudget Set if this allocation took its heap over the callback threshold
+   */
+  VkDeviceMemory allocateMemory(VkDeviceSize size, uint32_t memoryType, void **mapped, bool &crossedBudget);
+
+  void freeMemory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType);
+
+  /**
+   * @brief Places allocation in a block of its pool, adding a block if none has room, with mMutex held
+   */
+  void suballocate(Allocation &allocation, const VkMemoryRequirements &requirements, VkDeviceSize blockSize,
+                   bool linear, bool &crossedBudget);
+
+  /**
+   * @brief Reloads mHeapUsage and mHeapBudget for every heap, with mMutex held
+   */
+  void refreshBudget();
+
+  /**
+   * @brief Refreshes the budget after device memory was allocated or freed on heap, with mMutex held
+   * @return true if heap just went over the callback threshold and there is a callback to tell
+   */
+  bool updateBudget(uint32_t heap);
+
+  VkMappedMemoryRange mappedRange(const Allocation &allocation, VkDeviceSize offset, VkDeviceSize size) const;
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_MEMORY_ALLOCATOR_H__
@@ -0,0 +1,97 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Versioned binary copy of a loaded model, stored next to its source file
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_MESH_CACHE_H__
+#define __VERMICELLI_VERMICELLI_MESH_CACHE_H__
+#pragma once
+
+#include "vermicelli_model.h"
+#include "vermicelli_mapped_file.h"
+#include <memory>
+#include <span>
+#include <string>
+
+namespace vermicelli {
+
+/**
+ * The cache file is a Header followed by the vertex blob and the index blob, both exactly as they are uploaded to the
+ * GPU, and then the builder's LOD ranges and meshlets. A cache is only used while the source's modification time and
+ * size match the header; if only the time changed, the source is re-hashed, and if the contents are identical the
+ * cache survives and takes the new time.
+ */
+class VermicelliMeshCache {
+public:
+  static constexpr uint32_t MAGIC   = 0x48534d56; // "VMSH"
+  static constexpr uint32_t VERSION = 4; ///< Bump whenever the loader starts producing different vertices
+
+  struct Header {
+      uint32_t  mMagic;
+      uint32_t  mVersion;
+      uint32_t  mVertexStride;
+      uint32_t  mFlags;
+      uint64_t  mVertexCount;
+      uint64_t  mIndexCount;
+      int64_t   mSourceMTime;
+      uint64_t  mSourceSize;
+      uint64_t  mSourceHash;
+      glm::vec3 mBoundsMin;
+      glm::vec3 mBoundsMax;
+      uint32_t  mLodCount;
+      uint32_t  mMeshletCount;
+      uint32_t  mReserved[2];
+  };
+
+  /**
+   * @brief Maps the cache belonging to sourcePath.
+   * @param flags ModelLoadOptions::cacheFlags() the cached data must have been built with
+   * @return nullptr if there is no cache, or it is stale, truncated, from another version or built with other flags
+   */
+  static std::unique_ptr<VermicelliMeshCache> open(const std::string &sourcePath, uint32_t flags = 0);
+
+  /**
+   * @brief Writes the cache for sourcePath from a freshly loaded builder. Failing to write is not an error; the model
+   * simply gets parsed again next time.
+   * @param flags ModelLoadOptions::cacheFlags() the builder's data was produced with
+   * @return true if the cache was written
+   */
+  static bool write(const std::string &sourcePath, const VermicelliModel::Builder &builder, uint32_t flags = 0);
+
+  static std::string cachePath(const std::string &sourcePath) { return sourcePath + ".vmesh"; }
+
+  /**
+   * @brief Times building sourcePath from the OBJ against loading it from its cache, both fresh and after the source
+   * was touched, and prints the results. Leaves the cache written.
+   */
+  static void benchmark(const std::string &sourcePath);
+
+  [[nodiscard]] const Header &header() const { return *mHeader; }
+
+  [[nodiscard]] std::span<const VermicelliModel::Vertex> vertices() const;
+
+  [[nodiscard]] std::span<const uint32_t> indices() const;
+
+  [[nodiscard]] std::span<const VermicelliModel::LodRange> lods() const;
+
+  [[nodiscard]] std::span<const VermicelliModel::Meshlet> meshlets() const;
+
+private:
+  explicit VermicelliMeshCache(std::unique_ptr<VermicelliMappedFile> file);
+
+  static uint64_t hashFile(const std::string &filePath);
+
+  /// Records a new source time in an existing cache, once its contents were found to be unchanged
+  static void updateSourceMTime(const std::string &cachePath, int64_t sourceMTime);
+
+  std::unique_ptr<VermicelliMappedFile> mFile;
+  const Header                          *mHeader;
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_MESH_CACHE_H__
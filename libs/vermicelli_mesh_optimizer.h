@@ -0,0 +1,61 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Index and vertex reordering for post-transform cache reuse, overdraw and vertex fetch locality
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_MESH_OPTIMIZER_H__
+#define __VERMICELLI_VERMICELLI_MESH_OPTIMIZER_H__
+#pragma once
+
+#include "vermicelli_model.h"
+
+#include <span>
+#include <vector>
+
+namespace vermicelli {
+
+/**
+ * Reorders triangle lists without changing what they draw. The passes are meant to run in the order they are
+ * declared: vertex cache first, then overdraw (which only moves whole cache-friendly clusters around), then
+ * vertex fetch (which renumbers vertices to match the final triangle order).
+ */
+class VermicelliMeshOptimizer {
+public:
+  struct VertexCacheStats {
+      float mACMR; ///< Average cache miss ratio: transformed vertices per triangle, 0.5 is ideal for big grids
+      float mATVR; ///< Average transform to vertex ratio: transformed vertices per unique vertex, 1.0 is ideal
+  };
+
+  /**
+   * @brief Simulates a FIFO post-transform cache over the triangle list
+   * @param cacheSize Entries in the simulated cache; 16 is a conservative stand-in for current hardware
+   */
+  static VertexCacheStats
+  analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+  /**
+   * @brief Reorders triangles for post-transform cache hits, greedily emitting the best scoring triangle with a
+   * Forsyth-style score (recency in a simulated LRU cache plus a bonus for vertices with few triangles left)
+   */
+  static void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+  /**
+   * @brief Splits the cache-optimized list into clusters and sorts them so outward-facing clusters draw first
+   * @param threshold How much ACMR may degrade (1.05 = 5%) in exchange for finer clusters
+   */
+  static void optimizeOverdraw(std::vector<uint32_t> &indices, std::span<const VermicelliModel::Vertex> vertices,
+                               float threshold = 1.05f);
+
+  /**
+   * @brief Renumbers vertices in the order the triangle list first uses them, dropping unreferenced ones
+   */
+  static void optimizeVertexFetch(std::vector<VermicelliModel::Vertex> &vertices, std::vector<uint32_t> &indices);
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_MESH_OPTIMIZER_H__
@@ -0,0 +1,42 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Quadric error edge-collapse simplification for generating levels of detail
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_MESH_SIMPLIFIER_H__
+#define __VERMICELLI_VERMICELLI_MESH_SIMPLIFIER_H__
+#pragma once
+
+#include "vermicelli_model.h"
+
+#include <span>
+#include <vector>
+
+namespace vermicelli {
+
+/**
+ * Simplifies a triangle list by collapsing vertices onto neighbouring ones (half-edge collapses), so the result only
+ * references existing vertices and every LOD can share one vertex buffer. Collapses are ranked by the quadric error of
+ * the moved position plus how far the attributes (normal, uv, color) of the moved vertex are from the ones it lands
+ * on; vertices that share a position but not attributes move together. Border and non-manifold vertices never move.
+ */
+class VermicelliMeshSimplifier {
+public:
+  /**
+   * @param targetIndexCount Stop once the result has at most this many indices
+   * @param targetError Largest error a collapse may introduce, relative to the mesh's bounding radius
+   * @param resultError (Optional) Receives the largest error that was introduced, in the same units
+   * @return Indices into the unchanged vertex array
+   */
+  static std::vector<uint32_t>
+  simplify(std::span<const VermicelliModel::Vertex> vertices, std::span<const uint32_t> indices,
+           size_t targetIndexCount, float targetError, float *resultError = nullptr);
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_MESH_SIMPLIFIER_H__
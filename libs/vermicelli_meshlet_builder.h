@@ -0,0 +1,41 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Splits triangle lists into small clusters with bounding spheres and normal cones for culling
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_MESHLET_BUILDER_H__
+#define __VERMICELLI_VERMICELLI_MESHLET_BUILDER_H__
+#pragma once
+
+#include "vermicelli_model.h"
+
+#include <span>
+#include <vector>
+
+namespace vermicelli {
+
+class VermicelliMeshletBuilder {
+public:
+  static constexpr uint32_t MAX_VERTICES  = 64;
+  static constexpr uint32_t MAX_TRIANGLES = 124;
+
+  /**
+   * @brief Reorders the triangles in indices so every meshlet is a contiguous run, growing each meshlet through
+   * neighbouring triangles that add the fewest new vertices, and appends one Meshlet per run
+   * @param indexOffset Position of indices[0] in the model's index buffer, added to Meshlet::mFirstIndex
+   */
+  static void build(std::span<const VermicelliModel::Vertex> vertices, std::span<uint32_t> indices,
+                    uint32_t indexOffset, std::vector<VermicelliModel::Meshlet> &meshlets);
+
+private:
+  static VermicelliModel::Meshlet
+  describe(std::span<const VermicelliModel::Vertex> vertices, std::span<const uint32_t> triangles);
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_MESHLET_BUILDER_H__
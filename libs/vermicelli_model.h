@@ -19,16 +19,121 @@
 #include <glm/glm.hpp>
 #include <vector>
 #include <memory>
+#include <span>
 
 namespace vermicelli {
+
+class VermicelliGeometryArena;
+
+/**
+ * Per-model switches for VermicelliModel::createModelFromFile. Anything that changes the data handed to the GPU must
+ * also be reflected in cacheFlags(), otherwise a mesh cache built with other options would be picked up.
+ */
+struct ModelLoadOptions {
+    static constexpr uint32_t OPTIMIZED_MESH = 1 << 0;
+    static constexpr uint32_t GENERATED_LODS = 1 << 1;
+    static constexpr uint32_t BUILT_MESHLETS = 1 << 2;
+
+    bool mOptimizeMesh         = false; ///< Reorder triangles and vertices for the GPU caches after loading
+    bool mGenerateLods         = false; ///< Build a chain of simplified index ranges over the same vertices
+    bool mBuildMeshlets        = false; ///< Regroup levels into meshlets and upload their bounds; see Meshlet
+    bool mCompactVertices      = false; ///< Upload CompactVertex instead of Vertex; the cache keeps full vertices
+    bool mSplitForShortIndices = false; ///< Split meshes over 64k vertices into chunks that can use uint16 indices
+    bool mBuildOccluder        = false; ///< Keep a small mesh on the CPU for VermicelliOcclusionRasterizer
+
+    [[nodiscard]] uint32_t cacheFlags() const {
+      return (mOptimizeMesh ? OPTIMIZED_MESH : 0) | (mGenerateLods ? GENERATED_LODS : 0) |
+             (mBuildMeshlets ? BUILT_MESHLETS : 0);
+    }
+
+    bool operator==(const ModelLoadOptions &rhs) const = default;
+};
+
 class VermicelliModel {
+public:
+  enum class VertexFormat {
+      FULL,
+      COMPACT
+  };
+
+  /// A range of the index buffer drawn with its own vertex offset; indices are relative to that offset
+  struct Submesh {
+      uint32_t mFirstIndex;
+      uint32_t mIndexCount;
+      int32_t  mVertexOffset;
+  };
+
+  /// A level of detail as produced by the builder: a range of the index buffer and its error
+  struct LodRange {
+      uint32_t mFirstIndex;
+      uint32_t mIndexCount;
+      float    mError; ///< Sum of the simplifier's error estimates of every level up to it, relative to the radius
+      uint32_t mFirstMeshlet = 0;
+      uint32_t mMeshletCount = 0;
+  };
+
+  /// A level of detail as drawn: the submeshes its index range ended up in, and the meshlets covering it
+  struct Lod {
+      uint32_t mFirstSubmesh;
+      uint32_t mSubmeshCount;
+      float    mError;
+      uint32_t mFirstMeshlet;
+      uint32_t mMeshletCount;
+  };
+
+  /**
+   * A small cluster of triangles, contiguous in the index buffer, with what a culling pass needs to reject it. Laid
+   * out for std430 so the meshlet buffer can be read as an array of these from a shader. Seen from eye, the cluster
+   * is entirely backfacing when dot(normalize(c - eye), cone.xyz) >= cone.w + r / length(c - eye).
+   *
+   * The cone test only holds for pipelines that cull back faces; the engine's pipelines cull nothing, and no pass
+   * reads the meshlet buffer yet, so meshlets are opt-in for now.
+   */
+  struct Meshlet {
+      glm::vec4 mBoundingSphere; ///< Object-space center c in xyz, radius r in w
+      glm::vec4 mCone;           ///< Average face normal in xyz, cutoff in w (1 if the cluster can never be culled)
+      uint32_t  mFirstIndex;
+      uint32_t  mIndexCount;
+      uint32_t  mVertexCount;
+      uint32_t  mPadding;
+  };
+
+  /// Triangles standing in for the model when it hides others from VermicelliOcclusionRasterizer, in object space
+  struct Occluder {
+      std::vector<glm::vec3> mPositions;
+      std::vector<uint32_t>  mIndices;
+  };
+
+  /// Meshes with at most this many vertices (or chunks of that size) are drawn with uint16 indices
+  static constexpr uint32_t SHORT_INDEX_VERTEX_LIMIT = 1 << 16;
+
+  /// ModelLoadOptions::mBuildOccluder only uses meshes of at most this many triangles as their own occluder
+  static constexpr uint32_t OCCLUDER_MAX_TRIANGLES = 4096;
+
+  static constexpr uint32_t MAX_LODS = 5;
+
+private:
   bool                              mVerbose;
+  VermicelliGeometryArena           &mArena;
   VermicelliDevice                  &mDevice;
-  std::unique_ptr<VermicelliBuffer> mVertexBuffer;
+  VertexFormat                      mVertexFormat;
+  glm::mat4                         mDequantization{1.0f};
+  uint32_t                          mVertexRange    = UINT32_MAX; ///< Handle into the arena's vertex pool
   uint32_t                          mVertexCount;
   bool                              mHasIndexBuffer = false;
-  std::unique_ptr<VermicelliBuffer> mIndexBuffer;
+  uint32_t                          mIndexRange     = UINT32_MAX; ///< Handle into the arena's index pool
   uint32_t                          mIndexCount;
+  VkIndexType                       mIndexType      = VK_INDEX_TYPE_UINT32;
+  std::vector<Submesh>              mSubmeshes{};
+  std::vector<Lod>                  mLods{};
+  std::unique_ptr<VermicelliBuffer> mMeshletBuffer;
+  uint32_t                          mMeshletCount   = 0;
+  uint64_t                          mTicket         = 0; ///< Uploader ticket covering every buffer of this model
+  glm::vec3                         mBoundsMin{0.0f};     ///< Object-space AABB
+  glm::vec3                         mBoundsMax{0.0f};
+  glm::vec3                         mBoundingCenter{0.0f}; ///< Centered on the AABB
+  float                             mBoundingRadius = 0.0f;
+  Occluder                          mOccluder{};
 
 public:
   struct Vertex {
@@ -46,14 +151,63 @@ public:
       }
   };
 
+  /**
+   * 20-byte alternative to Vertex. Positions are 16-bit unorm within the mesh bounds and are taken back to object
+   * space by dequantization(), normals are octahedral-encoded snorm16, colors rgba8 and UVs half floats.
+   */
+  struct CompactVertex {
+      uint16_t mPosition[4]; ///< w is padding, 3-component 16-bit formats are rarely supported for vertex input
+      uint32_t mNormal;
+      uint32_t mColor;
+      uint32_t mUV;
+
+      static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+
+      static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+  };
+
   struct Builder {
       std::vector<Vertex>   mVertices{};
       std::vector<uint32_t> mIndices{};
+      std::vector<LodRange> mLods{}; ///< Empty, or one range per level with the full mesh first
+      std::vector<Meshlet>  mMeshlets{};
+
+      void loadModel(const std::string &filePath, bool verbose = false);
+
+      /**
+       * @brief Parses the OBJ once, then times welding its corners into vertices with the table loadModel uses and
+       * with std::unordered_map, and prints the results
+       */
+      static void benchmarkWelding(const std::string &filePath);
 
-      void loadModel(const std::string &filePath);
+      /**
+       * @brief Reorders indices for post-transform cache hits and overdraw, then vertices into fetch order
+       */
+      void optimize(bool verbose = false);
+
+      /**
+       * @brief Appends up to MAX_LODS - 1 simplified copies of the mesh to mIndices, each aiming for half the
+       * triangles of the previous one, and records every level in mLods
+       */
+      void generateLods(bool verbose = false);
+
+      /**
+       * @brief Regroups the triangles of every level into meshlets, each a contiguous run of mIndices, and records
+       * which meshlets belong to which level. Call after optimize() and generateLods(), both reorder mIndices.
+       */
+      void buildMeshlets(bool verbose = false);
   };
 
-  VermicelliModel(VermicelliDevice &device, const VermicelliModel::Builder &builder, bool verbose);
+  VermicelliModel(VermicelliGeometryArena &arena, const VermicelliModel::Builder &builder, bool verbose);
+
+  /**
+   * @param lods Levels of detail within indices; empty draws all indices as a single level
+   * @param meshlets Clusters referenced by lods; meshes with meshlets are never split for short indices, since a
+   * meshlet could straddle two chunks
+   */
+  VermicelliModel(VermicelliGeometryArena &arena, std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+                  std::span<const LodRange> lods, std::span<const Meshlet> meshlets, bool verbose,
+                  const ModelLoadOptions &options = {});
 
   ~VermicelliModel();
 
@@ -62,17 +216,111 @@ public:
   VermicelliModel &operator=(const VermicelliModel &) = delete;
 
   static std::unique_ptr<VermicelliModel>
-  createModelFromFile(VermicelliDevice &device, const std::string &filePath, bool verbose = false);
+  createModelFromFile(VermicelliGeometryArena &arena, const std::string &filePath, bool verbose = false,
+                      const ModelLoadOptions &options = {});
+
+  /**
+   * @brief Times encoding vertexCount vertices of a sphere as CompactVertex, and decoding both formats on the CPU the
+   * way the vertex shader does, and prints those times with each format's size and the compact one's largest errors.
+   * Nothing is drawn, so this says nothing about vertex fetch bandwidth on the GPU.
+   */
+  static void benchmarkVertexEncoding(uint32_t vertexCount);
+
+  /**
+   * @brief Binds the arena buffers this model draws from. They are shared by every model with the same vertexFormat()
+   * and indexType(), so consecutive models with the same pair need only one bind.
+   */
+  void bind(VkCommandBuffer commandBuffer) const;
+
+  /**
+   * @brief Whether the uploads of this model have finished; it must not be drawn before
+   */
+  [[nodiscard]] bool isResident() const;
+
+  /**
+   * @brief Draws one level of detail, instanceCount times starting at firstInstance, for render systems that feed
+   * per-instance data through an instance-rate vertex binding
+   */
+  void draw(VkCommandBuffer commandBuffer, uint32_t lod = 0, uint32_t instanceCount = 1,
+            uint32_t firstInstance = 0) const;
+
+  [[nodiscard]] VertexFormat vertexFormat() const { return mVertexFormat; }
+
+  [[nodiscard]] VkIndexType indexType() const { return mIndexType; }
+
+  [[nodiscard]] bool hasIndexBuffer() const { return mHasIndexBuffer; }
+
+  [[nodiscard]] const VermicelliGeometryArena &arena() const { return mArena; }
+
+  [[nodiscard]] const std::vector<Submesh> &submeshes() const { return mSubmeshes; }
+
+  /// Where this model's indices start in the arena's index buffer; meshlet and submesh indices are relative to it
+  [[nodiscard]] uint32_t baseIndex() const;
+
+  /// Where this model's vertices start in the arena's vertex buffer
+  [[nodiscard]] int32_t baseVertex() const;
+
+  [[nodiscard]] uint32_t lodCount() const { return static_cast<uint32_t>(mLods.size()); }
+
+  [[nodiscard]] const Lod &lod(uint32_t level) const { return mLods[level]; }
 
-  void bind(VkCommandBuffer commandBuffer);
+  [[nodiscard]] uint32_t meshletCount() const { return mMeshletCount; }
 
-  void draw(VkCommandBuffer commandBuffer) const;
+  /// Storage buffer of meshletCount() Meshlet entries, or nullptr if the model was loaded without meshlets
+  [[nodiscard]] VermicelliBuffer *meshletBuffer() const { return mMeshletBuffer.get(); }
+
+  [[nodiscard]] const glm::vec3 &boundsMin() const { return mBoundsMin; }
+
+  [[nodiscard]] const glm::vec3 &boundsMax() const { return mBoundsMax; }
+
+  [[nodiscard]] const glm::vec3 &boundingCenter() const { return mBoundingCenter; }
+
+  [[nodiscard]] float boundingRadius() const { return mBoundingRadius; }
+
+  /// Maps quantized positions back to object space; fold it into the model matrix. Identity for full vertices.
+  [[nodiscard]] const glm::mat4 &dequantization() const { return mDequantization; }
+
+  [[nodiscard]] bool hasOccluder() const { return !mOccluder.mIndices.empty(); }
+
+  [[nodiscard]] const Occluder &occluder() const { return mOccluder; }
+
+  /**
+   * @brief Replaces the occluder, e.g. with a low-poly proxy made by hand. It should stay inside the model, since
+   * anything it covers that the model does not is hidden all the same. Not while a frame is being culled.
+   */
+  void setOccluder(Occluder occluder) { mOccluder = std::move(occluder); }
 
 private:
 
-  void createVertexBuffers(const std::vector<Vertex> &vertices);
+  void createVertexBuffers(std::span<const Vertex> vertices);
+
+  /// Quantizes the vertices within their bounds; dequantization receives the matrix that undoes it
+  static std::vector<CompactVertex> compactVertices(std::span<const Vertex> vertices, glm::mat4 &dequantization);
+
+  void uploadVertexBuffer(const void *vertices, uint32_t vertexSize);
+
+  void createIndexBuffers(std::span<const uint32_t> indices);
+
+  void uploadIndexBuffer(const void *indices, uint32_t indexSize);
+
+  void createMeshletBuffer(std::span<const Meshlet> meshlets);
+
+  /**
+   * @brief Fills chunkVertices/chunkIndices with every level's triangles in chunks of at most SHORT_INDEX_VERTEX_LIMIT
+   * vertices each, appending the chunks' runs to mSubmeshes and one entry per level to mLods. A triangle goes to a
+   * chunk already holding all its corners when there is one, so coarser levels mostly reuse the vertices of finer ones;
+   * only vertices shared across a chunk boundary are duplicated.
+   */
+  void splitForShortIndices(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+                            std::span<const LodRange> lods, std::vector<Vertex> &chunkVertices,
+                            std::vector<uint16_t> &chunkIndices);
+
+  /// The AABB of every vertex, and the sphere around its center that holds them all
+  void computeBounds(std::span<const Vertex> vertices);
 
-  void createIndexBuffers(const std::vector<uint32_t> &indices);
+  /// Copies the full-detail level into mOccluder, keeping only the positions it uses, if it is small enough
+  void buildOccluder(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+                     std::span<const LodRange> lods);
 };
 }
 
@@ -0,0 +1,80 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Loads each model once per path and options and hands out shared references to it
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_MODEL_REGISTRY_H__
+#define __VERMICELLI_VERMICELLI_MODEL_REGISTRY_H__
+#pragma once
+
+#include "vermicelli_geometry_arena.h"
+#include "vermicelli_model.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace vermicelli {
+
+/**
+ * Game objects that place the same asset share one VermicelliModel, so it is parsed and uploaded once. Entries are
+ * keyed on the canonical path and the full load options, since two option sets produce different GPU data. The
+ * registry keeps every model alive until it is unloaded; objects that still reference an unloaded model keep it alive
+ * until they let go of it.
+ */
+class VermicelliModelRegistry {
+  struct Key {
+      std::string      mPath;
+      ModelLoadOptions mOptions;
+
+      bool operator==(const Key &rhs) const = default;
+  };
+
+  struct KeyHash {
+      size_t operator()(const Key &key) const;
+  };
+
+  VermicelliGeometryArena                                            &mArena;
+  bool                                                               mVerbose;
+  std::unordered_map<Key, std::shared_ptr<VermicelliModel>, KeyHash> mModels{};
+  uint32_t                                                           mHits = 0;
+
+  static Key makeKey(const std::string &filePath, const ModelLoadOptions &options);
+
+public:
+  explicit VermicelliModelRegistry(VermicelliGeometryArena &arena, bool verbose = false);
+
+  ~VermicelliModelRegistry();
+
+  VermicelliModelRegistry(const VermicelliModelRegistry &) = delete;
+
+  VermicelliModelRegistry &operator=(const VermicelliModelRegistry &) = delete;
+
+  /**
+   * @brief Returns the model already loaded from filePath with these options, or loads it
+   */
+  std::shared_ptr<VermicelliModel> load(const std::string &filePath, const ModelLoadOptions &options = {});
+
+  /**
+   * @brief Drops the registry's reference. Once no game object uses the model either, its GPU data is released
+   * through the deletion queue, after the frames that may still draw it.
+   * @return false if the model was not loaded
+   */
+  bool unload(const std::string &filePath, const ModelLoadOptions &options = {});
+
+  /**
+   * @brief Unloads every model that no game object references any more
+   * @return Number of models unloaded
+   */
+  size_t unloadUnused();
+
+  [[nodiscard]] size_t size() const { return mModels.size(); }
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_MODEL_REGISTRY_H__
@@ -0,0 +1,66 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Memory-mapped, multithreaded Wavefront OBJ reader
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_OBJ_READER_H__
+#define __VERMICELLI_VERMICELLI_OBJ_READER_H__
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vermicelli {
+
+/**
+ * Reads the geometry of an OBJ file (v, vt, vn and f statements; everything else is skipped). The file is mapped
+ * and cut at line boundaries into one chunk per worker thread; every chunk is tokenized on its own and the per-chunk
+ * attribute arrays are stitched back together afterwards, resolving relative (negative) face indices on the way.
+ */
+class VermicelliObjReader {
+public:
+  static constexpr int32_t NO_INDEX = -1;
+
+  /// Zero-based attribute indices of a single face corner, NO_INDEX when the corner omits the attribute
+  struct Index {
+      int32_t mPosition;
+      int32_t mTexcoord;
+      int32_t mNormal;
+  };
+
+  std::vector<float> mPositions{}; ///< xyz per position
+  std::vector<float> mColors{};    ///< rgb per position, white when the file has no vertex colors
+  std::vector<float> mNormals{};   ///< xyz per normal
+  std::vector<float> mTexcoords{}; ///< uv per texture coordinate
+  std::vector<Index> mIndices{};   ///< Three corners per triangle; polygons are fan-triangulated
+
+  /**
+   * @param filePath The OBJ file to read
+   * @param threadCount (Optional) Worker threads to use, 0 picks one per hardware thread
+   */
+  explicit VermicelliObjReader(const std::string &filePath, unsigned threadCount = 0);
+
+  [[nodiscard]] size_t triangleCount() const { return mIndices.size() / 3; }
+
+  /**
+   * @brief Parses a decimal floating point number starting at cursor, skipping leading blanks
+   * @return Pointer past the number, or nullptr if there is no number before end of line
+   */
+  static const char *parseFloat(const char *cursor, const char *end, float &value);
+
+private:
+  struct Chunk;
+
+  static void parseChunk(const char *begin, const char *end, Chunk &chunk);
+
+  static const char *parseIndex(const char *cursor, const char *end, int32_t &value);
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_OBJ_READER_H__
@@ -0,0 +1,190 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Masked software occlusion culling: occluders rasterized on the CPU into a coarse depth buffer
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_OCCLUSION_RASTERIZER_H__
+#define __VERMICELLI_VERMICELLI_OCCLUSION_RASTERIZER_H__
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace vermicelli {
+
+/**
+ * A low-resolution depth buffer of the occluders added each frame, for testing bounds against before anything is
+ * recorded. It is kept per subtile of SUBTILE_WIDTH x SUBTILE_HEIGHT pixels rather than per pixel: a reference depth
+ * that everything behind is hidden by, and a working layer, which is a coverage mask of the subtile's pixels and the
+ * farthest depth over them. Triangles are merged into the working layer, and once it covers the whole subtile it
+ * becomes the reference; a layer far behind a new triangle is dropped for the triangle. Depths are conservative
+ * throughout, and coverage is taken at the buffer's pixel centers, so as long as every occluder lies inside what it
+ * stands for, nothing visible is reported hidden but slivers narrower than one of the buffer's pixels.
+ *
+ * render() transforms and clips the occluders on every thread, bins the triangles into TILE_WIDTH x TILE_HEIGHT
+ * tiles in the order they were added, then rasterizes tile by tile across the threads, so no two threads touch the
+ * same subtile and the result never depends on the thread count. Coverage is found eight pixels per instruction with
+ * AVX2 when the CPU has it, and tests compare eight subtiles at once; every path gives the same result.
+ */
+class VermicelliOcclusionRasterizer {
+public:
+  enum class Path {
+      SCALAR,
+      AVX2  ///< Eight pixels or subtiles per instruction
+  };
+
+  static constexpr uint32_t SUBTILE_WIDTH  = 8; ///< One subtile's coverage is a 32-bit mask
+  static constexpr uint32_t SUBTILE_HEIGHT = 4;
+  static constexpr uint32_t TILE_WIDTH     = 64; ///< What triangles are binned by and threads take
+  static constexpr uint32_t TILE_HEIGHT    = 32;
+
+  /// Counts and timings of the last frame
+  struct Stats {
+      uint32_t mOccluders          = 0;
+      uint32_t mTriangles          = 0; ///< Left after clipping, of every occluder
+      uint32_t mTested             = 0;
+      uint32_t mOccluded           = 0;
+      float    mRenderMilliseconds = 0.0f;
+      float    mTestMilliseconds   = 0.0f;
+  };
+
+  /**
+   * @param width, height Of the depth buffer, rounded up to whole tiles; a fraction of the window's, same aspect
+   * @param threadCount Rasterizing threads including the caller, 0 for one per hardware thread
+   */
+  explicit VermicelliOcclusionRasterizer(uint32_t width = 320, uint32_t height = 192, uint32_t threadCount = 0,
+                                         Path path = bestPath());
+
+  ~VermicelliOcclusionRasterizer();
+
+  VermicelliOcclusionRasterizer(const VermicelliOcclusionRasterizer &) = delete;
+
+  VermicelliOcclusionRasterizer &operator=(const VermicelliOcclusionRasterizer &) = delete;
+
+  /// The widest path this CPU runs
+  static Path bestPath();
+
+  static const char *pathName(Path path);
+
+  /**
+   * @brief Starts a frame seen through viewProjection, forgetting the last one's occluders and depth
+   */
+  void begin(const glm::mat4 &viewProjection);
+
+  /**
+   * @brief Queues an occluder's triangles, in object space with model as their transform. Nothing is copied, so
+   * positions and indices must stay put until render() returns.
+   */
+  void addOccluder(const glm::mat4 &model, std::span<const glm::vec3> positions, std::span<const uint32_t> indices);
+
+  /**
+   * @brief Rasterizes every occluder added since begin() into the depth buffer
+   */
+  void render();
+
+  /**
+   * @brief Whether a world-space sphere, center in xyz and radius in w, may be seen past what render() drew
+   */
+  [[nodiscard]] bool isVisible(const glm::vec4 &sphere) const;
+
+  /**
+   * @brief Removes from indices those whose sphere, spheres[index], is hidden, keeping the order of the rest
+   */
+  void filter(std::span<const glm::vec4> spheres, std::vector<uint32_t> &indices);
+
+  [[nodiscard]] const Stats &stats() const { return mStats; }
+
+  [[nodiscard]] Path path() const { return mPath; }
+
+  [[nodiscard]] uint32_t width() const { return mWidth; }
+
+  [[nodiscard]] uint32_t height() const { return mHeight; }
+
+  [[nodiscard]] uint32_t threadCount() const { return static_cast<uint32_t>(mWorkers.size()) + 1; }
+
+  /**
+   * @brief Times every path this CPU runs, on one thread and on all of them, on a street of occluderCount low-poly
+   * buildings and objectCount objects around them, and prints the results
+   */
+  static void benchmark(uint32_t occluderCount, uint32_t objectCount);
+
+  /// A triangle ready to rasterize, in pixels with depths from 0 to 1
+  struct Triangle {
+      glm::vec3 mEdges[3];  ///< a, b, c of a * x + b * y + c, at least 0 inside at pixel centers
+      glm::vec3 mDepth;     ///< The same for depth, as a plane
+      float     mMaxDepth;  ///< Of its corners, which the plane is clamped to
+      int32_t   mMinX, mMinY, mMaxX, mMaxY; ///< Pixels it may cover, max exclusive, inside the buffer
+  };
+
+private:
+  struct Occluder {
+      glm::mat4                  mTransform; ///< viewProjection * model
+      std::span<const glm::vec3> mPositions;
+      std::span<const uint32_t>  mIndices;
+      size_t                     mFirstTriangle; ///< Where its triangles go in mTriangles
+  };
+
+  Path                     mPath;
+  uint32_t                 mWidth;
+  uint32_t                 mHeight;
+  uint32_t                 mSubtilesX;
+  uint32_t                 mTilesX;
+  uint32_t                 mTilesY;
+  glm::mat4                mViewProjection{1.0f};
+  std::vector<Occluder>    mOccluders;
+  std::vector<Triangle>    mTriangles;      ///< Room for two per occluder triangle, which near clipping may make
+  std::vector<uint32_t>    mTriangleCounts; ///< How many of its room each occluder used
+  std::vector<std::vector<uint32_t>> mBins; ///< Indices into mTriangles overlapping each tile, in order
+  std::vector<float>       mReference;      ///< Per subtile, row by row
+  std::vector<float>       mWorking;
+  std::vector<uint32_t>    mMasks;
+  Stats                    mStats{};
+
+  /// The job being run; workers sleep until mGeneration moves past the last one they saw
+  std::vector<std::thread>                  mWorkers;
+  std::mutex                                mMutex;
+  std::condition_variable                   mWake;
+  std::condition_variable                   mDone;
+  uint64_t                                  mGeneration = 0;
+  bool                                      mStopping   = false;
+  const std::function<void(size_t index)>   *mJob       = nullptr;
+  size_t                                    mJobCount   = 0;
+  std::atomic<size_t>                       mNextIndex{0};
+  size_t                                    mIndicesDone = 0;
+  uint32_t                                  mActive      = 0; ///< Workers inside runJob()
+
+  /// Calls fn for every index in [0, count), spread across the threads; returns once all have
+  void parallelFor(size_t count, const std::function<void(size_t index)> &fn);
+
+  void workerLoop();
+
+  /// Takes indices until there are none left
+  void runJob();
+
+  /// Transforms, clips and sets up the triangles of one occluder
+  void setupOccluder(size_t occluder);
+
+  void rasterizeTile(size_t tile);
+
+  /// Folds a triangle covering coverage of a subtile, no nearer than depth, into it
+  void updateSubtile(uint32_t subtile, uint32_t coverage, float depth);
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_OCCLUSION_RASTERIZER_H__
@@ -34,6 +34,8 @@ struct PipelineConfigInfo {
     VkPipelineDepthStencilStateCreateInfo          mDepthStencilInfo;
     std::vector<VkDynamicState>                    mDynamicStateEnables;
     VkPipelineDynamicStateCreateInfo               mDynamicStateInfo;
+    std::vector<VkSpecializationMapEntry>          mSpecializationEntries{}; ///< Applied to both shader stages
+    std::vector<uint8_t>                           mSpecializationData{};
     VkPipelineLayout                               mPipelineLayout = nullptr;
     VkRenderPass                                   mRenderPass     = nullptr;
     uint32_t                                       mSubpass        = 0;
@@ -52,6 +54,8 @@ class VermicelliPipeline {
 
   void createShaderModule(const std::vector<char> &code, VkShaderModule *shaderModule);
 
+  friend class VermicelliComputePipeline;
+
 public:
   VermicelliPipeline(VermicelliDevice &device, const std::string &vertFilePath, const std::string &fragFilePath,
                      const PipelineConfigInfo &configInfo);
@@ -66,6 +70,30 @@ public:
 
   static void defaultPipelineConfigInfo(PipelineConfigInfo &configInfo);
 };
+
+/**
+ * A compute shader and the layout it is dispatched with; the layout belongs to the caller, as for graphics pipelines
+ */
+class VermicelliComputePipeline {
+  VermicelliDevice &mDevice;
+  VkPipeline       mComputePipeline;
+  VkShaderModule   mShaderModule;
+
+public:
+  /**
+   * @param specializationInfo Optional, for shaders that read specialization constants
+   */
+  VermicelliComputePipeline(VermicelliDevice &device, const std::string &compFilePath,
+                            VkPipelineLayout pipelineLayout, const VkSpecializationInfo *specializationInfo = nullptr);
+
+  ~VermicelliComputePipeline();
+
+  VermicelliComputePipeline(const VermicelliComputePipeline &) = delete;
+
+  VermicelliComputePipeline operator=(const VermicelliComputePipeline &) = delete;
+
+  void bind(VkCommandBuffer commandBuffer);
+};
 }
 
 #endif //__VERMICELLI_VERMICELLI_PIPELINE_H__
@@ -18,6 +18,9 @@
 #include "vermicelli_window.h"
 #include "vermicelli_device.h"
 #include "vermicelli_swap_chain.h"
+#include "vermicelli_command_recorder.h"
+#include "vermicelli_depth_pyramid.h"
+#include <array>
 #include <memory>
 #include <vector>
 #include <cassert>
@@ -30,9 +33,14 @@ class VermicelliRenderer {
   VermicelliDevice                     &mDevice;
   std::unique_ptr<VermicelliSwapChain> mSwapChain;
   std::vector<VkCommandBuffer>         mCommandBuffers;
+  VermicelliCommandRecorder            mRecorder; ///< Everything inside the swap chain render pass is recorded here
   uint32_t                             mCurrentImageIndex;
   int                                  mCurrentFrameIndex = 0;
   bool                                 mIsFrameStarted    = false;
+  uint64_t                             mFrameNumber       = 0; ///< Frames begun so far, and the frame timeline value of the latest
+  std::array<uint64_t, VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT> mSlotFrames{}; ///< Last frame recorded per slot
+  std::unique_ptr<VermicelliDepthPyramid>                         mDepthPyramid; ///< Of mSwapChain, if enabled
+  bool                                                            mSampledDepth = false; ///< See setDepthPyramid
 
   void createCommandBuffers();
 
@@ -40,6 +48,8 @@ class VermicelliRenderer {
 
   void recreateSwapChain();
 
+  void beginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass);
+
 public:
   explicit VermicelliRenderer(VermicelliWindow &window, VermicelliDevice &device, bool verbose);
 
@@ -53,10 +63,42 @@ public:
 
   void endFrame();
 
+  /**
+   * @brief Waits for every submitted frame and upload, then destroys whatever was waiting on them. Enough before
+   * tearing the renderer down, without draining queues nothing was submitted to.
+   */
+  void finishFrames();
+
+  /**
+   * @brief Begins the render pass for secondary command buffers only; draw through getRecorder() until it ends
+   */
   void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
+  /**
+   * @brief Begins the render pass again after it has ended in the same frame, keeping what was drawn so far, for
+   * secondary command buffers only
+   */
+  void resumeSwapChainRenderPass(VkCommandBuffer commandBuffer);
+
   void endSwapChainRenderPass(VkCommandBuffer commandBuffer) const;
 
+  /**
+   * @brief Keeps a depth pyramid of the swap chain, made again whenever the swap chain is. Call between frames.
+   * Switching it recreates the swap chain, whose depth is only stored and sampleable while the pyramid is on; the
+   * render pass stays compatible as long as the depth format does not change with it.
+   */
+  void setDepthPyramid(bool enabled);
+
+  /// Null unless enabled; a new one after the swap chain has been recreated
+  [[nodiscard]] const VermicelliDepthPyramid *getDepthPyramid() const { return mDepthPyramid.get(); }
+
+  /**
+   * @brief Reduces what the frame has drawn into the depth pyramid; call between ending the render pass and resuming
+   * it
+   * @param viewProjection What the frame was drawn with
+   */
+  void buildDepthPyramid(VkCommandBuffer commandBuffer, const glm::mat4 &viewProjection);
+
   [[nodiscard]] bool isFrameInProgress() const { return mIsFrameStarted; }
 
   [[nodiscard]] VkCommandBuffer getCommandBuffer() const {
@@ -64,6 +106,11 @@ public:
     return mCommandBuffers[mCurrentFrameIndex];
   }
 
+  [[nodiscard]] VermicelliCommandRecorder &getRecorder() { return mRecorder; }
+
+  /// Number of the frame being recorded, or of the last one submitted between frames
+  [[nodiscard]] uint64_t getFrameNumber() const { return mFrameNumber; }
+
   [[nodiscard]] int getFrameIndex() const {
     assert(mIsFrameStarted && "Cannot get command buffer if frame is not in progress.");
     return mCurrentFrameIndex;
@@ -72,6 +119,8 @@ public:
   [[nodiscard]] VkRenderPass getSwapChainRenderPass() const { return mSwapChain->getRenderPass(); }
 
   [[nodiscard]] float getAspectRatio() const { return mSwapChain->extentAspectRatio(); }
+
+  [[nodiscard]] VkExtent2D getExtent() const { return mSwapChain->getSwapChainExtent(); }
 };
 
 }
@@ -0,0 +1,122 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Device-resident per-object records, indexed by a stable slot and updated only when objects change
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_SCENE_BUFFER_H__
+#define __VERMICELLI_VERMICELLI_SCENE_BUFFER_H__
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#include <glm/glm.hpp>
+#include "vermicelli_buffer.h"
+#include "vermicelli_frame_allocator.h"
+#include "vermicelli_game_object.h"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vermicelli {
+
+/**
+ * One storage buffer of ObjectRecord, read by shaders through the slot each object is given. write() only queues a
+ * record; flush() copies every record queued since the last frame out of the frame allocator in one scattered copy,
+ * so a frame in which nothing moved uploads nothing. The capacity is fixed, since the buffer is bound in the global
+ * descriptor set and rewriting that while frames are in flight is not allowed.
+ */
+class VermicelliSceneBuffer {
+public:
+  using Slot = uint32_t;
+  static constexpr Slot     INVALID_SLOT     = UINT32_MAX;
+  static constexpr uint32_t DEFAULT_CAPACITY = 1 << 16;
+
+  /// Flags in ObjectRecord::mMesh.w
+  static constexpr uint32_t STATIC_FLAG = 1u << 0;
+
+  /// Matches ObjectRecord in simple_shader.vert, std430
+  struct ObjectRecord {
+      glm::vec4  mModelRows[3]; ///< Rows of the affine model matrix, the model's dequantization included
+      glm::vec4  mNormalScale;  ///< Object-space normals are scaled by xyz before mat3(model) to transform them
+      glm::vec4  mBounds;       ///< World-space bounding sphere, center and radius
+      glm::uvec4 mMesh;         ///< Level of detail, modelId(), game object ID and flags
+  };
+
+  VermicelliSceneBuffer(VermicelliDevice &device, uint32_t capacity = DEFAULT_CAPACITY, bool verbose = false);
+
+  VermicelliSceneBuffer(const VermicelliSceneBuffer &) = delete;
+
+  VermicelliSceneBuffer &operator=(const VermicelliSceneBuffer &) = delete;
+
+  /**
+   * @brief Hands out a slot for an object, reusing released ones first
+   */
+  Slot allocate();
+
+  /**
+   * @brief Returns a slot once its object is gone. The next record written to it is ordered after every frame that
+   * read the old one, so it can be handed out again right away.
+   */
+  void release(Slot slot);
+
+  /**
+   * @brief Queues object's current transform, bounds and LOD for its slot. The last write to a slot before flush()
+   * wins.
+   */
+  void write(Slot slot, VermicelliGameObject &object);
+
+  /**
+   * @brief Copies the queued records into the buffer. Call outside a render pass, before anything this frame reads
+   * the buffer.
+   */
+  void flush(VkCommandBuffer commandBuffer, VermicelliFrameAllocator &frameAllocator);
+
+  /**
+   * @brief ID for a model, never given to another one; entries of models that have been destroyed are dropped by
+   * flush()
+   */
+  uint32_t modelId(const std::shared_ptr<VermicelliModel> &model);
+
+  [[nodiscard]] VkDescriptorBufferInfo descriptorInfo() { return mBuffer->descriptorInfo(); }
+
+  [[nodiscard]] VkBuffer buffer() const { return mBuffer->getBuffer(); }
+
+  [[nodiscard]] uint32_t capacity() const { return mCapacity; }
+
+  /// Slots handed out and not released
+  [[nodiscard]] uint32_t size() const { return mNextSlot - static_cast<uint32_t>(mFreeSlots.size()); }
+
+  /// Bytes copied by the last flush()
+  [[nodiscard]] VkDeviceSize lastUploadBytes() const { return mLastUploadBytes; }
+
+private:
+  /// Held weakly, so an address reused by a later model is not taken for the one that is gone
+  struct ModelEntry {
+      std::weak_ptr<VermicelliModel> mModel;
+      uint32_t                       mId;
+  };
+
+  VermicelliDevice                                        &mDevice;
+  bool                                                    mVerbose;
+  uint32_t                                                mCapacity;
+  std::unique_ptr<VermicelliBuffer>                       mBuffer;
+  Slot                                                    mNextSlot        = 0;
+  std::vector<Slot>                                       mFreeSlots{};
+  std::vector<std::pair<Slot, ObjectRecord>>              mPending{};
+  std::unordered_map<const VermicelliModel *, ModelEntry> mModelIds{};
+  uint32_t                                                mNextModelId     = 0;
+  VkDeviceSize                                            mLastUploadBytes = 0;
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_SCENE_BUFFER_H__
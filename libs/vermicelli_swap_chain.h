@@ -26,9 +26,13 @@ class VermicelliSwapChain {
 public:
   static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
-  VermicelliSwapChain(VermicelliDevice &deviceRef, VkExtent2D windowExtent, bool verbose);
+  /**
+   * @param sampledDepth Keep depth after the render pass and let shaders sample it, as the depth pyramid does;
+   * otherwise it is discarded at the end of the pass
+   */
+  VermicelliSwapChain(VermicelliDevice &deviceRef, VkExtent2D windowExtent, bool verbose, bool sampledDepth);
 
-  VermicelliSwapChain(VermicelliDevice &deviceRef, VkExtent2D windowExtent, bool verbose,
+  VermicelliSwapChain(VermicelliDevice &deviceRef, VkExtent2D windowExtent, bool verbose, bool sampledDepth,
                       std::shared_ptr<VermicelliSwapChain> previous);
 
   ~VermicelliSwapChain();
@@ -41,10 +45,23 @@ public:
 
   VkRenderPass getRenderPass() { return mRenderPass; }
 
+  /// Compatible with getRenderPass(), but loads both attachments instead of clearing them, to carry on drawing.
+  /// VK_NULL_HANDLE unless depth is sampled, since depth is not kept otherwise.
+  VkRenderPass getResumeRenderPass() { return mResumeRenderPass; }
+
   VkImageView getImageView(int index) { return mSwapChainImageViews[index]; }
 
   size_t imageCount() { return mSwapChainImages.size(); }
 
+  /// Left in DEPTH_STENCIL_ATTACHMENT_OPTIMAL by the render pass; the view only has the depth aspect, for sampling
+  VkImage getDepthImage(int index) { return mDepthImages[index]; }
+
+  [[nodiscard]] bool isDepthSampled() const { return mSampledDepth; }
+
+  VkImageView getDepthImageView(int index) { return mDepthImageViews[index]; }
+
+  VkFormat getDepthFormat() { return mSwapChainDepthFormat; }
+
   VkFormat getSwapChainImageFormat() { return mSwapChainImageFormat; }
 
   VkExtent2D getSwapChainExtent() { return mSwapChainExtent; }
@@ -59,7 +76,11 @@ public:
 
   VkResult acquireNextImage(uint32_t *imageIndex);
 
-  VkResult submitCommandBuffers(const VkCommandBuffer *buffers, const uint32_t *imageIndex);
+  /**
+   * @brief Submits the frame's command buffers and presents imageIndex
+   * @param frame Frame number the device's frame timeline reaches once the submission has executed
+   */
+  VkResult submitCommandBuffers(const VkCommandBuffer *buffers, const uint32_t *imageIndex, uint64_t frame);
 
   [[nodiscard]] bool compareSwapFormats(const VermicelliSwapChain &swapChain) const {
     return swapChain.mSwapChainDepthFormat == mSwapChainDepthFormat &&
@@ -96,12 +117,13 @@ private:
 
   std::vector<VkFramebuffer> mSwapChainFrameBuffers;
   VkRenderPass               mRenderPass;
+  VkRenderPass               mResumeRenderPass = VK_NULL_HANDLE;
 
-  std::vector<VkImage>        mDepthImages;
-  std::vector<VkDeviceMemory> mDepthImageMemoryVec;
-  std::vector<VkImageView>    mDepthImageViews;
-  std::vector<VkImage>        mSwapChainImages;
-  std::vector<VkImageView>    mSwapChainImageViews;
+  std::vector<VkImage>                               mDepthImages;
+  std::vector<VermicelliMemoryAllocator::Allocation> mDepthImageMemoryVec;
+  std::vector<VkImageView>                           mDepthImageViews;
+  std::vector<VkImage>                               mSwapChainImages;
+  std::vector<VkImageView>                           mSwapChainImageViews;
 
   VermicelliDevice &mDevice;
   VkExtent2D       mWindowExtent;
@@ -111,10 +133,10 @@ private:
 
   std::vector<VkSemaphore> mImageAvailableSemaphores;
   std::vector<VkSemaphore> mRenderFinishedSemaphores;
-  std::vector<VkFence>     mInFlightFences;
-  std::vector<VkFence>     mImagesInFlight;
+  std::vector<uint64_t>    mImageFrames;      ///< Last frame rendered into each image, 0 if none
   size_t                   mCurrentFrame = 0;
   bool                     mVerbose;
+  bool                     mSampledDepth;
 };
 
 }  // namespace vermicelli
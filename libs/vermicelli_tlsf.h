@@ -0,0 +1,87 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Two-level segregated fit allocator over an abstract range of bytes
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_TLSF_H__
+#define __VERMICELLI_VERMICELLI_TLSF_H__
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace vermicelli {
+
+/**
+ * Hands out offsets into a range it never touches, so it can manage device memory. Free ranges are kept in lists
+ * bucketed by a power of two (first level) and sixteen linear steps within it (second level); two bitmaps find the
+ * first non-empty bucket that is large enough in constant time. Ranges remember their physical neighbours, so freeing
+ * merges with adjacent free ranges immediately.
+ */
+class VermicelliTlsf {
+public:
+  static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+  explicit VermicelliTlsf(uint64_t size);
+
+  /**
+   * @param offset Receives the aligned offset of the allocation
+   * @return A node to pass to free(), or NO_NODE if no free range is large enough
+   */
+  uint32_t allocate(uint64_t size, uint64_t alignment, uint64_t &offset);
+
+  void free(uint32_t node);
+
+  [[nodiscard]] uint64_t size() const { return mSize; }
+
+  [[nodiscard]] uint64_t used() const { return mUsed; }
+
+  [[nodiscard]] uint32_t allocationCount() const { return mAllocationCount; }
+
+  [[nodiscard]] bool empty() const { return mAllocationCount == 0; }
+
+private:
+  static constexpr uint32_t SL_BITS    = 4;
+  static constexpr uint32_t SL_COUNT   = 1 << SL_BITS;
+  static constexpr uint32_t SMALL_BITS = 8;                   ///< Sizes below 256 share the first level
+  static constexpr uint64_t SMALL_SIZE = 1ull << SMALL_BITS;
+  static constexpr uint32_t FL_COUNT   = 64 - SMALL_BITS + 1;
+
+  struct Node {
+      uint64_t mOffset;
+      uint64_t mSize;
+      uint32_t mPreviousPhysical;
+      uint32_t mNextPhysical;
+      uint32_t mPreviousFree;
+      uint32_t mNextFree;
+      bool     mFree;
+  };
+
+  uint64_t                                           mSize;
+  uint64_t                                           mUsed            = 0;
+  uint32_t                                           mAllocationCount = 0;
+  std::vector<Node>                                  mNodes{};
+  std::vector<uint32_t>                              mUnusedNodes{};
+  uint64_t                                           mFirstLevelMap   = 0;
+  std::array<uint32_t, FL_COUNT>                     mSecondLevelMaps{};
+  std::array<std::array<uint32_t, SL_COUNT>, FL_COUNT> mHeads{};
+
+  static void mapping(uint64_t size, uint32_t &firstLevel, uint32_t &secondLevel);
+
+  uint32_t createNode(uint64_t offset, uint64_t size, uint32_t previousPhysical, uint32_t nextPhysical);
+
+  void insertFree(uint32_t node);
+
+  void removeFree(uint32_t node);
+
+  uint32_t findFree(uint64_t size);
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_TLSF_H__
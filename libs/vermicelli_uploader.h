@@ -0,0 +1,141 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Copies data into device-local buffers on the transfer queue without stalling the caller or the GPU
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+
+#ifndef __VERMICELLI_VERMICELLI_UPLOADER_H__
+#define __VERMICELLI_VERMICELLI_UPLOADER_H__
+#pragma once
+
+#include "vermicelli_frame_timeline.h"
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vermicelli {
+
+class VermicelliDevice;
+
+class VermicelliBuffer;
+
+/**
+ * Uploads are staged in a persistently mapped ring and collected in the open batch, which goes out on submit() as one
+ * command buffer with a single vkCmdCopyBuffer per destination buffer. Batches signal a VermicelliFrameTimeline of
+ * their own with their serial, the same kind of counter frames use, and ring space is reclaimed once it passes the
+ * batch that used it; when the ring is full the uploader submits and waits for the oldest batch instead of
+ * overwriting data a copy may still read. The caller only blocks when it asks to or when the ring is exhausted. On
+ * devices with a separate transfer family the batch ends by releasing the written ranges, and a small graphics-queue
+ * submission waits on a semaphore to acquire them; otherwise a barrier at the end of the batch makes the writes
+ * visible to later graphics work. Either way the last submission of a batch is on the graphics queue, and it is the
+ * one that advances the counter.
+ *
+ * Batches are submitted from the calling thread, which has to be the one submitting frames.
+ */
+class VermicelliUploader {
+public:
+  /// Batches complete in submission order, so a ticket is the serial of the batch holding the upload
+  using Ticket = uint64_t;
+
+  VermicelliUploader(VermicelliDevice &device, bool verbose = false);
+
+  ~VermicelliUploader();
+
+  VermicelliUploader(const VermicelliUploader &) = delete;
+
+  VermicelliUploader &operator=(const VermicelliUploader &) = delete;
+
+  /**
+   * @brief Stages size bytes of data right away and queues a copy of them into dstBuffer at dstOffset. Uploads larger
+   * than the ring get a staging buffer of their own.
+   * @return Ticket that is complete once the data can be used by graphics work submitted afterwards
+   */
+  Ticket upload(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void *data, VkDeviceSize size);
+
+  /**
+   * @brief Submits the open batch, if it holds anything
+   */
+  void submit();
+
+  /**
+   * @brief Checks without blocking. Submits the ticket's batch first if it is still open.
+   */
+  bool isComplete(Ticket ticket);
+
+  void wait(Ticket ticket);
+
+  /**
+   * @brief Waits for every upload made so far
+   */
+  void waitIdle();
+
+  [[nodiscard]] bool hasTransferQueue() const { return mTransferFamily != mGraphicsFamily; }
+
+  /// The ticket of the newest upload, complete or not; waiting for it covers every upload made so far
+  [[nodiscard]] Ticket lastTicket() const { return mNextSerial - 1; }
+
+private:
+  static constexpr VkDeviceSize RING_SIZE      = 32 << 20;
+  static constexpr VkDeviceSize RING_ALIGNMENT = 16;
+
+  struct Copy {
+      VkBuffer     mSrcBuffer;
+      VkBuffer     mDstBuffer;
+      VkBufferCopy mRegion;
+  };
+
+  struct Batch {
+      VkCommandBuffer                                mTransferCommands = VK_NULL_HANDLE;
+      VkCommandBuffer                                mAcquireCommands  = VK_NULL_HANDLE;
+      VkSemaphore                                    mReleased         = VK_NULL_HANDLE;
+      Ticket                                         mSerial           = 0;
+      std::vector<Copy>                              mCopies{};
+      std::vector<VkBufferMemoryBarrier>             mBarriers{};
+      std::vector<std::unique_ptr<VermicelliBuffer>> mStaging{};   ///< Uploads too large for the ring
+      VkDeviceSize                                   mRingBytes = 0; ///< Ring space held, including skipped tails
+      VkDeviceSize                                   mRingEnd   = 0; ///< Ring head after this batch's last upload
+  };
+
+  VermicelliDevice                    &mDevice;
+  bool                                mVerbose;
+  uint32_t                            mGraphicsFamily;
+  uint32_t                            mTransferFamily;
+  VkQueue                             mTransferQueue;
+  VkCommandPool                       mTransferPool = VK_NULL_HANDLE;
+  VkCommandPool                       mAcquirePool  = VK_NULL_HANDLE;
+  VermicelliFrameTimeline             mTimeline;                     ///< Reaches a batch's serial once it is done
+  std::vector<std::unique_ptr<Batch>> mBatches{};                    ///< Submitted, oldest first
+  std::vector<std::unique_ptr<Batch>> mIdleBatches{};
+  std::unique_ptr<Batch>              mOpenBatch{};
+  Ticket                              mNextSerial      = 1;
+  Ticket                              mCompletedSerial = 0;
+  std::unique_ptr<VermicelliBuffer>   mRing;
+  VkDeviceSize                        mRingHead        = 0;
+  VkDeviceSize                        mRingTail        = 0;
+  VkDeviceSize                        mRingUsed        = 0;
+
+  std::unique_ptr<Batch> createBatch();
+
+  void destroyBatch(Batch &batch);
+
+  /**
+   * @brief Carves size bytes out of the ring for the open batch, wrapping to the start if the end is too short
+   * @return false if the free space is not large enough right now
+   */
+  bool reserveRing(VkDeviceSize size, VkDeviceSize &offset);
+
+  /**
+   * @brief Retires submitted batches the timeline has passed, recycling their command buffers
+   * @param block Wait for batches up to and including this serial instead of only polling
+   */
+  void retire(Ticket block);
+};
+
+}
+
+#endif //__VERMICELLI_VERMICELLI_UPLOADER_H__
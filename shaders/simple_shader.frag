@@ -18,11 +18,6 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
   int num_lights;
 } ubo;
 
-layout(push_constant) uniform Push {
-  mat4 modelMatrix;// projection * view * modelMatrix
-  mat4 normalMatrix;
-} push;
-
 void main() {
   vec3 diffuseLight = ubo.ambientColor.xyz * ubo.ambientColor.w;
   vec3 specularLight = vec3(0.0);
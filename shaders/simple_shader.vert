@@ -1,10 +1,17 @@
 #version 460
 
+// Set for models uploaded as VermicelliModel::CompactVertex; positions then arrive in [0, 1] and the object's model
+// matrix already includes the dequantization
+layout (constant_id = 0) const bool COMPACT_VERTICES = false;
+
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 color;
-layout (location = 2) in vec3 normal;
+layout (location = 2) in vec4 normal;// xyz, or an octahedral-encoded xy for compact vertices
 layout (location = 3) in vec2 uv;
 
+// Per instance, from binding 1; every object is drawn as an instance of its model's batch
+layout (location = 4) in uint objectSlot;
+
 // No correlation between in/out locations
 layout (location = 0) out vec3 fragColor;
 layout (location = 1) out vec3 fragPosWorld;
@@ -23,17 +30,36 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
   int num_lights;
 } ubo;
 
-layout(push_constant) uniform Push {
-  mat4 modelMatrix;// projection * view * modelMatrix
-  mat4 normalMatrix;
-} push;
+// VermicelliSceneBuffer::ObjectRecord
+struct ObjectRecord {
+  vec4 modelRows[3];// rows of the affine model matrix
+  vec4 normalScale;// object-space normals are scaled by xyz before mat3(model)
+  vec4 bounds;
+  uvec4 mesh;
+};
+layout(std430, set = 0, binding = 1) readonly buffer SceneBuffer {
+  ObjectRecord objects[];
+} scene;
+
+vec3 decodeOctahedral(vec2 encoded) {
+  vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return n;
+}
 
 void main() {
-  vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+  ObjectRecord object = scene.objects[objectSlot];
+  vec4 positionObject = vec4(position, 1.0);
+  vec4 positionWorld = vec4(dot(object.modelRows[0], positionObject), dot(object.modelRows[1], positionObject),
+                            dot(object.modelRows[2], positionObject), 1.0);
   // Remember that order matters when it comes to matrix multiplication!
   gl_Position = ubo.projectionMatrix * ubo.viewMatrix * positionWorld;
 
-  fragNormalWorld = normalize(mat3(push.normalMatrix) * normal);
+  vec3 normalObject = COMPACT_VERTICES ? decodeOctahedral(normal.xy) : normal.xyz;
+  mat3 model = transpose(mat3(object.modelRows[0].xyz, object.modelRows[1].xyz, object.modelRows[2].xyz));
+  fragNormalWorld = normalize(model * (object.normalScale.xyz * normalObject));
   fragPosWorld = positionWorld.xyz;
   fragColor = color;
 }
\ No newline at end of file
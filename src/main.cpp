@@ -8,23 +8,49 @@
 
 #define APP_NAME "Vermicelli"
 
+#include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 #include <vector>
 #include <getopt.h>
 
 #include "vermicelli_application.h"
+#include "vermicelli_frustum_culler.h"
 #include "vermicelli_functions.h"
+#include "vermicelli_mesh_cache.h"
+#include "vermicelli_model.h"
+#include "vermicelli_occlusion_rasterizer.h"
 
 using std::cout, std::cerr, std::endl;
 
 static int           verbose_flag   = 0;
+static int           compact_flag   = 0;
+static int           gpu_cull_flag  = 0;
+static int           occlusion_flag = 0;
+static int           cpu_occl_flag  = 0;
+static int           bench_flag     = 0;
+static int           occ_bench_flag = 0;
+static int           vtx_bench_flag = 0;
+static float         lod_bias       = 0.0f;
+static std::string   weld_bench     = "";
+static std::string   cache_bench    = "";
 static struct option long_options[] = {
         /* These options set a flag. */
         {"verbose", no_argument, &verbose_flag, 1},
         {"brief",   no_argument, &verbose_flag, 0},
+        {"compact", no_argument, &compact_flag, 1},
+        {"gpu-culling", no_argument, &gpu_cull_flag, 1},
+        {"occlusion-culling", no_argument, &occlusion_flag, 1},
+        {"cpu-occlusion", no_argument, &cpu_occl_flag, 1},
+        {"benchmark-culling", no_argument, &bench_flag, 1},
+        {"benchmark-occlusion", no_argument, &occ_bench_flag, 1},
+        {"benchmark-vertex-encoding", no_argument, &vtx_bench_flag, 1},
         /* These options don’t set a flag.
         We distinguish them by their indices. */
+        {"lod-bias", required_argument, 0,      'l'},
+        {"benchmark-welding", required_argument, 0, 'w'},
+        {"benchmark-mesh-cache", required_argument, 0, 'm'},
         {"help",    no_argument, 0,             'h'},
         //{"append",  no_argument,       0, 'b'},
         {0, 0,                   0,             0}
@@ -59,18 +85,62 @@ int main(int argc, char *argv[]) {
       case 'h':
         vermicelli::helpMenu();
         return EXIT_SUCCESS;
+      case 'l':
+        lod_bias = std::strtof(optarg, nullptr);
+        break;
+      case 'w':
+        weld_bench = optarg;
+        break;
+      case 'm':
+        cache_bench = optarg;
+        break;
+      case ':':
+        cerr << "Option " << argv[optind - 1] << " requires an argument." << endl << endl;
+        vermicelli::helpMenu();
+        return EXIT_FAILURE;
       case '?':
-        cout << "Option -" << static_cast<char>(optopt) << " is unknown." << endl
-             << "Please see the help menu (-h) or the Vermicelli man pages for help" << endl;
+        /// optopt is 0 for unknown long options, so the argument itself is reported
+        cerr << "Option " << argv[optind - 1] << " is unknown." << endl << endl;
+        vermicelli::helpMenu();
         return EXIT_FAILURE;
       default:
         break;
     }
   }
 
+  if (bench_flag) {
+    /// Needs no window or device, so it runs before either is created
+    vermicelli::VermicelliFrustumCuller::benchmark(100000);
+    return EXIT_SUCCESS;
+  }
+  if (occ_bench_flag) {
+    vermicelli::VermicelliOcclusionRasterizer::benchmark(1000, 10000);
+    return EXIT_SUCCESS;
+  }
+  if (vtx_bench_flag) {
+    vermicelli::VermicelliModel::benchmarkVertexEncoding(1000000);
+    return EXIT_SUCCESS;
+  }
+  if (!weld_bench.empty() || !cache_bench.empty()) {
+    try {
+      if (!weld_bench.empty()) {
+        vermicelli::VermicelliModel::Builder::benchmarkWelding(weld_bench);
+      }
+      if (!cache_bench.empty()) {
+        vermicelli::VermicelliMeshCache::benchmark(cache_bench);
+      }
+    } catch (const std::exception &exception) {
+      cerr << exception.what() << endl;
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
   SDL2pp::SDL sdl(SDL_INIT_VIDEO);
 
-  vermicelli::Application app{static_cast<bool>(verbose_flag)};
+  vermicelli::Application app{static_cast<bool>(verbose_flag), static_cast<bool>(compact_flag), lod_bias,
+                              static_cast<bool>(gpu_cull_flag), static_cast<bool>(occlusion_flag),
+                              static_cast<bool>(cpu_occl_flag)};
 
   try {
     app.run();
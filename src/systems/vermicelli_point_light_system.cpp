@@ -69,11 +69,17 @@ void VermicelliPointLightSystem::createPipeline(VkRenderPass renderPass) {
 }
 
 void VermicelliPointLightSystem::render(FrameInfo &frameInfo) {
-  mPipeline->bind(frameInfo.mCommandBuffer);
+  /// A handful of lights, one secondary on the calling thread
+  frameInfo.mRecorder.record(frameInfo.mCommandBuffer, 1, 1, [&](VkCommandBuffer commandBuffer, size_t, size_t) {
+    recordLights(frameInfo, commandBuffer);
+  });
+}
+
+void VermicelliPointLightSystem::recordLights(const FrameInfo &frameInfo, VkCommandBuffer commandBuffer) {
+  mPipeline->bind(commandBuffer);
 
-  vkCmdBindDescriptorSets(frameInfo.mCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
-                          &frameInfo.mGlobalDescriptorSet, 0,
-                          nullptr);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
+                          &frameInfo.mGlobalDescriptorSet, 1, &frameInfo.mGlobalUboOffset);
 
   for (auto &kv: frameInfo.mGameObjects) {
     auto &obj = kv.second;
@@ -85,14 +91,14 @@ void VermicelliPointLightSystem::render(FrameInfo &frameInfo) {
     push.radius   = obj.mTransform.mScale.x;
 
     vkCmdPushConstants(
-            frameInfo.mCommandBuffer,
+            commandBuffer,
             mPipelineLayout,
             VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
             0,
             sizeof(PointLightPushConstants),
             &push
                       );
-    vkCmdDraw(frameInfo.mCommandBuffer, 6, 1, 0, 0);
+    vkCmdDraw(commandBuffer, 6, 1, 0, 0);
   }
 
 
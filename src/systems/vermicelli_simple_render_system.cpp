@@ -9,43 +9,92 @@
 
 #include "systems/vermicelli_simple_render_system.h"
 #include "vermicelli_functions.h"
+#include "vermicelli_geometry_arena.h"
+#include "vermicelli_deletion_queue.h"
 #include <glm/gtc/constants.hpp> // PI
 #include <stdexcept>
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <tuple>
 
 namespace vermicelli {
 
-struct SimplePushConstantData {
-    glm::mat4 modelMatrix{1.f};
-    glm::mat4 normalMatrix{1.f};
-};
+/// On-screen error, in pixels, that a level of detail may introduce at a bias of 0
+static constexpr float LOD_PIXEL_ERROR = 1.0f;
+
+/// Fraction of the threshold an object must move past before its LOD changes
+static constexpr float LOD_HYSTERESIS = 0.25f;
+
+/// Fewest batches worth a secondary command buffer of their own, below it recording stays on fewer threads
+static constexpr size_t RECORD_CHUNK = 64;
+
+/// Vertex binding the instance data is read from, after the model's vertices at binding 0
+static constexpr uint32_t INSTANCE_BINDING = 1;
+
+/// First vertex input location of the instance data, after the model's vertex attributes
+static constexpr uint32_t INSTANCE_LOCATION = 4;
+
+/// Per-instance vertex attribute; every object is drawn as one instance of the batch of its model and LOD, and its
+/// transform is read from the scene buffer through its slot
+using InstanceData = VermicelliSceneBuffer::Slot;
+
+/**
+ * @brief Adds the instance-rate binding to a pipeline that already has the vertex input of a model
+ */
+static void addInstanceInput(PipelineConfigInfo &config) {
+  config.mBindingDescriptions.push_back({INSTANCE_BINDING, sizeof(InstanceData), VK_VERTEX_INPUT_RATE_INSTANCE});
+  config.mAttributeDescriptions.push_back({INSTANCE_LOCATION, INSTANCE_BINDING, VK_FORMAT_R32_UINT, 0});
+}
 
 VermicelliSimpleRenderSystem::VermicelliSimpleRenderSystem(VermicelliDevice &device, VkRenderPass renderPass,
                                                            VkDescriptorSetLayout globalSetLayout,
                                                            const bool verbose) : mVerbose(verbose), mDevice(device) {
   createPipelineLayout(globalSetLayout);
   createPipeline(renderPass);
+  createStaticCommandBuffers();
 }
 
 VermicelliSimpleRenderSystem::~VermicelliSimpleRenderSystem() {
+  vkDestroyCommandPool(mDevice.device(), mStaticPool, nullptr);
   vkDestroyPipelineLayout(mDevice.device(), mPipelineLayout, nullptr);
 }
 
-void VermicelliSimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
+void VermicelliSimpleRenderSystem::createStaticCommandBuffers() {
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = mDevice.findPhysicalQueueFamilies().mGraphicsFamily;
+  poolInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // Re-recorded one at a time
+  if (vkCreateCommandPool(mDevice.device(), &poolInfo, nullptr, &mStaticPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create static command pool!");
+  }
 
-  VkPushConstantRange pushConstantRange{};
-  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-  pushConstantRange.offset     = 0;
-  pushConstantRange.size       = sizeof(SimplePushConstantData);
+  std::array<VkCommandBuffer, VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT> commandBuffers{};
+  VkCommandBufferAllocateInfo                                            allocateInfo{};
+  allocateInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+  allocateInfo.commandPool        = mStaticPool;
+  allocateInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+  if (vkAllocateCommandBuffers(mDevice.device(), &allocateInfo, commandBuffers.data()) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate static command buffers!");
+  }
+  for (size_t i = 0; i < commandBuffers.size(); ++i) {
+    mStaticCommands[i].mCommandBuffer = commandBuffers[i];
+  }
+}
 
+void VermicelliSimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
   std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
 
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipelineLayoutInfo.setLayoutCount         = static_cast<uint32_t>(descriptorSetLayouts.size());
   pipelineLayoutInfo.pSetLayouts            = descriptorSetLayouts.data();
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges    = &pushConstantRange;
+  pipelineLayoutInfo.pushConstantRangeCount = 0; // Transforms come in as instance data
+  pipelineLayoutInfo.pPushConstantRanges    = nullptr;
 
   if (vkCreatePipelineLayout(mDevice.device(), &pipelineLayoutInfo, nullptr, &mPipelineLayout) != VK_SUCCESS) {
     throw std::runtime_error("failed to create pipeline layout!");
@@ -59,29 +108,357 @@ void VermicelliSimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
   VermicelliPipeline::defaultPipelineConfigInfo(pipelineConfig);
   pipelineConfig.mRenderPass     = renderPass;
   pipelineConfig.mPipelineLayout = mPipelineLayout;
+  addInstanceInput(pipelineConfig);
   mPipeline = std::make_unique<VermicelliPipeline>(mDevice, "shaders/simple_shader.vert.spv",
                                                    "shaders/simple_shader.frag.spv", pipelineConfig);
+
+  VkBool32           compactVertices = VK_TRUE;
+  PipelineConfigInfo compactConfig{};
+  VermicelliPipeline::defaultPipelineConfigInfo(compactConfig);
+  compactConfig.mRenderPass            = renderPass;
+  compactConfig.mPipelineLayout        = mPipelineLayout;
+  compactConfig.mAttributeDescriptions = VermicelliModel::CompactVertex::getAttributeDescriptions();
+  compactConfig.mBindingDescriptions   = VermicelliModel::CompactVertex::getBindingDescriptions();
+  compactConfig.mSpecializationEntries = {{0, 0, sizeof(VkBool32)}}; // COMPACT_VERTICES
+  compactConfig.mSpecializationData.resize(sizeof(VkBool32));
+  std::memcpy(compactConfig.mSpecializationData.data(), &compactVertices, sizeof(VkBool32));
+  addInstanceInput(compactConfig);
+  mCompactPipeline = std::make_unique<VermicelliPipeline>(mDevice, "shaders/simple_shader.vert.spv",
+                                                          "shaders/simple_shader.frag.spv", compactConfig);
 }
 
-void VermicelliSimpleRenderSystem::renderGameObjects(FrameInfo &frameInfo) {
-  mPipeline->bind(frameInfo.mCommandBuffer);
+/**
+ * @brief World-space bounding sphere of obj, center in xyz and radius in w; the same one the scene buffer records
+ */
+static glm::vec4 worldSphere(const VermicelliGameObject &obj) {
+  const VermicelliModel &model  = *obj.mModel;
+  glm::vec3             center  = obj.mTransform.mat4() * glm::vec4(model.boundingCenter(), 1.0f);
+  glm::vec3             scale   = glm::abs(obj.mTransform.mScale);
+  return {center, model.boundingRadius() * std::max(scale.x, std::max(scale.y, scale.z))};
+}
 
-  vkCmdBindDescriptorSets(frameInfo.mCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
-                          &frameInfo.mGlobalDescriptorSet, 0,
-                          nullptr);
+uint32_t VermicelliSimpleRenderSystem::selectLod(const FrameInfo &frameInfo, const VermicelliGameObject &obj,
+                                                 const glm::vec4 &sphere) const {
+  const VermicelliModel &model = *obj.mModel;
+  if (model.lodCount() <= 1) {
+    return 0;
+  }
+
+  float     radius   = sphere.w;
+  glm::vec3 eye      = frameInfo.mCamera.getInverseView()[3];
+  float     distance = glm::length(glm::vec3(sphere) - eye) - radius;
+  if (distance <= 0.0f) {
+    return 0; // Inside the bounds, anything but the full mesh would show
+  }
 
+  /// projection[1][1] is cot(fovY / 2), so this is how many pixels one world unit covers at that distance
+  float pixelsPerUnit = frameInfo.mCamera.getProjection()[1][1] * 0.5f * static_cast<float>(frameInfo.mExtent.height) /
+                        distance;
+  auto  pixelError    = [&](uint32_t level) { return model.lod(level).mError * radius * pixelsPerUnit; };
+  float threshold     = LOD_PIXEL_ERROR * std::exp2(mLodBias);
+
+  uint32_t lod = std::min(obj.mLod, model.lodCount() - 1);
+  while (lod > 0 && pixelError(lod) > threshold * (1.0f + LOD_HYSTERESIS)) {
+    --lod;
+  }
+  while (lod + 1 < model.lodCount() && pixelError(lod + 1) < threshold * (1.0f - LOD_HYSTERESIS)) {
+    ++lod;
+  }
+  return lod;
+}
+
+void VermicelliSimpleRenderSystem::update(FrameInfo &frameInfo) {
+  /// Residency asks the uploader, which is not for worker threads, so the draw lists are gathered up front. LODs are
+  /// picked here too, since objects are batched by them and the scene buffer records them.
+  mDrawList.clear();
+  mStaticList.clear();
+  mCullList.clear();
+  mCullSpheres.clear();
+  mCandidates.clear();
+  mCandidateSpheres.clear();
+  mFrustumCuller.clear();
+  mStaticKey = 0;
   for (auto &kv: frameInfo.mGameObjects) {
     auto &obj = kv.second;
-    if (obj.mModel == nullptr) continue;
-    SimplePushConstantData push{};
-    push.modelMatrix  = obj.mTransform.mat4();
-    push.normalMatrix = obj.mTransform.normalMatrix();
-
-    vkCmdPushConstants(frameInfo.mCommandBuffer, mPipelineLayout,
-                       VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData),
-                       &push);
-    obj.mModel->bind(frameInfo.mCommandBuffer);
-    obj.mModel->draw(frameInfo.mCommandBuffer);
+    if (obj.mModel == nullptr || !obj.mModel->isResident()) continue;
+    glm::vec4 sphere = worldSphere(obj);
+    uint32_t  lod    = selectLod(frameInfo, obj, sphere);
+    if (obj.mSceneSlot == VermicelliSceneBuffer::INVALID_SLOT) {
+      obj.acquireSceneSlot(frameInfo.mScene);
+    }
+    if (obj.mSceneDirty || lod != obj.mLod) {
+      obj.mLod = lod;
+      frameInfo.mScene.write(obj.mSceneSlot, obj);
+      obj.mSceneDirty = false;
+    }
+
+    if (mCulling != nullptr && obj.mModel->hasIndexBuffer()) {
+      mCullList.push_back(&obj); // Culled by the GPU instead
+      mCullSpheres.push_back(sphere);
+      continue;
+    }
+    mCandidates.push_back(&obj);
+    mCandidateSpheres.push_back(sphere);
+    mFrustumCuller.add(sphere);
+  }
+
+  /// Static objects are culled too; the recording of them is only redone when the set that survives changes
+  auto view = VermicelliFrustumCuller::View::fromCamera(frameInfo.mCamera, frameInfo.mExtent.height, mMinPixels);
+  mFrustumCuller.cull(view, mVisible);
+  if (mOcclusion != nullptr) {
+    cullOccluded(frameInfo);
+  }
+  for (uint32_t index: mVisible) {
+    auto *obj = mCandidates[index];
+    if (!obj->mStatic) {
+      mDrawList.push_back(obj);
+      continue;
+    }
+    /// Transforms live in the scene buffer, so only what decides the batches goes into the recording's key
+    hashCombine(mStaticKey, obj->getID(), obj->mModel.get(), obj->mLod, obj->mSceneSlot);
+    mStaticList.push_back(obj);
+  }
+  buildBatches(mDrawList, mBatches);
+
+  if (mCulling != nullptr) {
+    buildBatches(mCullList, mCullBatches);
+    mCullInstances.resize(mCullList.size());
+    writeInstances(mCullList, mCullBatches, 0, mCullBatches.size(), mCullInstances.data());
+  }
+}
+
+void VermicelliSimpleRenderSystem::cullOccluded(const FrameInfo &frameInfo) {
+  /// Kept at the default width with the window's aspect, so the depth buffer's pixels stay square
+  constexpr uint32_t width  = 320;
+  const uint32_t     height = std::max(1u, width * frameInfo.mExtent.height / std::max(1u, frameInfo.mExtent.width));
+  const uint32_t     tiles  = (height + VermicelliOcclusionRasterizer::TILE_HEIGHT - 1) /
+                              VermicelliOcclusionRasterizer::TILE_HEIGHT;
+  if (mOcclusion->height() != tiles * VermicelliOcclusionRasterizer::TILE_HEIGHT) {
+    mOcclusion = std::make_unique<VermicelliOcclusionRasterizer>(width, height);
+  }
+
+  /// Occluders outside the frustum cover nothing on screen, so only the survivors are rasterized; what GPU culling
+  /// gets has not been frustum culled yet, whose triangles outside are dropped by the rasterizer instead
+  mOcclusion->begin(frameInfo.mCamera.getProjection() * frameInfo.mCamera.getView());
+  auto addOccluder = [this](const VermicelliGameObject &obj) {
+    if (obj.mModel->hasOccluder()) {
+      const auto &occluder = obj.mModel->occluder();
+      mOcclusion->addOccluder(obj.mTransform.mat4(), occluder.mPositions, occluder.mIndices);
+    }
+  };
+  for (uint32_t index: mVisible) {
+    addOccluder(*mCandidates[index]);
+  }
+  for (const auto *obj: mCullList) {
+    addOccluder(*obj);
+  }
+  mOcclusion->render();
+
+  mOcclusion->filter(mCandidateSpheres, mVisible);
+  if (!mCullList.empty()) {
+    /// Hidden ones never reach the GPU culling passes
+    mCullVisible.resize(mCullList.size());
+    std::iota(mCullVisible.begin(), mCullVisible.end(), 0u);
+    mOcclusion->filter(mCullSpheres, mCullVisible);
+    for (size_t i = 0; i < mCullVisible.size(); ++i) {
+      mCullList[i] = mCullList[mCullVisible[i]];
+    }
+    mCullList.resize(mCullVisible.size());
+  }
+}
+
+void VermicelliSimpleRenderSystem::cull(FrameInfo &frameInfo, const VermicelliDepthPyramid *pyramid) {
+  if (mCulling != nullptr) {
+    mCulling->cull(frameInfo, mCullInstances, mCullBatches, mMinPixels, pyramid);
+  }
+}
+
+void VermicelliSimpleRenderSystem::cullLate(FrameInfo &frameInfo, const VermicelliDepthPyramid &pyramid) {
+  if (mCulling != nullptr) {
+    mCulling->cullLate(frameInfo, pyramid);
+  }
+}
+
+void VermicelliSimpleRenderSystem::setGpuCulling(const bool enabled) {
+  if (enabled && !mDevice.drawIndirectFirstInstance()) {
+    /// Every batch's indirect commands start at its first instance
+    std::cerr << "GPU culling needs the drawIndirectFirstInstance feature, drawing from the CPU instead" << std::endl;
+    return;
+  }
+  if (enabled && mCulling == nullptr) {
+    mCulling = std::make_unique<VermicelliGpuCulling>(mDevice, mVerbose);
+  } else if (!enabled) {
+    mCulling.reset();
+  }
+}
+
+void VermicelliSimpleRenderSystem::setCpuOcclusion(const bool enabled) {
+  if (enabled && mOcclusion == nullptr) {
+    mOcclusion = std::make_unique<VermicelliOcclusionRasterizer>();
+    if (mVerbose) {
+      std::cout << "CPU occlusion culling on " << mOcclusion->threadCount() << " threads, "
+                << VermicelliOcclusionRasterizer::pathName(mOcclusion->path()) << std::endl;
+    }
+  } else if (!enabled) {
+    mOcclusion.reset();
+  }
+}
+
+void VermicelliSimpleRenderSystem::renderGameObjects(FrameInfo &frameInfo) {
+  if (!mStaticList.empty()) {
+    renderStatic(frameInfo, mStaticKey);
+  }
+  if (mCulling != nullptr && !mCulling->groups().empty()) {
+    frameInfo.mRecorder.record(frameInfo.mCommandBuffer, mCulling->groups().size(), RECORD_CHUNK,
+                               [&](VkCommandBuffer commandBuffer, size_t begin, size_t end) {
+                                 renderCulled(frameInfo, commandBuffer, begin, end);
+                               });
+  }
+  if (mDrawList.empty()) {
+    return;
+  }
+
+  /// Each chunk writes the instances of its own batches, which are disjoint ranges of the allocation
+  auto instances = frameInfo.mFrameAllocator.allocate(mDrawList.size() * sizeof(InstanceData),
+                                                      VermicelliFrameAllocator::Usage::VERTEX);
+  frameInfo.mRecorder.record(frameInfo.mCommandBuffer, mBatches.size(), RECORD_CHUNK,
+                             [&](VkCommandBuffer commandBuffer, size_t begin, size_t end) {
+                               writeInstances(mDrawList, mBatches, begin, end, instances.mData);
+                               renderBatches(frameInfo, commandBuffer, mBatches, begin, end,
+                                             frameInfo.mFrameAllocator.buffer(), instances.mOffset);
+                             });
+}
+
+void VermicelliSimpleRenderSystem::renderLate(FrameInfo &frameInfo) {
+  /// The same groups again; the late passes left the same buffers holding what was hidden before and no longer is
+  if (mCulling != nullptr && mCulling->hasLatePass() && !mCulling->groups().empty()) {
+    frameInfo.mRecorder.record(frameInfo.mCommandBuffer, mCulling->groups().size(), RECORD_CHUNK,
+                               [&](VkCommandBuffer commandBuffer, size_t begin, size_t end) {
+                                 renderCulled(frameInfo, commandBuffer, begin, end);
+                               });
+  }
+}
+
+void VermicelliSimpleRenderSystem::buildBatches(std::vector<VermicelliGameObject *> &objects,
+                                                std::vector<Batch> &batches) {
+  /// Sorted by pipeline and index type first, so batches that share the bound state are next to each other
+  std::sort(objects.begin(), objects.end(), [](const VermicelliGameObject *lhs, const VermicelliGameObject *rhs) {
+    return std::make_tuple(lhs->mModel->vertexFormat(), lhs->mModel->indexType(), lhs->mModel.get(), lhs->mLod) <
+           std::make_tuple(rhs->mModel->vertexFormat(), rhs->mModel->indexType(), rhs->mModel.get(), rhs->mLod);
+  });
+
+  batches.clear();
+  for (uint32_t i = 0; i < objects.size(); ++i) {
+    const auto *obj = objects[i];
+    if (batches.empty() || batches.back().mModel != obj->mModel.get() || batches.back().mLod != obj->mLod) {
+      batches.push_back({obj->mModel.get(), obj->mLod, i, 0});
+    }
+    ++batches.back().mInstanceCount;
+  }
+}
+
+void VermicelliSimpleRenderSystem::writeInstances(const std::vector<VermicelliGameObject *> &objects,
+                                                  const std::vector<Batch> &batches, size_t begin, size_t end,
+                                                  void *instances) {
+  auto *data = static_cast<InstanceData *>(instances);
+  for (size_t batch = begin; batch < end; ++batch) {
+    const Batch &current = batches[batch];
+    for (uint32_t i = current.mFirstInstance; i < current.mFirstInstance + current.mInstanceCount; ++i) {
+      data[i] = objects[i]->mSceneSlot;
+    }
+  }
+}
+
+void VermicelliSimpleRenderSystem::renderStatic(const FrameInfo &frameInfo, size_t key) {
+  /// Anything else baked into the recording: where the geometry lives, the render pass it runs in and the viewport,
+  /// and the global UBO's offset, which is the same every time this slot comes around
+  VkExtent2D extent = frameInfo.mRecorder.extent();
+  hashCombine(key, mStaticList.size(), mStaticList.front()->mModel->arena().layoutVersion(),
+              frameInfo.mRecorder.renderPass(), extent.width, extent.height, frameInfo.mGlobalDescriptorSet,
+              frameInfo.mGlobalUboOffset);
+
+  /// One recording per slot: the slot's last frame is done by now, so its buffers can be rewritten
+  StaticCommands &commands = mStaticCommands[frameInfo.mFrameIndex];
+  if (!commands.mRecorded || commands.mKey != key) {
+    buildBatches(mStaticList, mStaticBatches);
+    if (commands.mInstances == nullptr || commands.mInstances->getInstanceCount() < mStaticList.size()) {
+      mDevice.deletionQueue().retire(std::move(commands.mInstances));
+      commands.mInstances = std::make_unique<VermicelliBuffer>(
+              mDevice,
+              sizeof(InstanceData),
+              static_cast<uint32_t>(mStaticList.size()),
+              VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+              VermicelliMemoryAllocator::Category::OTHER
+                                                              );
+      commands.mInstances->map();
+    }
+    writeInstances(mStaticList, mStaticBatches, 0, mStaticBatches.size(), commands.mInstances->getMappedMemory());
+
+    frameInfo.mRecorder.beginSecondary(commands.mCommandBuffer, true);
+    renderBatches(frameInfo, commands.mCommandBuffer, mStaticBatches, 0, mStaticBatches.size(),
+                  commands.mInstances->getBuffer(), 0);
+    if (vkEndCommandBuffer(commands.mCommandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to record static command buffer!");
+    }
+    commands.mKey      = key;
+    commands.mRecorded = true;
+    if (mVerbose) {
+      std::cout << "Simple render system: recorded " << mStaticList.size() << " static objects in "
+                << mStaticBatches.size() << " draws for frame slot " << frameInfo.mFrameIndex << std::endl;
+    }
+  }
+  vkCmdExecuteCommands(frameInfo.mCommandBuffer, 1, &commands.mCommandBuffer);
+}
+
+void VermicelliSimpleRenderSystem::renderBatches(const FrameInfo &frameInfo, VkCommandBuffer commandBuffer,
+                                                 const std::vector<Batch> &batches, size_t begin, size_t end,
+                                                 VkBuffer instanceBuffer, VkDeviceSize instanceOffset) {
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
+                          &frameInfo.mGlobalDescriptorSet, 1, &frameInfo.mGlobalUboOffset);
+  vkCmdBindVertexBuffers(commandBuffer, INSTANCE_BINDING, 1, &instanceBuffer, &instanceOffset);
+
+  /// Both pipelines share a layout, so the descriptor set stays bound across switches. All models draw from the
+  /// geometry arena, so buffers are only rebound when the index type changes along with the pipeline; the instance
+  /// binding is never touched by that.
+  VermicelliPipeline *boundPipeline  = nullptr;
+  VkIndexType        boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+  for (size_t        batch          = begin; batch < end; ++batch) {
+    const Batch &current = batches[batch];
+    auto        *pipeline = current.mModel->vertexFormat() == VermicelliModel::VertexFormat::COMPACT
+                            ? mCompactPipeline.get() : mPipeline.get();
+    if (pipeline != boundPipeline || current.mModel->indexType() != boundIndexType) {
+      if (pipeline != boundPipeline) {
+        pipeline->bind(commandBuffer);
+      }
+      current.mModel->bind(commandBuffer);
+      boundPipeline  = pipeline;
+      boundIndexType = current.mModel->indexType();
+    }
+    current.mModel->draw(commandBuffer, current.mLod, current.mInstanceCount, current.mFirstInstance);
+  }
+}
+
+void VermicelliSimpleRenderSystem::renderCulled(const FrameInfo &frameInfo, VkCommandBuffer commandBuffer,
+                                                size_t begin, size_t end) {
+  VkBuffer     instanceBuffer = mCulling->instanceBuffer(frameInfo.mFrameIndex);
+  VkDeviceSize instanceOffset = 0;
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mPipelineLayout, 0, 1,
+                          &frameInfo.mGlobalDescriptorSet, 1, &frameInfo.mGlobalUboOffset);
+  vkCmdBindVertexBuffers(commandBuffer, INSTANCE_BINDING, 1, &instanceBuffer, &instanceOffset);
+
+  /// Groups already split wherever the pipeline or index type changes
+  VermicelliPipeline *boundPipeline = nullptr;
+  for (size_t        group          = begin; group < end; ++group) {
+    const auto *model    = mCulling->groups()[group].mModel;
+    auto       *pipeline = model->vertexFormat() == VermicelliModel::VertexFormat::COMPACT
+                           ? mCompactPipeline.get() : mPipeline.get();
+    if (pipeline != boundPipeline) {
+      pipeline->bind(commandBuffer);
+      boundPipeline = pipeline;
+    }
+    model->bind(commandBuffer);
+    mCulling->draw(frameInfo, commandBuffer, group);
   }
 }
 }
\ No newline at end of file
@@ -13,64 +13,92 @@
 #include "vermicelli_functions.h"
 #include "vermicelli_keyboard_input.h"
 #include "vermicelli_buffer.h"
+#include "vermicelli_deletion_queue.h"
 #include <glm/gtc/constants.hpp> // PI
 #include <stdexcept>
 #include <array>
 #include <chrono>
-#include <numeric>
+#include <cstring>
 
 using hiResClock = std::chrono::high_resolution_clock;
 using duration = std::chrono::duration<float, std::chrono::seconds::period>;
 
 namespace vermicelli {
 
-Application::Application(const bool verbose) : mVerbose(verbose) {
+Application::Application(const bool verbose, const bool compactVertices, const float lodBias, const bool gpuCulling,
+                         const bool occlusionCulling, const bool cpuOcclusion)
+        : mVerbose(verbose), mCompactVertices(compactVertices), mLodBias(lodBias),
+          mGpuCulling(gpuCulling || occlusionCulling), mOcclusionCulling(occlusionCulling),
+          mCpuOcclusion(cpuOcclusion) {
+  /// Running out of device memory is fatal, so at least say so while there is still some left
+  mDevice.allocator().setBudgetCallback([](uint32_t heap, VkDeviceSize usage, VkDeviceSize budget) {
+    std::cerr << "Device memory heap " << heap << " is at " << usage / (1024.0f * 1024.0f) << " of its "
+              << budget / (1024.0f * 1024.0f) << " MiB budget" << std::endl;
+  });
   mGlobalPool = VermicelliDescriptorPool::Builder(mDevice)
-          .setMaxSets(VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT)
-          .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT)
+          .setMaxSets(1)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1)
           .build();
   loadGameObjects();
 }
 
-Application::~Application() = default;
+Application::~Application() {
+  /// Released models hand their geometry back to mGeometry through the deletion queue, which must happen before it
+  /// is destroyed; run() has already waited for the GPU
+  mGameObjects.clear();
+  mModels.unloadUnused();
+  mDevice.deletionQueue().flush();
+}
 
 void Application::run() {
-  auto minOffsetAlignment = std::lcm(
-          mDevice.mProperties.limits.minUniformBufferOffsetAlignment,
-          mDevice.mProperties.limits.nonCoherentAtomSize);
-
-  std::vector<std::unique_ptr<VermicelliBuffer> > uboBuffers(VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT);
-
-  for (auto &uboBuffer: uboBuffers) {
-    uboBuffer = std::make_unique<VermicelliBuffer>(
-            mDevice,
-            sizeof(GlobalUbo),
-            1,
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-    uboBuffer->map();
-  }
+  /// Per-frame data, the global UBO included, is bump-allocated from here; frames only differ in the dynamic offset
+  VermicelliFrameAllocator frameAllocator{mDevice, VermicelliFrameAllocator::DEFAULT_FRAME_SIZE, mVerbose};
 
   auto globalSetLayout = VermicelliDescriptorSetLayout::Builder(mDevice)
-          .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL_GRAPHICS)
+          .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
           .build();
 
-  std::vector<VkDescriptorSet> globalDescriptorSets(VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT);
-  for (int                     i = 0; i < globalDescriptorSets.size(); ++i) {
-    auto bufferInfo = uboBuffers[i]->descriptorInfo();
-    VermicelliDescriptorWriter(*globalSetLayout, *mGlobalPool)
-            .writeBuffer(0, &bufferInfo)
-            .build(globalDescriptorSets[i]);
-  }
+  VkDescriptorSet globalDescriptorSet;
+  auto            bufferInfo = frameAllocator.descriptorInfo(sizeof(GlobalUbo));
+  auto            sceneInfo  = mScene.descriptorInfo();
+  VermicelliDescriptorWriter(*globalSetLayout, *mGlobalPool)
+          .writeBuffer(0, &bufferInfo)
+          .writeBuffer(1, &sceneInfo)
+          .build(globalDescriptorSet);
 
   VermicelliSimpleRenderSystem simpleRenderSystem{mDevice, mRenderer.getSwapChainRenderPass(),
                                                   globalSetLayout->getDescriptorSetLayout(), mVerbose};
   VermicelliPointLightSystem   pointLightSystem{mDevice, mRenderer.getSwapChainRenderPass(),
                                                 globalSetLayout->getDescriptorSetLayout(), mVerbose};
   VermicelliCamera             camera{};
+  simpleRenderSystem.setLodBias(mLodBias);
+  simpleRenderSystem.setGpuCulling(mGpuCulling);
+  /// Occlusion is tested by the GPU culling passes, which may have been refused
+  bool occlusionCulling = mOcclusionCulling && simpleRenderSystem.isGpuCulling();
+  mRenderer.setDepthPyramid(occlusionCulling);
+  simpleRenderSystem.setCpuOcclusion(mCpuOcclusion);
 
   if (mVerbose) {
     std::cout << "maxPushConstantSize = " << mDevice.mProperties.limits.maxPushConstantsSize << std::endl;
+    auto memory = mDevice.allocator().stats();
+    std::cout << "Device memory: " << memory.mAllocationCount << " allocations in " << memory.mBlockCount
+              << " blocks + " << memory.mDedicatedCount << " dedicated, " << memory.mUsedBytes / (1024.0f * 1024.0f)
+              << " of " << memory.mBlockBytes / (1024.0f * 1024.0f) << " MiB of blocks used" << std::endl;
+    for (uint32_t heap = 0; heap < memory.mHeapCount; ++heap) {
+      std::cout << "  heap " << heap << ": " << memory.mHeapUsage[heap] / (1024.0f * 1024.0f) << " of "
+                << memory.mHeapBudget[heap] / (1024.0f * 1024.0f) << " MiB "
+                << (memory.mDriverBudget ? "budget" : "estimated budget");
+      for (uint32_t category = 0; category < VermicelliMemoryAllocator::CATEGORY_COUNT; ++category) {
+        if (memory.mCategoryBytes[category][heap] > 0) {
+          std::cout << ", " << VermicelliMemoryAllocator::categoryName(
+                  static_cast<VermicelliMemoryAllocator::Category>(category)) << " "
+                    << memory.mCategoryBytes[category][heap] / (1024.0f * 1024.0f) << " MiB";
+        }
+      }
+      std::cout << std::endl;
+    }
   }
   bool running = true;
 
@@ -81,6 +109,11 @@ void Application::run() {
 
   auto currTime = hiResClock::now();
 
+  /// In verbose mode the average frame time is reported every few seconds, to compare rendering changes
+  constexpr float reportInterval = 5.0f;
+  float           reportTime     = 0.0f;
+  uint32_t        reportFrames   = 0;
+
   while (running) {
     SDL_Event windowEvent;
     auto      eventHappened = SDL_PollEvent(&windowEvent);
@@ -88,6 +121,35 @@ void Application::run() {
     auto  newTime   = hiResClock::now();
     float frameTime = duration(newTime - currTime).count();
     currTime = newTime;
+    if (mVerbose) {
+      reportTime += frameTime;
+      ++reportFrames;
+      if (reportTime >= reportInterval) {
+        std::cout << "Average frame time: " << 1000.0f * reportTime / static_cast<float>(reportFrames) << " ms over "
+                  << reportFrames << " frames, at most " << frameAllocator.peakUsed() / 1024
+                  << " KiB of per-frame data, " << mScene.size() << " scene records, "
+                  << mScene.lastUploadBytes() << " bytes of them uploaded last frame" << std::endl;
+        auto cullStats = simpleRenderSystem.cullStats();
+        std::cout << "CPU culling: " << cullStats.mVisible << " of " << cullStats.mTested << " objects drawn, "
+                  << cullStats.mFrustumCulled << " outside the frustum, " << cullStats.mSmallCulled
+                  << " too small, in " << cullStats.mMilliseconds << " ms" << std::endl;
+        if (occlusionCulling) {
+          auto occlusionStats = simpleRenderSystem.occlusionStats();
+          std::cout << "Occlusion culling: " << occlusionStats.mOccluded << " of " << occlusionStats.mTested
+                    << " objects hidden, " << occlusionStats.mFrustumCulled << " outside the frustum, "
+                    << occlusionStats.mDisoccluded << " drawn after the depth pyramid was rebuilt" << std::endl;
+        }
+        if (simpleRenderSystem.isCpuOcclusion()) {
+          auto occluderStats = simpleRenderSystem.cpuOcclusionStats();
+          std::cout << "CPU occlusion culling: " << occluderStats.mOccluded << " of " << occluderStats.mTested
+                    << " objects hidden by " << occluderStats.mOccluders << " occluders, " << occluderStats.mTriangles
+                    << " triangles rasterized in " << occluderStats.mRenderMilliseconds << " ms, tested in "
+                    << occluderStats.mTestMilliseconds << " ms" << std::endl;
+        }
+        reportTime   = 0.0f;
+        reportFrames = 0;
+      }
+    }
     if (eventHappened) {
       float aspect = mRenderer.getAspectRatio();
       camera.setPerspectiveProjection(glm::radians(50.0f /*Field of view in degrees*/), aspect, 0.01f, 100.0f);
@@ -106,14 +168,23 @@ void Application::run() {
     cameraController.moveInPlaneXZ(frameTime, viewerObject);
     camera.setViewYXZ(viewerObject.mTransform.mTranslation, viewerObject.mTransform.mRotation);
     if (auto commandBuffer = mRenderer.beginFrame()) {
-      int       frameIndex = mRenderer.getFrameIndex();
+      int frameIndex = mRenderer.getFrameIndex();
+      mGeometry.compact();
+      mGeometry.recordCopies(commandBuffer);
+      frameAllocator.beginFrame(frameIndex);
+      auto      uboAllocation = frameAllocator.allocate(sizeof(GlobalUbo), VermicelliFrameAllocator::Usage::UNIFORM);
       FrameInfo frameInfo{
               frameIndex,
               frameTime,
               commandBuffer,
+              mRenderer.getRecorder(),
               camera,
-              globalDescriptorSets[frameIndex],
-              mGameObjects
+              globalDescriptorSet,
+              uboAllocation.dynamicOffset(),
+              frameAllocator,
+              mGameObjects,
+              mScene,
+              mRenderer.getExtent()
       };
       //update
       GlobalUbo ubo{};
@@ -121,8 +192,11 @@ void Application::run() {
       ubo.mView        = camera.getView();
       ubo.mInverseView = camera.getInverseView();
       pointLightSystem.update(frameInfo, ubo);
-      uboBuffers[frameIndex]->writeToBuffer(&ubo);
-      uboBuffers[frameIndex]->flush();
+      simpleRenderSystem.update(frameInfo);
+      std::memcpy(uboAllocation.mData, &ubo, sizeof(GlobalUbo));
+      mScene.flush(commandBuffer, frameAllocator);
+      const VermicelliDepthPyramid *depthPyramid = occlusionCulling ? mRenderer.getDepthPyramid() : nullptr;
+      simpleRenderSystem.cull(frameInfo, depthPyramid);
 
       /* TODO:
        * begin offscreen shadow pass
@@ -132,42 +206,61 @@ void Application::run() {
 
       mRenderer.beginSwapChainRenderPass(commandBuffer);
       simpleRenderSystem.renderGameObjects(frameInfo);
+      if (depthPyramid != nullptr) {
+        /// What the last frame's depth hid is tested again against this frame's, and drawn in the same render pass
+        /// resumed, before the lights blend over everything
+        mRenderer.endSwapChainRenderPass(commandBuffer);
+        mRenderer.buildDepthPyramid(commandBuffer, ubo.mProjection * ubo.mView);
+        simpleRenderSystem.cullLate(frameInfo, *depthPyramid);
+        mRenderer.resumeSwapChainRenderPass(commandBuffer);
+        simpleRenderSystem.renderLate(frameInfo);
+      }
       pointLightSystem.render(frameInfo);
       mRenderer.endSwapChainRenderPass(commandBuffer);
+      frameAllocator.flush();
       mRenderer.endFrame();
     }
   }
-  vkDeviceWaitIdle(mDevice.device());
+  mRenderer.finishFrames();
 }
 
 void Application::loadGameObjects() {
-  std::shared_ptr<VermicelliModel> model = VermicelliModel::createModelFromFile(mDevice, "../models/new_kirb.obj",
-                                                                                mVerbose);
+  ModelLoadOptions loadOptions{};
+  loadOptions.mOptimizeMesh         = true;
+  loadOptions.mCompactVertices      = mCompactVertices;
+  loadOptions.mSplitForShortIndices = true;
+  loadOptions.mGenerateLods         = true;
+  loadOptions.mBuildOccluder        = mCpuOcclusion;
+
+  std::shared_ptr<VermicelliModel> model = mModels.load("../models/new_kirb.obj", loadOptions);
 
   auto kirby = VermicelliGameObject::createGameObject();
   kirby.mModel                  = model;
   kirby.mTransform.mTranslation = {-0.15f, 0.0f, 0.075f};
   kirby.mTransform.mScale       = {0.005f, 0.005f, 0.005f};
   kirby.mTransform.mRotation    = {0.0f, glm::pi<float>(), 0.0f};
+  kirby.mStatic                 = true;
 
   mGameObjects.emplace(kirby.getID(), std::move(kirby));
 
-  model = VermicelliModel::createModelFromFile(mDevice, "../models/icosahedron.obj", mVerbose);
+  model = mModels.load("../models/icosahedron.obj", loadOptions);
 
   auto cube = VermicelliGameObject::createGameObject();
   cube.mModel                  = model;
   cube.mTransform.mTranslation = {0.0f, -5.0f, 0.0f};
   cube.mTransform.mScale       = {0.1f, 0.1f, 0.1f};
   cube.mTransform.mRotation    = glm::vec3{0.0f, 0.0f, 0.0f};
+  cube.mStatic                 = true;
 
   mGameObjects.emplace(cube.getID(), std::move(cube));
 
-  model = VermicelliModel::createModelFromFile(mDevice, "../models/quad.obj", mVerbose);
+  model = mModels.load("../models/quad.obj", loadOptions);
 
   auto                   floor = VermicelliGameObject::createGameObject();
   floor.mModel                  = model;
   floor.mTransform.mTranslation = {0.0f, 0.0f, 0.0f};
   floor.mTransform.mScale       = {15.0f, 1.0f, 15.0f};
+  floor.mStatic                 = true;
 
   mGameObjects.emplace(floor.getID(), std::move(floor));
 
@@ -199,6 +292,9 @@ void Application::loadGameObjects() {
     pointLight.mTransform.mTranslation = glm::vec3(rotateLight * glm::vec4(-2.5f, -4.5f, -2.5f, 1.0f));
     mGameObjects.emplace(pointLight.getID(), std::move(pointLight));
   }
+
+  /// Models only stage their geometry; send everything loaded above to the GPU in as few batches as the ring allows
+  mDevice.uploader().submit();
 }
 
 }
\ No newline at end of file
@@ -35,6 +35,7 @@ VermicelliBuffer::VermicelliBuffer(
         uint32_t instanceCount,
         VkBufferUsageFlags usageFlags,
         VkMemoryPropertyFlags memoryPropertyFlags,
+        VermicelliMemoryAllocator::Category category,
         VkDeviceSize minOffsetAlignment)
         : vermicelliDevice{device},
           mInstanceSize{instanceSize},
@@ -43,18 +44,20 @@ VermicelliBuffer::VermicelliBuffer(
           mMemoryPropertyFlags{memoryPropertyFlags} {
   mAlignmentSize = getAlignment(instanceSize, minOffsetAlignment);
   mBufferSize    = mAlignmentSize * instanceCount;
-  device.createBuffer(mBufferSize, usageFlags, memoryPropertyFlags, mBuffer, mMemory);
+  device.createBuffer(mBufferSize, usageFlags, memoryPropertyFlags, mBuffer, mMemory, category);
 }
 
 VermicelliBuffer::~VermicelliBuffer() {
   unmap();
   vkDestroyBuffer(vermicelliDevice.device(), mBuffer, nullptr);
-  vkFreeMemory(vermicelliDevice.device(), mMemory, nullptr);
+  vermicelliDevice.allocator().free(mMemory);
 }
 
 /**
  * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
  *
+ * @note Host-visible memory stays mapped by the allocator, so this only hands out the address
+ *
  * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
  * buffer range.
  * @param offset (Optional) Byte offset from beginning
@@ -62,20 +65,21 @@ VermicelliBuffer::~VermicelliBuffer() {
  * @return VkResult of the buffer mapping call
  */
 VkResult VermicelliBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
-  assert(mBuffer && mMemory && "Called map on buffer before create");
-  return vkMapMemory(vermicelliDevice.device(), mMemory, offset, size, 0, &mMapped);
+  assert(mBuffer && mMemory.mMemory && "Called map on buffer before create");
+  if (mMemory.mMapped == nullptr) {
+    return VK_ERROR_MEMORY_MAP_FAILED;
+  }
+  mMapped = static_cast<char *>(mMemory.mMapped) + offset;
+  return VK_SUCCESS;
 }
 
 /**
  * Unmap a mapped memory range
  *
- * @note Does not return a result as vkUnmapMemory can't fail
+ * @note The memory itself stays mapped until the allocator frees it
  */
 void VermicelliBuffer::unmap() {
-  if (mMapped) {
-    vkUnmapMemory(vermicelliDevice.device(), mMemory);
-    mMapped = nullptr;
-  }
+  mMapped = nullptr;
 }
 
 /**
@@ -111,12 +115,7 @@ void VermicelliBuffer::writeToBuffer(void *data, VkDeviceSize size, VkDeviceSize
  * @return VkResult of the flush call
  */
 VkResult VermicelliBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-  VkMappedMemoryRange mappedRange = {};
-  mappedRange.sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-  mappedRange.memory = mMemory;
-  mappedRange.offset = offset;
-  mappedRange.size   = size;
-  return vkFlushMappedMemoryRanges(vermicelliDevice.device(), 1, &mappedRange);
+  return vermicelliDevice.allocator().flush(mMemory, offset, size);
 }
 
 /**
@@ -131,12 +130,7 @@ VkResult VermicelliBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
  * @return VkResult of the invalidate call
  */
 VkResult VermicelliBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
-  VkMappedMemoryRange mappedRange = {};
-  mappedRange.sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-  mappedRange.memory = mMemory;
-  mappedRange.offset = offset;
-  mappedRange.size   = size;
-  return vkInvalidateMappedMemoryRanges(vermicelliDevice.device(), 1, &mappedRange);
+  return vermicelliDevice.allocator().invalidate(mMemory, offset, size);
 }
 
 /**
@@ -104,4 +104,22 @@ void VermicelliCamera::setViewYXZ(glm::vec3 camPos, glm::vec3 camRot) {
 
 }
 
+
+std::array<glm::vec4, 6> VermicelliCamera::getFrustumPlanes() const {
+  /// Gribb and Hartmann: clip space is bounded by -w <= x, y <= w and 0 <= z <= w, each of which is a row of the
+  /// view-projection matrix combined with its last row
+  const glm::mat4 viewProjection = mProjectionMatrix * mViewMatrix;
+  std::array<glm::vec4, 4> rows{};
+  for (int row = 0; row < 4; ++row) {
+    rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row], viewProjection[2][row],
+                          viewProjection[3][row]);
+  }
+
+  std::array<glm::vec4, 6> planes{rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2],
+                                  rows[3] - rows[2]};
+  for (auto &plane: planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  return planes;
+}
 }
\ No newline at end of file
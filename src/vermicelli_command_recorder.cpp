@@ -0,0 +1,229 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Records secondary command buffers for the swap chain render pass across worker threads
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_command_recorder.h"
+#include "vermicelli_device.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace vermicelli {
+
+VermicelliCommandRecorder::VermicelliCommandRecorder(VermicelliDevice &device, uint32_t threadCount,
+                                                     const bool verbose) : mDevice{device}, mVerbose(verbose) {
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  mThreads.resize(threadCount);
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = mDevice.findPhysicalQueueFamilies().mGraphicsFamily;
+  poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // Reset as a whole, never per buffer
+  for (auto &thread: mThreads) {
+    for (auto &pool: thread.mPools) {
+      if (vkCreateCommandPool(mDevice.device(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create recording command pool!");
+      }
+    }
+  }
+
+  for (uint32_t thread = 1; thread < threadCount; ++thread) {
+    mWorkers.emplace_back(&VermicelliCommandRecorder::workerLoop, this, thread);
+  }
+
+  if (mVerbose) {
+    std::cout << "Command recorder: " << threadCount << " recording threads" << std::endl;
+  }
+}
+
+VermicelliCommandRecorder::~VermicelliCommandRecorder() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mWake.notify_all();
+  for (auto &worker: mWorkers) {
+    worker.join();
+  }
+
+  /// Destroying a pool frees its command buffers
+  for (auto &thread: mThreads) {
+    for (auto pool: thread.mPools) {
+      vkDestroyCommandPool(mDevice.device(), pool, nullptr);
+    }
+  }
+}
+
+void VermicelliCommandRecorder::beginFrame(int frameIndex) {
+  mFrameIndex = frameIndex;
+  for (auto &thread: mThreads) {
+    /// Keeps the pool's memory, so steady-state frames allocate nothing
+    vkResetCommandPool(mDevice.device(), thread.mPools[frameIndex], 0);
+    thread.mUsed[frameIndex] = 0;
+  }
+}
+
+void VermicelliCommandRecorder::beginRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer,
+                                                VkExtent2D extent) {
+  mInheritance             = {};
+  mInheritance.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  mInheritance.renderPass  = renderPass;
+  mInheritance.subpass     = 0;
+  mInheritance.framebuffer = framebuffer;
+  mExtent                  = extent;
+}
+
+void VermicelliCommandRecorder::record(VkCommandBuffer primary, size_t count, size_t minChunk, const RecordFn &fn) {
+  assert(mInheritance.renderPass != VK_NULL_HANDLE && "Cannot record secondaries before beginRenderPass");
+  if (count == 0) {
+    return;
+  }
+
+  size_t chunkCount = std::min<size_t>(mThreads.size(), std::max<size_t>(1, count / std::max<size_t>(1, minChunk)));
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mJob        = &fn;
+    mCount      = count;
+    mChunkCount = chunkCount;
+    mChunksDone = 0;
+    mError      = nullptr;
+    mChunkBuffers.assign(chunkCount, VK_NULL_HANDLE);
+    mNextChunk.store(0);
+    if (chunkCount > 1) {
+      ++mGeneration;
+    }
+  }
+  if (chunkCount > 1) {
+    mWake.notify_all();
+  }
+
+  recordChunks(0);
+
+  /// Workers that woke up too late to take a chunk must still be out before the job is replaced
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDone.wait(lock, [this] { return mChunksDone == mChunkCount && mActive == 0; });
+    mJob = nullptr;
+  }
+  if (mError) {
+    std::rethrow_exception(mError);
+  }
+
+  vkCmdExecuteCommands(primary, static_cast<uint32_t>(mChunkBuffers.size()), mChunkBuffers.data());
+}
+
+void VermicelliCommandRecorder::beginSecondary(VkCommandBuffer commandBuffer, const bool reusable) const {
+  assert(mInheritance.renderPass != VK_NULL_HANDLE && "Cannot record secondaries before beginRenderPass");
+  VkCommandBufferInheritanceInfo inheritance = mInheritance;
+  VkCommandBufferBeginInfo       beginInfo{};
+  beginInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags            = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  beginInfo.pInheritanceInfo = &inheritance;
+  if (reusable) {
+    inheritance.framebuffer = VK_NULL_HANDLE; // Optional, and each image has its own
+  } else {
+    beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  }
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin secondary command buffer!");
+  }
+
+  /// Dynamic state is not inherited from the primary
+  VkViewport viewport{};
+  viewport.width    = static_cast<float>(mExtent.width);
+  viewport.height   = static_cast<float>(mExtent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  VkRect2D scissor{{0, 0}, mExtent};
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void VermicelliCommandRecorder::workerLoop(uint32_t thread) {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWake.wait(lock, [&] { return mStopping || mGeneration != seen; });
+      if (mStopping) {
+        return;
+      }
+      seen = mGeneration;
+      if (mJob == nullptr) {
+        continue; // Woke up after the job it was woken for had finished; the next one will wake it again
+      }
+      ++mActive;
+    }
+
+    recordChunks(thread);
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      --mActive;
+    }
+    mDone.notify_all();
+  }
+}
+
+void VermicelliCommandRecorder::recordChunks(uint32_t thread) {
+  for (;;) {
+    size_t chunk = mNextChunk.fetch_add(1);
+    if (chunk >= mChunkCount) {
+      return;
+    }
+    size_t begin = mCount * chunk / mChunkCount;
+    size_t end   = mCount * (chunk + 1) / mChunkCount;
+
+    try {
+      VkCommandBuffer commandBuffer = acquireBuffer(mThreads[thread]);
+      beginSecondary(commandBuffer);
+
+      (*mJob)(commandBuffer, begin, end);
+
+      if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record secondary command buffer!");
+      }
+      mChunkBuffers[chunk] = commandBuffer;
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (!mError) {
+        mError = std::current_exception();
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      ++mChunksDone;
+    }
+    mDone.notify_all();
+  }
+}
+
+VkCommandBuffer VermicelliCommandRecorder::acquireBuffer(ThreadState &state) {
+  auto   &buffers = state.mBuffers[mFrameIndex];
+  size_t &used    = state.mUsed[mFrameIndex];
+  if (used == buffers.size()) {
+    VkCommandBufferAllocateInfo allocateInfo{};
+    allocateInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocateInfo.commandPool        = state.mPools[mFrameIndex];
+    allocateInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(mDevice.device(), &allocateInfo, &commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate secondary command buffer!");
+    }
+    buffers.push_back(commandBuffer);
+  }
+  return buffers[used++];
+}
+
+}
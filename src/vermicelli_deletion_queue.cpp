@@ -0,0 +1,86 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Defers destroying GPU objects until the frames that may still use them have finished
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_deletion_queue.h"
+#include "vermicelli_descriptors.h"
+#include "vermicelli_device.h"
+#include "vermicelli_frame_timeline.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace vermicelli {
+
+VermicelliDeletionQueue::VermicelliDeletionQueue(VermicelliDevice &device, const bool verbose)
+        : mDevice{device}, mVerbose(verbose) {}
+
+VermicelliDeletionQueue::~VermicelliDeletionQueue() {
+  flush();
+}
+
+void VermicelliDeletionQueue::push(std::function<void()> deleter) {
+  mEntries.push_back({mCurrentFrame, mDevice.uploader().lastTicket(), std::move(deleter)});
+}
+
+void VermicelliDeletionQueue::destroyBuffer(VkBuffer buffer, VermicelliMemoryAllocator::Allocation memory) {
+  push([this, buffer, memory]() mutable {
+    vkDestroyBuffer(mDevice.device(), buffer, nullptr);
+    mDevice.allocator().free(memory);
+  });
+}
+
+void VermicelliDeletionQueue::destroyImage(VkImage image, VkImageView view,
+                                           VermicelliMemoryAllocator::Allocation memory) {
+  push([this, image, view, memory]() mutable {
+    if (view != VK_NULL_HANDLE) {
+      vkDestroyImageView(mDevice.device(), view, nullptr);
+    }
+    vkDestroyImage(mDevice.device(), image, nullptr);
+    mDevice.allocator().free(memory);
+  });
+}
+
+void VermicelliDeletionQueue::destroyPipeline(VkPipeline pipeline) {
+  push([this, pipeline] { vkDestroyPipeline(mDevice.device(), pipeline, nullptr); });
+}
+
+void VermicelliDeletionQueue::destroyPipelineLayout(VkPipelineLayout layout) {
+  push([this, layout] { vkDestroyPipelineLayout(mDevice.device(), layout, nullptr); });
+}
+
+void VermicelliDeletionQueue::freeDescriptorSets(const VermicelliDescriptorPool &pool,
+                                                 std::vector<VkDescriptorSet> sets) {
+  push([&pool, sets]() mutable { pool.freeDescriptors(sets); });
+}
+
+void VermicelliDeletionQueue::collect() {
+  mCompletedFrame = std::max(mCompletedFrame, mDevice.frameTimeline().completedValue());
+  size_t destroyed = 0;
+  while (!mEntries.empty() && mEntries.front().mFrame <= mCompletedFrame &&
+         mDevice.uploader().isComplete(mEntries.front().mTicket)) {
+    /// Moved out first, a deleter may well retire something else
+    auto deleter = std::move(mEntries.front().mDeleter);
+    mEntries.pop_front();
+    deleter();
+    ++destroyed;
+  }
+  if (mVerbose && destroyed > 0) {
+    std::cout << "Deletion queue: destroyed " << destroyed << " objects after frame " << mCompletedFrame << ", "
+              << mEntries.size() << " pending" << std::endl;
+  }
+}
+
+void VermicelliDeletionQueue::flush() {
+  while (!mEntries.empty()) {
+    auto deleter = std::move(mEntries.front().mDeleter);
+    mEntries.pop_front();
+    deleter();
+  }
+}
+
+}
@@ -0,0 +1,222 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Hierarchical-Z: the swap chain's depth reduced to a mip chain of farthest depths, for occlusion tests
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_depth_pyramid.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace vermicelli {
+
+/// local_size_x and local_size_y of depth_pyramid.comp
+static constexpr uint32_t WORKGROUP_SIZE = 8;
+
+VermicelliDepthPyramid::VermicelliDepthPyramid(VermicelliDevice &device, VermicelliSwapChain &swapChain,
+                                               const bool verbose)
+        : mDevice{device}, mVerbose(verbose), mDepthFormat(swapChain.getDepthFormat()) {
+  assert(swapChain.isDepthSampled() && "The swap chain must keep its depth for the pyramid to read it");
+  VkExtent2D depthExtent = swapChain.getSwapChainExtent();
+  mExtent = {std::bit_floor(depthExtent.width), std::bit_floor(depthExtent.height)};
+  for (int i = 0; i < swapChain.imageCount(); ++i) {
+    mDepthImages.push_back(swapChain.getDepthImage(i));
+  }
+
+  createImage();
+  createDescriptorSets(swapChain);
+  createPipeline();
+  if (mVerbose) {
+    std::cout << "Depth pyramid: " << mExtent.width << " x " << mExtent.height << " in " << levelCount()
+              << " levels" << std::endl;
+  }
+}
+
+VermicelliDepthPyramid::~VermicelliDepthPyramid() {
+  vkDestroyPipelineLayout(mDevice.device(), mPipelineLayout, nullptr);
+  vkDestroySampler(mDevice.device(), mSampler, nullptr);
+  for (auto view: mLevelViews) {
+    vkDestroyImageView(mDevice.device(), view, nullptr);
+  }
+  vkDestroyImageView(mDevice.device(), mView, nullptr);
+  vkDestroyImage(mDevice.device(), mImage, nullptr);
+  mDevice.allocator().free(mMemory);
+}
+
+void VermicelliDepthPyramid::createImage() {
+  uint32_t levels = std::bit_width(std::max(mExtent.width, mExtent.height));
+
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width  = mExtent.width;
+  imageInfo.extent.height = mExtent.height;
+  imageInfo.extent.depth  = 1;
+  imageInfo.mipLevels     = levels;
+  imageInfo.arrayLayers   = 1;
+  imageInfo.format        = VK_FORMAT_R32_SFLOAT;
+  imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage         = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.flags         = 0;
+  mDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mImage, mMemory,
+                              VermicelliMemoryAllocator::Category::ATTACHMENTS);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image                           = mImage;
+  viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format                          = VK_FORMAT_R32_SFLOAT;
+  viewInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+  viewInfo.subresourceRange.baseMipLevel   = 0;
+  viewInfo.subresourceRange.levelCount     = levels;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount     = 1;
+  if (vkCreateImageView(mDevice.device(), &viewInfo, nullptr, &mView) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create depth pyramid view!");
+  }
+
+  mLevelViews.resize(levels);
+  viewInfo.subresourceRange.levelCount = 1;
+  for (uint32_t level = 0; level < levels; ++level) {
+    viewInfo.subresourceRange.baseMipLevel = level;
+    if (vkCreateImageView(mDevice.device(), &viewInfo, nullptr, &mLevelViews[level]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create depth pyramid view!");
+    }
+  }
+
+  /// Only ever read with texelFetch, which ignores filtering, but a combined image sampler needs one
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter    = VK_FILTER_NEAREST;
+  samplerInfo.minFilter    = VK_FILTER_NEAREST;
+  samplerInfo.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.maxLod       = static_cast<float>(levels);
+  if (vkCreateSampler(mDevice.device(), &samplerInfo, nullptr, &mSampler) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create depth pyramid sampler!");
+  }
+}
+
+void VermicelliDepthPyramid::createDescriptorSets(VermicelliSwapChain &swapChain) {
+  auto setCount = static_cast<uint32_t>(mDepthImages.size() + mLevelViews.size() - 1);
+  mSetLayout = VermicelliDescriptorSetLayout::Builder(mDevice)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Level below
+          .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)          // Level written
+          .build();
+  mPool      = VermicelliDescriptorPool::Builder(mDevice)
+          .setMaxSets(setCount)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, setCount)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, setCount)
+          .build();
+
+  auto writeSet = [this](VkDescriptorImageInfo source, VkImageView destination, VkDescriptorSet &set) {
+    VkDescriptorImageInfo destinationInfo{VK_NULL_HANDLE, destination, VK_IMAGE_LAYOUT_GENERAL};
+    if (!VermicelliDescriptorWriter(*mSetLayout, *mPool)
+            .writeImage(0, &source)
+            .writeImage(1, &destinationInfo)
+            .build(set)) {
+      throw std::runtime_error("failed to allocate depth pyramid descriptor set!");
+    }
+  };
+
+  mDepthSets.resize(mDepthImages.size());
+  for (int i = 0; i < mDepthSets.size(); ++i) {
+    writeSet({mSampler, swapChain.getDepthImageView(i), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL},
+             mLevelViews[0], mDepthSets[i]);
+  }
+  mLevelSets.resize(mLevelViews.size() - 1);
+  for (size_t level = 0; level < mLevelSets.size(); ++level) {
+    writeSet({mSampler, mLevelViews[level], VK_IMAGE_LAYOUT_GENERAL}, mLevelViews[level + 1], mLevelSets[level]);
+  }
+}
+
+void VermicelliDepthPyramid::createPipeline() {
+  VkDescriptorSetLayout      setLayout = mSetLayout->getDescriptorSetLayout();
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts    = &setLayout;
+  if (vkCreatePipelineLayout(mDevice.device(), &pipelineLayoutInfo, nullptr, &mPipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create depth pyramid pipeline layout!");
+  }
+  mReduce = std::make_unique<VermicelliComputePipeline>(mDevice, "shaders/depth_pyramid.comp.spv", mPipelineLayout);
+}
+
+void VermicelliDepthPyramid::build(VkCommandBuffer commandBuffer, uint32_t imageIndex,
+                                   const glm::mat4 &viewProjection) {
+  VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+  if (mDepthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || mDepthFormat == VK_FORMAT_D24_UNORM_S8_UINT) {
+    depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+  }
+
+  /// The depth the render pass stored becomes readable; whatever read the pyramid before is done with it
+  std::array<VkImageMemoryBarrier, 2> barriers{};
+  barriers[0].sType                       = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barriers[0].srcAccessMask               = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  barriers[0].dstAccessMask               = VK_ACCESS_SHADER_READ_BIT;
+  barriers[0].oldLayout                   = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  barriers[0].newLayout                   = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  barriers[0].srcQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+  barriers[0].dstQueueFamilyIndex         = VK_QUEUE_FAMILY_IGNORED;
+  barriers[0].image                       = mDepthImages[imageIndex];
+  barriers[0].subresourceRange.aspectMask = depthAspect;
+  barriers[0].subresourceRange.levelCount = 1;
+  barriers[0].subresourceRange.layerCount = 1;
+
+  barriers[1]                             = barriers[0];
+  barriers[1].srcAccessMask               = 0;
+  barriers[1].dstAccessMask               = VK_ACCESS_SHADER_WRITE_BIT;
+  barriers[1].oldLayout                   = mBuilt ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
+  barriers[1].newLayout                   = VK_IMAGE_LAYOUT_GENERAL;
+  barriers[1].image                       = mImage;
+  barriers[1].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barriers[1].subresourceRange.levelCount = levelCount();
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr,
+                       static_cast<uint32_t>(barriers.size()), barriers.data());
+
+  /// Each level reads the one below it, so every dispatch waits for the last
+  VkMemoryBarrier levelBarrier{};
+  levelBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+  mReduce->bind(commandBuffer);
+  for (uint32_t level = 0; level < levelCount(); ++level) {
+    VkDescriptorSet set    = level == 0 ? mDepthSets[imageIndex] : mLevelSets[level - 1];
+    uint32_t        width  = std::max(mExtent.width >> level, 1u);
+    uint32_t        height = std::max(mExtent.height >> level, 1u);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1, &set, 0, nullptr);
+    vkCmdDispatch(commandBuffer, (width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+                  (height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         1, &levelBarrier, 0, nullptr, 0, nullptr);
+  }
+
+  /// Back to an attachment, for the render pass that carries on drawing into it
+  barriers[0].srcAccessMask = 0;
+  barriers[0].dstAccessMask =
+          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  barriers[0].oldLayout     = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  barriers[0].newLayout     = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 0, 0,
+                       nullptr, 0, nullptr, 1, barriers.data());
+
+  mViewProjection = viewProjection;
+  mBuilt          = true;
+}
+
+}
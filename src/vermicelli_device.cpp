@@ -7,6 +7,9 @@
  *********************************************************************************************************************/
 
 #include "vermicelli_device.h"
+#include "vermicelli_uploader.h"
+#include "vermicelli_deletion_queue.h"
+#include "vermicelli_frame_timeline.h"
 
 #include <cstring>
 #include <iostream>
@@ -60,9 +63,18 @@ VermicelliDevice::VermicelliDevice(VermicelliWindow &window, const bool verbose)
   pickPhysicalDevice();
   createLogicalDevice();
   createCommandPool();
+  mAllocator     = std::make_unique<VermicelliMemoryAllocator>(mInstance, mPhysicalDevice, mDevice_, mMemoryBudget,
+                                                               mVerbose);
+  mUploader      = std::make_unique<VermicelliUploader>(*this, mVerbose);
+  mDeletionQueue = std::make_unique<VermicelliDeletionQueue>(*this, mVerbose);
+  mFrameTimeline = std::make_unique<VermicelliFrameTimeline>(*this, mTimelineSemaphores, mVerbose);
 }
 
 VermicelliDevice::~VermicelliDevice() {
+  mDeletionQueue.reset();
+  mFrameTimeline.reset();
+  mUploader.reset();
+  mAllocator.reset();
   vkDestroyCommandPool(mDevice_, mCommandPool, nullptr);
   vkDestroyDevice(mDevice_, nullptr);
 
@@ -92,6 +104,19 @@ void VermicelliDevice::createInstance() {
   createInfo.pApplicationInfo = &appInfo;
 
   auto extensions = getRequiredExtensions();
+
+  /// Needed to query VK_EXT_memory_budget on a 1.0 instance; the allocator estimates usage without it
+  uint32_t availableCount = 0;
+  vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, nullptr);
+  std::vector<VkExtensionProperties> available(availableCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, available.data());
+  for (const auto &extension: available) {
+    if (std::string(extension.extensionName) == VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) {
+      extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+      mProperties2 = true;
+    }
+  }
+
   createInfo.enabledExtensionCount   = static_cast<uint32_t>(extensions.size());
   createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -148,6 +173,9 @@ void VermicelliDevice::createLogicalDevice() {
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
   std::set<uint32_t>                   uniqueQueueFamilies = {indices.mGraphicsFamily, indices.mPresentFamily};
+  if (indices.mTransferFamilyHasValue) {
+    uniqueQueueFamilies.insert(indices.mTransferFamily);
+  }
 
   float         queuePriority = 1.0f;
   for (uint32_t queueFamily: uniqueQueueFamilies) {
@@ -159,8 +187,15 @@ void VermicelliDevice::createLogicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(mPhysicalDevice, &supportedFeatures);
+
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
+  deviceFeatures.multiDrawIndirect         = supportedFeatures.multiDrawIndirect;
+  deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+  mMultiDrawIndirect         = supportedFeatures.multiDrawIndirect == VK_TRUE;
+  mDrawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance == VK_TRUE;
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -168,9 +203,49 @@ void VermicelliDevice::createLogicalDevice() {
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos    = queueCreateInfos.data();
 
+  /// Optional extensions, looked for only with properties2 since most need it; the engine falls back without each
+  std::vector<const char *> extensions = deviceExtensions;
+  VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+  timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+  if (mProperties2) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(mPhysicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(mPhysicalDevice, nullptr, &extensionCount, availableExtensions.data());
+    std::set<std::string> available;
+    for (const auto       &extension: availableExtensions) {
+      available.insert(extension.extensionName);
+    }
+
+    if (available.count(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+      extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+      mMemoryBudget = true;
+    }
+
+    if (available.count(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)) {
+      extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+      mDrawIndirectCountExtension = true;
+    }
+
+    auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+            vkGetInstanceProcAddr(mInstance, "vkGetPhysicalDeviceFeatures2KHR"));
+    if (available.count(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) && getFeatures2 != nullptr) {
+      VkPhysicalDeviceFeatures2 features{};
+      features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+      features.pNext = &timelineFeatures;
+      getFeatures2(mPhysicalDevice, &features);
+      if (timelineFeatures.timelineSemaphore) {
+        extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+        timelineFeatures.pNext = nullptr;
+        createInfo.pNext       = &timelineFeatures;
+        mTimelineSemaphores    = true;
+      }
+    }
+  }
+
   createInfo.pEnabledFeatures        = &deviceFeatures;
-  createInfo.enabledExtensionCount   = static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+  createInfo.enabledExtensionCount   = static_cast<uint32_t>(extensions.size());
+  createInfo.ppEnabledExtensionNames = extensions.data();
 
   // might not really be necessary anymore because mDevice specific validation layers
   // have been deprecated
@@ -187,6 +262,20 @@ void VermicelliDevice::createLogicalDevice() {
 
   vkGetDeviceQueue(mDevice_, indices.mGraphicsFamily, 0, &mGraphicsQueue_);
   vkGetDeviceQueue(mDevice_, indices.mPresentFamily, 0, &mPresentQueue_);
+  if (indices.mTransferFamilyHasValue) {
+    vkGetDeviceQueue(mDevice_, indices.mTransferFamily, 0, &mTransferQueue_);
+  } else {
+    mTransferQueue_ = mGraphicsQueue_;
+  }
+
+  if (mDrawIndirectCountExtension) {
+    mDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+            vkGetDeviceProcAddr(mDevice_, "vkCmdDrawIndexedIndirectCountKHR"));
+  }
+  if (mVerbose) {
+    std::cout << "Indirect draws: " << (mMultiDrawIndirect ? "multi-draw" : "one per call")
+              << (mDrawIndexedIndirectCount != nullptr ? ", count from the device" : "") << std::endl;
+  }
 }
 
 void VermicelliDevice::createCommandPool() {
@@ -364,6 +453,21 @@ QueueFamilyIndices VermicelliDevice::findQueueFamilies(VkPhysicalDevice device)
     i++;
   }
 
+  /// A transfer-only family is usually backed by DMA engines; a compute family without graphics is the next best
+  int           bestTransferScore = 0;
+  for (uint32_t family            = 0; family < queueFamilyCount; ++family) {
+    VkQueueFlags flags = queueFamilies[family].queueFlags;
+    if (queueFamilies[family].queueCount == 0 || !(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) {
+      continue;
+    }
+    int score = (flags & VK_QUEUE_COMPUTE_BIT) ? 1 : 2;
+    if (score > bestTransferScore) {
+      bestTransferScore               = score;
+      indices.mTransferFamily         = family;
+      indices.mTransferFamilyHasValue = true;
+    }
+  }
+
   return indices;
 }
 
@@ -427,7 +531,8 @@ void VermicelliDevice::createBuffer(
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer &buffer,
-        VkDeviceMemory &bufferMemory) {
+        VermicelliMemoryAllocator::Allocation &bufferMemory,
+        VermicelliMemoryAllocator::Category category) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size        = size;
@@ -441,16 +546,12 @@ void VermicelliDevice::createBuffer(
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(mDevice_, buffer, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize  = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+  bufferMemory = mAllocator->allocate(memRequirements, findMemoryType(memRequirements.memoryTypeBits, properties),
+                                      true, category);
 
-  if (vkAllocateMemory(mDevice_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate vertex buffer memory!");
+  if (vkBindBufferMemory(mDevice_, buffer, bufferMemory.mMemory, bufferMemory.mOffset) != VK_SUCCESS) {
+    throw std::runtime_error("failed to bind buffer memory!");
   }
-
-  vkBindBufferMemory(mDevice_, buffer, bufferMemory, 0);
 }
 
 VkCommandBuffer VermicelliDevice::beginSingleTimeCommands() {
@@ -485,12 +586,13 @@ void VermicelliDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   vkFreeCommandBuffers(mDevice_, mCommandPool, 1, &commandBuffer);
 }
 
-void VermicelliDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+void VermicelliDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset,
+                                  VkDeviceSize dstOffset) {
   VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
   VkBufferCopy copyRegion{};
-  copyRegion.srcOffset = 0;  // Optional
-  copyRegion.dstOffset = 0;  // Optional
+  copyRegion.srcOffset = srcOffset;
+  copyRegion.dstOffset = dstOffset;
   copyRegion.size      = size;
   vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
@@ -528,7 +630,8 @@ void VermicelliDevice::createImageWithInfo(
         const VkImageCreateInfo &imageInfo,
         VkMemoryPropertyFlags properties,
         VkImage &image,
-        VkDeviceMemory &imageMemory) {
+        VermicelliMemoryAllocator::Allocation &imageMemory,
+        VermicelliMemoryAllocator::Category category) {
   if (vkCreateImage(mDevice_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image!");
   }
@@ -536,16 +639,10 @@ void VermicelliDevice::createImageWithInfo(
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(mDevice_, image, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize  = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-  if (vkAllocateMemory(mDevice_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate image memory!");
-  }
+  imageMemory = mAllocator->allocate(memRequirements, findMemoryType(memRequirements.memoryTypeBits, properties),
+                                     imageInfo.tiling == VK_IMAGE_TILING_LINEAR, category);
 
-  if (vkBindImageMemory(mDevice_, image, imageMemory, 0) != VK_SUCCESS) {
+  if (vkBindImageMemory(mDevice_, image, imageMemory.mMemory, imageMemory.mOffset) != VK_SUCCESS) {
     throw std::runtime_error("failed to bind image memory!");
   }
 }
@@ -0,0 +1,75 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Linear allocator for data that only lives for one frame, backed by one persistently mapped buffer
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_frame_allocator.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace vermicelli {
+
+VermicelliFrameAllocator::VermicelliFrameAllocator(VermicelliDevice &device, const VkDeviceSize frameSize,
+                                                   const bool verbose)
+        : mVerbose(verbose), mFrameSize{frameSize},
+          mUniformAlignment{device.mProperties.limits.minUniformBufferOffsetAlignment},
+          mStorageAlignment{device.mProperties.limits.minStorageBufferOffsetAlignment} {
+  /// Partitions start on an alignment every usage accepts, so offsets within them only need the usage's own
+  VkDeviceSize partitionAlignment = std::max({mUniformAlignment, mStorageAlignment, VkDeviceSize{16}});
+  mFrameSize = (mFrameSize + partitionAlignment - 1) / partitionAlignment * partitionAlignment;
+
+  mBuffer = std::make_unique<VermicelliBuffer>(
+          device,
+          mFrameSize,
+          VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT,
+          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+          VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+          VermicelliMemoryAllocator::Category::UNIFORMS
+                                              );
+  mBuffer->map();
+
+  if (mVerbose) {
+    std::cout << "Frame allocator: " << VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT << " x " << mFrameSize / 1024
+              << " KiB" << std::endl;
+  }
+}
+
+void VermicelliFrameAllocator::beginFrame(const int frameIndex) {
+  mFrameBase = static_cast<VkDeviceSize>(frameIndex) * mFrameSize;
+  mHead      = 0;
+}
+
+VermicelliFrameAllocator::Allocation VermicelliFrameAllocator::allocate(const VkDeviceSize size, const Usage usage) {
+  VkDeviceSize alignment = usage == Usage::UNIFORM ? mUniformAlignment :
+                           usage == Usage::STORAGE ? mStorageAlignment : 16;
+  VkDeviceSize offset    = (mHead + alignment - 1) & ~(alignment - 1);
+  if (offset + size > mFrameSize) {
+    throw std::runtime_error("frame allocator out of space, increase its frame size!");
+  }
+  mHead     = offset + size;
+  mPeakUsed = std::max(mPeakUsed, mHead);
+
+  Allocation allocation{};
+  allocation.mOffset = mFrameBase + offset;
+  allocation.mSize   = size;
+  allocation.mData   = static_cast<uint8_t *>(mBuffer->getMappedMemory()) + allocation.mOffset;
+  return allocation;
+}
+
+void VermicelliFrameAllocator::flush() {
+  if (mHead > 0) {
+    mBuffer->flush(mHead, mFrameBase);
+  }
+}
+
+VkDescriptorBufferInfo VermicelliFrameAllocator::descriptorInfo(const VkDeviceSize range) const {
+  return VkDescriptorBufferInfo{mBuffer->getBuffer(), 0, range};
+}
+
+}
@@ -0,0 +1,154 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   One increasing counter the GPU advances as frames finish, for asking whether frame N is done
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_frame_timeline.h"
+#include "vermicelli_device.h"
+
+#include <cassert>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+namespace vermicelli {
+
+VermicelliFrameTimeline::VermicelliFrameTimeline(VermicelliDevice &device, const bool timelineSemaphores,
+                                                 const bool verbose)
+        : mDevice{device}, mVerbose(verbose) {
+  if (timelineSemaphores) {
+    mWaitSemaphores  = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(
+            vkGetDeviceProcAddr(mDevice.device(), "vkWaitSemaphoresKHR"));
+    mGetCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(
+            vkGetDeviceProcAddr(mDevice.device(), "vkGetSemaphoreCounterValueKHR"));
+  }
+
+  if (mWaitSemaphores != nullptr && mGetCounterValue != nullptr) {
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+    typeInfo.initialValue  = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(mDevice.device(), &semaphoreInfo, nullptr, &mSemaphore) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create frame timeline semaphore!");
+    }
+  }
+
+  if (mVerbose) {
+    std::cout << "Frame timeline: " << (usesTimelineSemaphore() ? "timeline semaphore" : "fences") << std::endl;
+  }
+}
+
+VermicelliFrameTimeline::~VermicelliFrameTimeline() {
+  if (mSemaphore != VK_NULL_HANDLE) {
+    vkDestroySemaphore(mDevice.device(), mSemaphore, nullptr);
+  }
+  for (const auto &pending: mPending) {
+    vkWaitForFences(mDevice.device(), 1, &pending.mFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    vkDestroyFence(mDevice.device(), pending.mFence, nullptr);
+  }
+  for (auto fence: mFreeFences) {
+    vkDestroyFence(mDevice.device(), fence, nullptr);
+  }
+}
+
+void VermicelliFrameTimeline::submit(VkQueue queue, const VkSubmitInfo &submitInfo, Value value) {
+  assert(value > mSubmitted && "Frame timeline values must increase");
+
+  if (usesTimelineSemaphore()) {
+    /// Binary semaphores in the same submission take a value too, it is ignored
+    std::vector<VkSemaphore> signalSemaphores(submitInfo.pSignalSemaphores,
+                                              submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+    signalSemaphores.push_back(mSemaphore);
+    std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+    signalValues.back() = value;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+    timelineInfo.pNext                     = submitInfo.pNext;
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+    timelineInfo.pSignalSemaphoreValues    = signalValues.data();
+
+    VkSubmitInfo timelineSubmit = submitInfo;
+    timelineSubmit.pNext                = &timelineInfo;
+    timelineSubmit.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+    timelineSubmit.pSignalSemaphores    = signalSemaphores.data();
+    if (vkQueueSubmit(queue, 1, &timelineSubmit, VK_NULL_HANDLE) != VK_SUCCESS) {
+      throw std::runtime_error("failed to submit command buffer!");
+    }
+  } else {
+    VkFence fence;
+    if (mFreeFences.empty()) {
+      VkFenceCreateInfo fenceInfo{};
+      fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+      if (vkCreateFence(mDevice.device(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create frame fence!");
+      }
+    } else {
+      fence = mFreeFences.back();
+      mFreeFences.pop_back();
+    }
+    if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+      throw std::runtime_error("failed to submit command buffer!");
+    }
+    mPending.push_back({value, fence});
+  }
+  mSubmitted = value;
+}
+
+void VermicelliFrameTimeline::retire(const PendingFence &pending) {
+  mCompleted = pending.mValue;
+  vkResetFences(mDevice.device(), 1, &pending.mFence);
+  mFreeFences.push_back(pending.mFence);
+}
+
+VermicelliFrameTimeline::Value VermicelliFrameTimeline::completedValue() {
+  if (usesTimelineSemaphore()) {
+    Value value;
+    if (mGetCounterValue(mDevice.device(), mSemaphore, &value) == VK_SUCCESS) {
+      mCompleted = value;
+    }
+    return mCompleted;
+  }
+
+  /// Submissions on one queue finish in order, so only the oldest fences need polling
+  while (!mPending.empty() && vkGetFenceStatus(mDevice.device(), mPending.front().mFence) == VK_SUCCESS) {
+    retire(mPending.front());
+    mPending.pop_front();
+  }
+  return mCompleted;
+}
+
+void VermicelliFrameTimeline::wait(Value value) {
+  if (value <= mCompleted) {
+    return;
+  }
+  assert(value <= mSubmitted && "Waiting for a frame that was never submitted would never return");
+
+  if (usesTimelineSemaphore()) {
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores    = &mSemaphore;
+    waitInfo.pValues        = &value;
+    if (mWaitSemaphores(mDevice.device(), &waitInfo, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS) {
+      throw std::runtime_error("failed to wait for frame timeline!");
+    }
+    mCompleted = value;
+    return;
+  }
+
+  while (!mPending.empty() && mPending.front().mValue <= value) {
+    vkWaitForFences(mDevice.device(), 1, &mPending.front().mFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    retire(mPending.front());
+    mPending.pop_front();
+  }
+}
+
+}
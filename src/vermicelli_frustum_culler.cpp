@@ -0,0 +1,282 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Frustum and small-feature culling of bounding spheres on the CPU, several at a time
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_frustum_culler.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VERMICELLI_CULL_X86
+#endif
+
+namespace vermicelli {
+
+/// The culler's arrays as one kernel sees them
+struct Spheres {
+    const float *mX;
+    const float *mY;
+    const float *mZ;
+    const float *mRadius;
+};
+
+/**
+ * @brief Appends the survivors of [begin, end) to visible; the wider kernels finish their last few spheres with it
+ */
+static void cullScalar(const VermicelliFrustumCuller::View &view, const Spheres &spheres, uint32_t begin,
+                       uint32_t end, uint32_t *visible, uint32_t &written, uint32_t &frustumCulled) {
+  const float diameterScale = 2.0f * view.mPixelsPerUnit;
+  for (uint32_t i = begin; i < end; ++i) {
+    const float x = spheres.mX[i], y = spheres.mY[i], z = spheres.mZ[i], radius = spheres.mRadius[i];
+    bool        inside = true;
+    /// Summed in the same order as the wider kernels, so every path culls exactly the same spheres
+    for (const auto &plane: view.mPlanes) {
+      inside = inside && (plane.x * x + plane.y * y) + (plane.z * z + plane.w) >= -radius;
+    }
+    if (!inside) {
+      ++frustumCulled;
+      continue;
+    }
+    /// Anything the camera is inside of, or close to, is kept whatever its size
+    const glm::vec4 &depthPlane = view.mDepthPlane;
+    float           depth       = (depthPlane.x * x + depthPlane.y * y) + (depthPlane.z * z + depthPlane.w);
+    if (depth <= radius || radius * diameterScale >= view.mMinPixels * depth) {
+      visible[written++] = i;
+    }
+  }
+}
+
+#ifdef VERMICELLI_CULL_X86
+
+static void cullSse(const VermicelliFrustumCuller::View &view, const Spheres &spheres, uint32_t end,
+                    uint32_t *visible, uint32_t &written, uint32_t &frustumCulled) {
+  __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+  for (int plane = 0; plane < 6; ++plane) {
+    planeX[plane] = _mm_set1_ps(view.mPlanes[plane].x);
+    planeY[plane] = _mm_set1_ps(view.mPlanes[plane].y);
+    planeZ[plane] = _mm_set1_ps(view.mPlanes[plane].z);
+    planeW[plane] = _mm_set1_ps(view.mPlanes[plane].w);
+  }
+  const __m128 depthX        = _mm_set1_ps(view.mDepthPlane.x);
+  const __m128 depthY        = _mm_set1_ps(view.mDepthPlane.y);
+  const __m128 depthZ        = _mm_set1_ps(view.mDepthPlane.z);
+  const __m128 depthW        = _mm_set1_ps(view.mDepthPlane.w);
+  const __m128 diameterScale = _mm_set1_ps(2.0f * view.mPixelsPerUnit);
+  const __m128 minPixels     = _mm_set1_ps(view.mMinPixels);
+
+  uint32_t i = 0;
+  for (; i + 4 <= end; i += 4) {
+    __m128 x         = _mm_loadu_ps(spheres.mX + i);
+    __m128 y         = _mm_loadu_ps(spheres.mY + i);
+    __m128 z         = _mm_loadu_ps(spheres.mZ + i);
+    __m128 radius    = _mm_loadu_ps(spheres.mRadius + i);
+    __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+    __m128 inside = _mm_cmpeq_ps(radius, radius);
+    for (int plane = 0; plane < 6; ++plane) {
+      __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[plane], x), _mm_mul_ps(planeY[plane], y)),
+                                   _mm_add_ps(_mm_mul_ps(planeZ[plane], z), planeW[plane]));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+    }
+    __m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(depthX, x), _mm_mul_ps(depthY, y)),
+                              _mm_add_ps(_mm_mul_ps(depthZ, z), depthW));
+    __m128 large = _mm_or_ps(_mm_cmple_ps(depth, radius),
+                             _mm_cmpge_ps(_mm_mul_ps(radius, diameterScale), _mm_mul_ps(minPixels, depth)));
+
+    auto insideMask = static_cast<unsigned>(_mm_movemask_ps(inside));
+    auto keep       = static_cast<unsigned>(_mm_movemask_ps(_mm_and_ps(inside, large)));
+    frustumCulled += 4 - std::popcount(insideMask);
+    for (; keep != 0; keep &= keep - 1) {
+      visible[written++] = i + std::countr_zero(keep);
+    }
+  }
+  cullScalar(view, spheres, i, end, visible, written, frustumCulled);
+}
+
+/// Built for AVX2 on its own, so the rest of the engine still runs on CPUs without it; only called when bestPath()
+/// found it
+__attribute__((target("avx2")))
+static void cullAvx2(const VermicelliFrustumCuller::View &view, const Spheres &spheres, uint32_t end,
+                     uint32_t *visible, uint32_t &written, uint32_t &frustumCulled) {
+  __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+  for (int plane = 0; plane < 6; ++plane) {
+    planeX[plane] = _mm256_set1_ps(view.mPlanes[plane].x);
+    planeY[plane] = _mm256_set1_ps(view.mPlanes[plane].y);
+    planeZ[plane] = _mm256_set1_ps(view.mPlanes[plane].z);
+    planeW[plane] = _mm256_set1_ps(view.mPlanes[plane].w);
+  }
+  const __m256 depthX        = _mm256_set1_ps(view.mDepthPlane.x);
+  const __m256 depthY        = _mm256_set1_ps(view.mDepthPlane.y);
+  const __m256 depthZ        = _mm256_set1_ps(view.mDepthPlane.z);
+  const __m256 depthW        = _mm256_set1_ps(view.mDepthPlane.w);
+  const __m256 diameterScale = _mm256_set1_ps(2.0f * view.mPixelsPerUnit);
+  const __m256 minPixels     = _mm256_set1_ps(view.mMinPixels);
+
+  /// Multiplies and adds stay separate rather than fused, so this culls exactly what the other paths do
+  uint32_t i = 0;
+  for (; i + 8 <= end; i += 8) {
+    __m256 x         = _mm256_loadu_ps(spheres.mX + i);
+    __m256 y         = _mm256_loadu_ps(spheres.mY + i);
+    __m256 z         = _mm256_loadu_ps(spheres.mZ + i);
+    __m256 radius    = _mm256_loadu_ps(spheres.mRadius + i);
+    __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), radius);
+
+    __m256 inside = _mm256_cmp_ps(radius, radius, _CMP_EQ_OQ);
+    for (int plane = 0; plane < 6; ++plane) {
+      __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[plane], x), _mm256_mul_ps(planeY[plane], y)),
+                                      _mm256_add_ps(_mm256_mul_ps(planeZ[plane], z), planeW[plane]));
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+    }
+    __m256 depth = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(depthX, x), _mm256_mul_ps(depthY, y)),
+                                 _mm256_add_ps(_mm256_mul_ps(depthZ, z), depthW));
+    __m256 large = _mm256_or_ps(_mm256_cmp_ps(depth, radius, _CMP_LE_OQ),
+                                _mm256_cmp_ps(_mm256_mul_ps(radius, diameterScale), _mm256_mul_ps(minPixels, depth),
+                                              _CMP_GE_OQ));
+
+    auto insideMask = static_cast<unsigned>(_mm256_movemask_ps(inside));
+    auto keep       = static_cast<unsigned>(_mm256_movemask_ps(_mm256_and_ps(inside, large)));
+    frustumCulled += 8 - std::popcount(insideMask);
+    for (; keep != 0; keep &= keep - 1) {
+      visible[written++] = i + std::countr_zero(keep);
+    }
+  }
+  cullScalar(view, spheres, i, end, visible, written, frustumCulled);
+}
+
+#endif
+
+VermicelliFrustumCuller::View VermicelliFrustumCuller::View::fromCamera(const VermicelliCamera &camera,
+                                                                        const uint32_t height, const float minPixels) {
+  View            view{};
+  const glm::mat4 &viewMatrix = camera.getView();
+  view.mPlanes        = camera.getFrustumPlanes();
+  view.mDepthPlane    = glm::vec4(viewMatrix[0][2], viewMatrix[1][2], viewMatrix[2][2], viewMatrix[3][2]);
+  /// projection[1][1] is cot(fovY / 2), which spans half the height at a depth of 1
+  view.mPixelsPerUnit = camera.getProjection()[1][1] * 0.5f * static_cast<float>(height);
+  view.mMinPixels     = minPixels;
+  return view;
+}
+
+VermicelliFrustumCuller::VermicelliFrustumCuller(const Path path) : mPath(path) {}
+
+VermicelliFrustumCuller::Path VermicelliFrustumCuller::bestPath() {
+#ifdef VERMICELLI_CULL_X86
+  if (__builtin_cpu_supports("avx2")) {
+    return Path::AVX2;
+  }
+  return Path::SSE;
+#else
+  return Path::SCALAR;
+#endif
+}
+
+const char *VermicelliFrustumCuller::pathName(const Path path) {
+  switch (path) {
+    case Path::SCALAR:
+      return "scalar";
+    case Path::SSE:
+      return "SSE";
+    case Path::AVX2:
+      return "AVX2";
+  }
+  return "unknown";
+}
+
+void VermicelliFrustumCuller::clear() {
+  mX.clear();
+  mY.clear();
+  mZ.clear();
+  mRadius.clear();
+}
+
+void VermicelliFrustumCuller::add(const glm::vec4 &sphere) {
+  mX.push_back(sphere.x);
+  mY.push_back(sphere.y);
+  mZ.push_back(sphere.z);
+  mRadius.push_back(sphere.w);
+}
+
+const VermicelliFrustumCuller::Stats &VermicelliFrustumCuller::cull(const View &view, std::vector<uint32_t> &visible) {
+  auto start = std::chrono::steady_clock::now();
+
+  const auto count   = static_cast<uint32_t>(mRadius.size());
+  Spheres    spheres{mX.data(), mY.data(), mZ.data(), mRadius.data()};
+  uint32_t   written = 0;
+  mStats = {};
+  visible.resize(count);
+  switch (mPath) {
+#ifdef VERMICELLI_CULL_X86
+    case Path::AVX2:
+      cullAvx2(view, spheres, count, visible.data(), written, mStats.mFrustumCulled);
+      break;
+    case Path::SSE:
+      cullSse(view, spheres, count, visible.data(), written, mStats.mFrustumCulled);
+      break;
+#endif
+    default:
+      cullScalar(view, spheres, 0, count, visible.data(), written, mStats.mFrustumCulled);
+      break;
+  }
+  visible.resize(written);
+
+  mStats.mTested       = count;
+  mStats.mVisible      = written;
+  mStats.mSmallCulled  = count - written - mStats.mFrustumCulled;
+  mStats.mMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return mStats;
+}
+
+void VermicelliFrustumCuller::benchmark(const uint32_t objectCount) {
+  /// Objects scattered all around the camera, so most of them are outside the frustum, and many far enough to be
+  /// under a pixel, much like a large open scene
+  VermicelliCamera camera{};
+  camera.setPerspectiveProjection(glm::radians(50.0f), 4.0f / 3.0f, 0.01f, 100.0f);
+  camera.setViewYXZ(glm::vec3{0.0f}, glm::vec3{0.0f});
+  View view = View::fromCamera(camera, 600, 1.0f);
+
+  std::mt19937                          random{42};
+  std::uniform_real_distribution<float> position{-100.0f, 100.0f};
+  std::uniform_real_distribution<float> radius{0.01f, 1.0f};
+  std::vector<glm::vec4>                spheres(objectCount);
+  for (auto                             &sphere: spheres) {
+    sphere = {position(random), position(random), position(random), radius(random)};
+  }
+
+  std::vector<Path> paths{Path::SCALAR};
+#ifdef VERMICELLI_CULL_X86
+  paths.push_back(Path::SSE);
+  if (bestPath() == Path::AVX2) {
+    paths.push_back(Path::AVX2);
+  }
+#endif
+
+  constexpr int iterations = 100;
+  std::cout << "Culling " << objectCount << " spheres, best of " << iterations << " runs:" << std::endl;
+  std::vector<uint32_t> visible;
+  for (Path path: paths) {
+    VermicelliFrustumCuller culler{path};
+    for (const auto &sphere: spheres) {
+      culler.add(sphere);
+    }
+    float best = std::numeric_limits<float>::max();
+    for (int i = 0; i < iterations; ++i) {
+      best = std::min(best, culler.cull(view, visible).mMilliseconds);
+    }
+    const Stats &stats = culler.stats();
+    std::cout << "  " << pathName(path) << ": " << best << " ms, " << stats.mVisible << " visible, "
+              << stats.mFrustumCulled << " outside the frustum, " << stats.mSmallCulled << " under "
+              << view.mMinPixels << " pixel" << std::endl;
+  }
+}
+
+}
@@ -13,7 +13,33 @@
 namespace vermicelli {
 
 void helpMenu() {
-  std::cout << "Vermicelli, a Vulkan Renderer and Engine built on SDL2" << std::endl;
+  std::cout << "Vermicelli, a Vulkan Renderer and Engine built on SDL2" << std::endl
+            << std::endl
+            << "Usage: vermicelli [options]" << std::endl
+            << std::endl
+            << "Rendering:" << std::endl
+            << "  --compact                  Store vertices as 20-byte quantized CompactVertex" << std::endl
+            << "  --gpu-culling              Cull and build indirect draws in compute shaders" << std::endl
+            << "  --occlusion-culling        Also cull against last frame's depth pyramid, implies --gpu-culling"
+            << std::endl
+            << "  --cpu-occlusion            Cull objects drawn from the CPU against a software-rasterized depth"
+            << std::endl
+            << "  --lod-bias=<stops>         Powers of two added to the LOD pixel error, positive picks coarser levels"
+            << std::endl
+            << "  --verbose                  Print loading, memory and per-frame culling statistics" << std::endl
+            << "  --brief                    Print only errors, the default" << std::endl
+            << std::endl
+            << "Benchmarks, run without opening a window:" << std::endl
+            << "  --benchmark-culling        Frustum culling of 100000 spheres on every CPU path" << std::endl
+            << "  --benchmark-occlusion      CPU occlusion of 10000 objects among 1000 buildings" << std::endl
+            << "  --benchmark-vertex-encoding" << std::endl
+            << "                             Encoding and decoding CompactVertex on the CPU, nothing is drawn"
+            << std::endl
+            << "  --benchmark-welding=<obj>  Vertex welding of an OBJ file, against std::unordered_map" << std::endl
+            << "  --benchmark-mesh-cache=<obj>" << std::endl
+            << "                             Building an OBJ file from source against its mesh cache" << std::endl
+            << std::endl
+            << "  -h, --help                 Show this help" << std::endl;
 }
 
 namespace color {
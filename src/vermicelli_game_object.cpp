@@ -7,10 +7,21 @@
  *********************************************************************************************************************/
 
 #include "vermicelli_game_object.h"
+#include "vermicelli_scene_buffer.h"
 
 namespace vermicelli {
 
-glm::mat3 TransformComponent::normalMatrix() {
+void VermicelliGameObject::acquireSceneSlot(VermicelliSceneBuffer &scene) {
+  mSceneSlot      = scene.allocate();
+  mSceneSlotOwner = {&scene, SceneSlotRelease{mSceneSlot}};
+  mSceneDirty     = true;
+}
+
+void VermicelliGameObject::SceneSlotRelease::operator()(VermicelliSceneBuffer *scene) const {
+  scene->release(mSlot);
+}
+
+glm::mat3 TransformComponent::normalMatrix() const {
   const float     c3           = glm::cos(mRotation.z);
   const float     s3           = glm::sin(mRotation.z);
   const float     c2           = glm::cos(mRotation.x);
@@ -34,7 +45,7 @@ glm::mat3 TransformComponent::normalMatrix() {
           {inverseScale.z * (c2 * s1),                inverseScale.z * (-s2),     inverseScale.z * (c1 * c2),}};
 }
 
-glm::mat4 TransformComponent::mat4() {
+glm::mat4 TransformComponent::mat4() const {
   const float c3 = glm::cos(mRotation.z);
   const float s3 = glm::sin(mRotation.z);
   const float c2 = glm::cos(mRotation.x);
@@ -0,0 +1,257 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Shared device-local vertex and index buffers that every model suballocates from
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_geometry_arena.h"
+#include "vermicelli_deletion_queue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace vermicelli {
+
+VermicelliGeometryArena::Pool::Pool(VermicelliDevice &device, uint32_t elementSize, VkBufferUsageFlags usage,
+                                    const char *name, bool verbose)
+        : mDevice{device}, mElementSize(elementSize),
+          mUsage(usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT), mName(name),
+          mVerbose(verbose) {}
+
+bool VermicelliGeometryArena::Pool::tryAllocate(uint32_t count, uint32_t &offset) {
+  for (auto range = mFreeList.begin(); range != mFreeList.end(); ++range) {
+    if (range->mCount >= count) {
+      offset = range->mOffset;
+      range->mOffset += count;
+      range->mCount -= count;
+      if (range->mCount == 0) {
+        mFreeList.erase(range);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+VermicelliGeometryArena::Handle
+VermicelliGeometryArena::Pool::allocate(const void *data, uint32_t count, VermicelliUploader::Ticket &ticket) {
+  assert(count > 0 && "Cannot allocate an empty range");
+
+  uint32_t offset;
+  if (!tryAllocate(count, offset)) {
+    /// Packing is enough when the free space is only fragmented, otherwise the buffer has to grow as well
+    uint32_t capacity = mCapacity;
+    if (mCapacity - mUsed < count) {
+      capacity = std::max({mCapacity * 2, mUsed + count, INITIAL_BYTES / mElementSize});
+    }
+    relocate(capacity);
+    bool allocated = tryAllocate(count, offset);
+    assert(allocated && "Relocated pool must have room for the allocation");
+  }
+
+  Handle handle;
+  if (!mFreeHandles.empty()) {
+    handle = mFreeHandles.back();
+    mFreeHandles.pop_back();
+    mRanges[handle] = {offset, count};
+  } else {
+    handle = static_cast<Handle>(mRanges.size());
+    mRanges.push_back({offset, count});
+  }
+  mUsed += count;
+
+  VkDeviceSize elementSize = mElementSize;
+  ticket      = mDevice.uploader().upload(mBuffer->getBuffer(), elementSize * offset, data, elementSize * count);
+  mLastTicket = ticket;
+  return handle;
+}
+
+void VermicelliGeometryArena::Pool::free(Handle handle) {
+  if (handle == INVALID_HANDLE) {
+    return;
+  }
+  Range range = mRanges[handle];
+  assert(range.mCount > 0 && "Range freed twice");
+  mRanges[handle].mCount = 0;
+  mFreeHandles.push_back(handle);
+  mUsed -= range.mCount;
+
+  auto next = std::lower_bound(mFreeList.begin(), mFreeList.end(), range,
+                               [](const Range &lhs, const Range &rhs) { return lhs.mOffset < rhs.mOffset; });
+  if (next != mFreeList.end() && range.mOffset + range.mCount == next->mOffset) {
+    range.mCount += next->mCount;
+    next = mFreeList.erase(next);
+  }
+  if (next != mFreeList.begin()) {
+    auto previous = std::prev(next);
+    if (previous->mOffset + previous->mCount == range.mOffset) {
+      previous->mCount += range.mCount;
+      return;
+    }
+  }
+  mFreeList.insert(next, range);
+}
+
+uint32_t VermicelliGeometryArena::Pool::holes() const {
+  uint32_t free = mCapacity - mUsed;
+  if (!mFreeList.empty() && mFreeList.back().mOffset + mFreeList.back().mCount == mCapacity) {
+    free -= mFreeList.back().mCount;
+  }
+  return free;
+}
+
+void VermicelliGeometryArena::Pool::compact() {
+  if (mBuffer && holes() > 0) {
+    relocate(mCapacity);
+  }
+}
+
+void VermicelliGeometryArena::Pool::relocate(uint32_t capacity) {
+  auto buffer = std::make_unique<VermicelliBuffer>(
+          mDevice,
+          mElementSize,
+          capacity,
+          mUsage,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+          VermicelliMemoryAllocator::Category::GEOMETRY
+                                                  );
+
+  std::vector<Handle> live;
+  for (Handle         handle = 0; handle < mRanges.size(); ++handle) {
+    if (mRanges[handle].mCount > 0) {
+      live.push_back(handle);
+    }
+  }
+  std::sort(live.begin(), live.end(),
+            [this](Handle lhs, Handle rhs) { return mRanges[lhs].mOffset < mRanges[rhs].mOffset; });
+
+  std::vector<VkBufferCopy> regions;
+  uint32_t                  packed = 0;
+  for (Handle               handle: live) {
+    Range &range = mRanges[handle];
+    regions.push_back({static_cast<VkDeviceSize>(range.mOffset) * mElementSize,
+                       static_cast<VkDeviceSize>(packed) * mElementSize,
+                       static_cast<VkDeviceSize>(range.mCount) * mElementSize});
+    range.mOffset = packed;
+    packed += range.mCount;
+  }
+
+  /// Frames still in flight may draw from the old buffer, so it is only retired once a frame has copied out of it
+  if (!regions.empty()) {
+    mPendingCopies.push_back({std::move(mBuffer), buffer->getBuffer(), std::move(regions)});
+  } else {
+    mDevice.deletionQueue().retire(std::move(mBuffer));
+  }
+
+  if (mVerbose) {
+    std::cout << "Geometry arena: " << mName << " pool " << (capacity != mCapacity ? "grown" : "compacted") << " to "
+              << capacity << " x " << mElementSize << " bytes, " << packed << " in use" << std::endl;
+  }
+
+  mBuffer   = std::move(buffer);
+  mCapacity = capacity;
+  ++mRelocations;
+  mFreeList.clear();
+  if (packed < capacity) {
+    mFreeList.push_back({packed, capacity - packed});
+  }
+}
+
+bool VermicelliGeometryArena::Pool::recordCopies(VkCommandBuffer commandBuffer) {
+  if (mPendingCopies.empty()) {
+    return false;
+  }
+
+  /// Uploads into the old buffers are ordered before the copies once their batch is submitted ahead of this frame
+  mDevice.uploader().isComplete(mLastTicket);
+
+  VkMemoryBarrier barrier{};
+  barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  for (size_t index = 0; index < mPendingCopies.size(); ++index) {
+    const PendingCopy &copy = mPendingCopies[index];
+    /// A pool that relocated twice copies out of the buffer the previous copy just filled
+    if (index > 0) {
+      vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                           &barrier, 0, nullptr, 0, nullptr);
+    }
+    vkCmdCopyBuffer(commandBuffer, copy.mSource->getBuffer(), copy.mDestination,
+                    static_cast<uint32_t>(copy.mRegions.size()), copy.mRegions.data());
+  }
+
+  /// The deletion queue is stamped with this frame, so the sources outlive both the copies and any earlier draws
+  for (PendingCopy &copy: mPendingCopies) {
+    mDevice.deletionQueue().retire(std::move(copy.mSource));
+  }
+  mPendingCopies.clear();
+  return true;
+}
+
+VermicelliGeometryArena::VermicelliGeometryArena(VermicelliDevice &device, const bool verbose)
+        : mDevice{device}, mVerbose(verbose),
+          mFullVertices{device, sizeof(VermicelliModel::Vertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, "vertex", verbose},
+          mCompactVertices{device, sizeof(VermicelliModel::CompactVertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                           "compact vertex", verbose},
+          mShortIndices{device, sizeof(uint16_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, "uint16 index", verbose},
+          mIndices{device, sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, "uint32 index", verbose} {}
+
+VermicelliGeometryArena::Pool &VermicelliGeometryArena::vertices(VermicelliModel::VertexFormat format) {
+  return format == VermicelliModel::VertexFormat::COMPACT ? mCompactVertices : mFullVertices;
+}
+
+VermicelliGeometryArena::Pool &VermicelliGeometryArena::indices(VkIndexType indexType) {
+  return indexType == VK_INDEX_TYPE_UINT16 ? mShortIndices : mIndices;
+}
+
+void VermicelliGeometryArena::bind(VkCommandBuffer commandBuffer, VermicelliModel::VertexFormat format,
+                                   VkIndexType indexType) {
+  VkBuffer     buffers[] = {vertices(format).buffer()};
+  VkDeviceSize offsets[] = {0};
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+
+  if (VkBuffer indexBuffer = indices(indexType).buffer(); indexBuffer != VK_NULL_HANDLE) {
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+  }
+}
+
+void VermicelliGeometryArena::compact() {
+  for (Pool *pool: {&mFullVertices, &mCompactVertices, &mShortIndices, &mIndices}) {
+    if (static_cast<float>(pool->holes()) > FRAGMENTATION_LIMIT * static_cast<float>(pool->capacity())) {
+      pool->compact();
+    }
+  }
+}
+
+void VermicelliGeometryArena::recordCopies(VkCommandBuffer commandBuffer) {
+  bool recorded = false;
+  for (Pool *pool: {&mFullVertices, &mCompactVertices, &mShortIndices, &mIndices}) {
+    recorded |= pool->recordCopies(commandBuffer);
+  }
+  if (!recorded) {
+    return;
+  }
+
+  VkMemoryBarrier barrier{};
+  barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT |
+                          VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+}
+
+uint64_t VermicelliGeometryArena::layoutVersion() const {
+  uint64_t version = 0;
+  for (const Pool *pool: {&mFullVertices, &mCompactVertices, &mShortIndices, &mIndices}) {
+    version += pool->relocations();
+  }
+  return version;
+}
+
+}
@@ -0,0 +1,343 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Frustum culls instanced batches on the GPU and turns the survivors into indirect draws
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_gpu_culling.h"
+#include "vermicelli_deletion_queue.h"
+#include "vermicelli_frustum_culler.h"
+#include "vermicelli_model.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace vermicelli {
+
+/// Invocations per workgroup of both passes, local_size_x in the shaders
+static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+VermicelliGpuCulling::VermicelliGpuCulling(VermicelliDevice &device, const bool verbose)
+        : mDevice{device}, mVerbose(verbose) {
+  mSetLayout = VermicelliDescriptorSetLayout::Builder(mDevice)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT) // GlobalUbo
+          .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)         // Scene buffer
+          .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)         // Frame allocator
+          .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)         // Visible slots
+          .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)         // Instance counts
+          .addBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)         // Commands
+          .addBinding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)         // Draw counts
+          .addBinding(7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // Depth pyramid
+          .addBinding(8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)         // Candidates
+          .addBinding(9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)         // Candidate counts
+          .addBinding(10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)        // Stats
+          .build();
+  mPool      = VermicelliDescriptorPool::Builder(mDevice)
+          .setMaxSets(VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 9 * VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT)
+          .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT)
+          .build();
+  createPipelines();
+
+  if (mVerbose) {
+    std::cout << "GPU culling: groups drawn with "
+              << (mDevice.drawIndexedIndirectCount() ? "vkCmdDrawIndexedIndirectCount"
+                                                     : mDevice.multiDrawIndirect()
+                                                       ? "multi-draw indirect, emptied commands drawing nothing"
+                                                       : "one vkCmdDrawIndexedIndirect per command") << std::endl;
+  }
+}
+
+VermicelliGpuCulling::~VermicelliGpuCulling() {
+  vkDestroyPipelineLayout(mDevice.device(), mPipelineLayout, nullptr);
+}
+
+void VermicelliGpuCulling::createPipelines() {
+  VkDescriptorSetLayout setLayout = mSetLayout->getDescriptorSetLayout();
+  VkPushConstantRange   pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset     = 0;
+  pushConstantRange.size       = sizeof(PushConstants);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount         = 1;
+  pipelineLayoutInfo.pSetLayouts            = &setLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges    = &pushConstantRange;
+  if (vkCreatePipelineLayout(mDevice.device(), &pipelineLayoutInfo, nullptr, &mPipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create culling pipeline layout!");
+  }
+
+  mInstancePass = std::make_unique<VermicelliComputePipeline>(mDevice, "shaders/cull_instances.comp.spv",
+                                                              mPipelineLayout);
+  mCommandPass  = std::make_unique<VermicelliComputePipeline>(mDevice, "shaders/cull_commands.comp.spv",
+                                                              mPipelineLayout);
+}
+
+void VermicelliGpuCulling::createOcclusionPipelines() {
+  VkSpecializationMapEntry lateEntry{0, 0, sizeof(VkBool32)}; // LATE
+  VkBool32                 late = VK_FALSE;
+  VkSpecializationInfo     specializationInfo{1, &lateEntry, sizeof(VkBool32), &late};
+  mEarlyPass = std::make_unique<VermicelliComputePipeline>(mDevice, "shaders/cull_occlusion.comp.spv",
+                                                           mPipelineLayout, &specializationInfo);
+  late       = VK_TRUE;
+  mLatePass  = std::make_unique<VermicelliComputePipeline>(mDevice, "shaders/cull_occlusion.comp.spv",
+                                                           mPipelineLayout, &specializationInfo);
+}
+
+void VermicelliGpuCulling::cull(const FrameInfo &frameInfo, const std::vector<VermicelliSceneBuffer::Slot> &instances,
+                                const std::vector<Batch> &batches, const float minPixels,
+                                const VermicelliDepthPyramid *pyramid) {
+  /// The slot's last frame is done, so what its occlusion passes counted can be read, and its buffers and descriptor
+  /// set are free to be replaced
+  FrameBuffers &frame = mFrames[frameInfo.mFrameIndex];
+  if (frame.mStatsWritten) {
+    const auto *counts  = static_cast<const uint32_t *>(frame.mStats->getMappedMemory());
+    mOcclusionStats     = {counts[0], counts[1], counts[2] - counts[3], counts[3]};
+    frame.mStatsWritten = false;
+  }
+  mOccluding = false;
+
+  /// One command per submesh of each batch's level, in batch order, split wherever the bound state has to change
+  mTemplates.clear();
+  mGroups.clear();
+  for (uint32_t batch = 0; batch < batches.size(); ++batch) {
+    const Batch           &current = batches[batch];
+    const VermicelliModel &model   = *current.mModel;
+    assert(model.hasIndexBuffer() && "Only indexed models can be drawn through GPU culling");
+    if (mGroups.empty() || mGroups.back().mModel->vertexFormat() != model.vertexFormat() ||
+        mGroups.back().mModel->indexType() != model.indexType()) {
+      mGroups.push_back({&model, static_cast<uint32_t>(mTemplates.size()), 0});
+    }
+
+    uint32_t   baseIndex  = model.baseIndex();
+    int32_t    baseVertex = model.baseVertex();
+    const auto &level     = model.lod(std::min(current.mLod, model.lodCount() - 1));
+    for (uint32_t i = level.mFirstSubmesh; i < level.mFirstSubmesh + level.mSubmeshCount; ++i) {
+      const auto &submesh = model.submeshes()[i];
+      mTemplates.push_back({{submesh.mIndexCount, 0, baseIndex + submesh.mFirstIndex,
+                             baseVertex + submesh.mVertexOffset, current.mFirstInstance}, batch});
+      ++mGroups.back().mCommandCount;
+    }
+  }
+  if (mGroups.empty()) {
+    return;
+  }
+  assert(batches.size() <= mDevice.mProperties.limits.maxComputeWorkGroupCount[0] &&
+         mGroups.size() <= mDevice.mProperties.limits.maxComputeWorkGroupCount[0] &&
+         "Too many batches to cull in one dispatch");
+
+  /// The inputs are streamed through the frame allocator, which binding 2 covers whole
+  auto &frameAllocator = frameInfo.mFrameAllocator;
+  auto instanceData    = frameAllocator.allocate(instances.size() * sizeof(uint32_t),
+                                                 VermicelliFrameAllocator::Usage::STORAGE);
+  auto batchData       = frameAllocator.allocate(batches.size() * 2 * sizeof(uint32_t),
+                                                 VermicelliFrameAllocator::Usage::STORAGE);
+  auto commandData     = frameAllocator.allocate(mTemplates.size() * sizeof(CommandTemplate),
+                                                 VermicelliFrameAllocator::Usage::STORAGE);
+  auto groupData       = frameAllocator.allocate(mGroups.size() * 2 * sizeof(uint32_t),
+                                                 VermicelliFrameAllocator::Usage::STORAGE);
+  std::memcpy(instanceData.mData, instances.data(), instances.size() * sizeof(uint32_t));
+  std::memcpy(commandData.mData, mTemplates.data(), mTemplates.size() * sizeof(CommandTemplate));
+  auto *batchWords = static_cast<uint32_t *>(batchData.mData);
+  for (size_t batch = 0; batch < batches.size(); ++batch) {
+    batchWords[2 * batch]     = batches[batch].mFirstInstance;
+    batchWords[2 * batch + 1] = batches[batch].mInstanceCount;
+  }
+  auto *groupWords = static_cast<uint32_t *>(groupData.mData);
+  for (size_t group = 0; group < mGroups.size(); ++group) {
+    groupWords[2 * group]     = mGroups[group].mFirstCommand;
+    groupWords[2 * group + 1] = mGroups[group].mCommandCount;
+  }
+
+  bool replaced = reserve(frame.mVisible, sizeof(uint32_t), instances.size(),
+                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+  replaced |= reserve(frame.mInstanceCounts, sizeof(uint32_t), batches.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+  replaced |= reserve(frame.mCommands, sizeof(VkDrawIndexedIndirectCommand), mTemplates.size(),
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+  replaced |= reserve(frame.mDrawCounts, sizeof(uint32_t), mGroups.size(),
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+
+  /// Nothing is hidden by a pyramid that has not been built yet, and the plain pass is left to find that out
+  mOccluding = pyramid != nullptr && pyramid->isBuilt();
+  if (mOccluding) {
+    if (mEarlyPass == nullptr) {
+      createOcclusionPipelines();
+    }
+    replaced |= reserve(frame.mCandidates, sizeof(uint32_t), instances.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    replaced |= reserve(frame.mCandidateCounts, sizeof(uint32_t), batches.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    if (frame.mStats == nullptr) {
+      frame.mStats = std::make_unique<VermicelliBuffer>(
+              mDevice,
+              sizeof(uint32_t),
+              4,
+              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+              VermicelliMemoryAllocator::Category::OTHER
+                                                       );
+      frame.mStats->map();
+      replaced = true;
+    }
+    std::memset(frame.mStats->getMappedMemory(), 0, 4 * sizeof(uint32_t));
+    replaced |= frame.mPyramid != pyramid->descriptorInfo().imageView;
+  } else {
+    frame.mPyramid = VK_NULL_HANDLE; // Written again once occlusion is back, in case the pyramid changed meanwhile
+  }
+  if (replaced || frame.mFrameData != frameAllocator.buffer()) {
+    writeDescriptorSet(frameInfo, frame, mOccluding ? pyramid : nullptr);
+  }
+
+  auto words = [](const VermicelliFrameAllocator::Allocation &allocation) {
+    return static_cast<uint32_t>(allocation.mOffset / sizeof(uint32_t));
+  };
+  auto view = VermicelliFrustumCuller::View::fromCamera(frameInfo.mCamera, frameInfo.mExtent.height, minPixels);
+  mPush       = {words(instanceData), words(batchData), words(commandData), words(groupData),
+                 mOccluding ? pyramid->viewProjection() : glm::mat4{1.0f}, view.mPixelsPerUnit, view.mMinPixels};
+  mBatchCount = static_cast<uint32_t>(batches.size());
+  dispatch(frameInfo, mOccluding ? *mEarlyPass : *mInstancePass);
+}
+
+void VermicelliGpuCulling::cullLate(const FrameInfo &frameInfo, const VermicelliDepthPyramid &pyramid) {
+  if (!mOccluding) {
+    return;
+  }
+  mPush.mViewProjection = pyramid.viewProjection();
+
+  /// The first draws are done with the buffers about to be written again, and the candidates are there to be read
+  VkCommandBuffer commandBuffer = frameInfo.mCommandBuffer;
+  VkMemoryBarrier barrier{};
+  barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &barrier, 0, nullptr, 0, nullptr);
+
+  dispatch(frameInfo, *mLatePass);
+
+  /// Read back as the slot comes around again
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier,
+                       0, nullptr, 0, nullptr);
+  mFrames[frameInfo.mFrameIndex].mStatsWritten = true;
+}
+
+void VermicelliGpuCulling::dispatch(const FrameInfo &frameInfo, VermicelliComputePipeline &instancePass) {
+  VkCommandBuffer commandBuffer = frameInfo.mCommandBuffer;
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 1,
+                          &mFrames[frameInfo.mFrameIndex].mDescriptorSet, 1, &frameInfo.mGlobalUboOffset);
+  vkCmdPushConstants(commandBuffer, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &mPush);
+
+  instancePass.bind(commandBuffer);
+  vkCmdDispatch(commandBuffer, mBatchCount, 1, 1);
+
+  VkMemoryBarrier barrier{};
+  barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &barrier, 0, nullptr, 0, nullptr);
+
+  mCommandPass->bind(commandBuffer);
+  vkCmdDispatch(commandBuffer, static_cast<uint32_t>(mGroups.size()), 1, 1);
+
+  barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+}
+
+void VermicelliGpuCulling::draw(const FrameInfo &frameInfo, VkCommandBuffer commandBuffer, size_t group) const {
+  const Group        &current = mGroups[group];
+  const FrameBuffers &frame   = mFrames[frameInfo.mFrameIndex];
+  constexpr uint32_t stride   = sizeof(VkDrawIndexedIndirectCommand);
+  VkDeviceSize       offset   = current.mFirstCommand * static_cast<VkDeviceSize>(stride);
+
+  if (auto drawIndexedIndirectCount = mDevice.drawIndexedIndirectCount()) {
+    drawIndexedIndirectCount(commandBuffer, frame.mCommands->getBuffer(), offset, frame.mDrawCounts->getBuffer(),
+                             group * sizeof(uint32_t), current.mCommandCount, stride);
+  } else if (mDevice.multiDrawIndirect()) {
+    vkCmdDrawIndexedIndirect(commandBuffer, frame.mCommands->getBuffer(), offset, current.mCommandCount, stride);
+  } else {
+    for (uint32_t i = 0; i < current.mCommandCount; ++i) {
+      vkCmdDrawIndexedIndirect(commandBuffer, frame.mCommands->getBuffer(), offset + i * stride, 1, stride);
+    }
+  }
+}
+
+bool VermicelliGpuCulling::reserve(std::unique_ptr<VermicelliBuffer> &buffer, VkDeviceSize elementSize, size_t count,
+                                   VkBufferUsageFlags usage) {
+  if (buffer != nullptr && buffer->getInstanceCount() >= count) {
+    return false;
+  }
+  /// Doubled, so a scene that keeps growing does not replace the buffer every frame
+  auto capacity = static_cast<uint32_t>(std::max<size_t>(count, buffer != nullptr ? 2 * buffer->getInstanceCount()
+                                                                                  : WORKGROUP_SIZE));
+  mDevice.deletionQueue().retire(std::move(buffer));
+  buffer = std::make_unique<VermicelliBuffer>(
+          mDevice,
+          elementSize,
+          capacity,
+          usage,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+          VermicelliMemoryAllocator::Category::OTHER
+                                             );
+  if (mVerbose) {
+    std::cout << "GPU culling: buffer of " << capacity << " x " << elementSize << " bytes" << std::endl;
+  }
+  return true;
+}
+
+void VermicelliGpuCulling::writeDescriptorSet(const FrameInfo &frameInfo, FrameBuffers &frame,
+                                              const VermicelliDepthPyramid *pyramid) {
+  auto                   uboInfo        = frameInfo.mFrameAllocator.descriptorInfo(sizeof(GlobalUbo));
+  auto                   sceneInfo      = frameInfo.mScene.descriptorInfo();
+  VkDescriptorBufferInfo frameDataInfo{frameInfo.mFrameAllocator.buffer(), 0, VK_WHOLE_SIZE};
+  auto                   visibleInfo    = frame.mVisible->descriptorInfo();
+  auto                   countsInfo     = frame.mInstanceCounts->descriptorInfo();
+  auto                   commandsInfo   = frame.mCommands->descriptorInfo();
+  auto                   drawCountsInfo = frame.mDrawCounts->descriptorInfo();
+
+  VermicelliDescriptorWriter writer(*mSetLayout, *mPool);
+  writer.writeBuffer(0, &uboInfo)
+        .writeBuffer(1, &sceneInfo)
+        .writeBuffer(2, &frameDataInfo)
+        .writeBuffer(3, &visibleInfo)
+        .writeBuffer(4, &countsInfo)
+        .writeBuffer(5, &commandsInfo)
+        .writeBuffer(6, &drawCountsInfo);
+
+  /// Only the occlusion passes use the rest, and a set written without them is never bound to one
+  VkDescriptorImageInfo  pyramidInfo{};
+  VkDescriptorBufferInfo candidatesInfo{};
+  VkDescriptorBufferInfo candidateCountsInfo{};
+  VkDescriptorBufferInfo statsInfo{};
+  if (pyramid != nullptr) {
+    pyramidInfo         = pyramid->descriptorInfo();
+    candidatesInfo      = frame.mCandidates->descriptorInfo();
+    candidateCountsInfo = frame.mCandidateCounts->descriptorInfo();
+    statsInfo           = frame.mStats->descriptorInfo();
+    writer.writeImage(7, &pyramidInfo)
+          .writeBuffer(8, &candidatesInfo)
+          .writeBuffer(9, &candidateCountsInfo)
+          .writeBuffer(10, &statsInfo);
+    frame.mPyramid = pyramidInfo.imageView;
+  }
+  if (frame.mDescriptorSet == VK_NULL_HANDLE) {
+    if (!writer.build(frame.mDescriptorSet)) {
+      throw std::runtime_error("failed to allocate culling descriptor set!");
+    }
+  } else {
+    writer.overwrite(frame.mDescriptorSet);
+  }
+  frame.mFrameData = frameInfo.mFrameAllocator.buffer();
+}
+
+}
@@ -0,0 +1,63 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Read-only memory mapping of a file on disk
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+namespace vermicelli {
+
+VermicelliMappedFile::VermicelliMappedFile(const std::string &filePath) {
+  int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("Unable to open file: " + filePath);
+  }
+
+  struct stat info{};
+  if (fstat(fd, &info) != 0) {
+    ::close(fd);
+    throw std::runtime_error("Unable to stat file: " + filePath);
+  }
+  mSize = static_cast<size_t>(info.st_size);
+
+  /// mmap refuses zero-length mappings, so an empty file simply maps to nothing
+  if (mSize > 0) {
+    void *mapping = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error("Unable to map file: " + filePath);
+    }
+    /// Files are read front to back, so let the kernel read ahead aggressively
+    madvise(mapping, mSize, MADV_SEQUENTIAL);
+    mData = static_cast<const char *>(mapping);
+  }
+  ::close(fd);
+}
+
+VermicelliMappedFile::~VermicelliMappedFile() {
+  if (mData) {
+    munmap(const_cast<char *>(mData), mSize);
+  }
+}
+
+bool VermicelliMappedFile::stat(const std::string &filePath, int64_t &mTimeNs, uint64_t &size) {
+  struct stat info{};
+  if (::stat(filePath.c_str(), &info) != 0) {
+    return false;
+  }
+  mTimeNs = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+  size    = static_cast<uint64_t>(info.st_size);
+  return true;
+}
+
+}
@@ -0,0 +1,330 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Suballocates buffers and images from large device memory blocks, one set of blocks per memory type
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_memory_allocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace vermicelli {
+
+/// Block size on heaps large enough that a few blocks are a small fraction of them
+static constexpr VkDeviceSize LARGE_HEAP_BLOCK_SIZE = 64ull << 20;
+static constexpr VkDeviceSize SMALL_HEAP_SIZE       = 1ull << 30;
+
+VermicelliMemoryAllocator::VermicelliMemoryAllocator(VkInstance instance, VkPhysicalDevice physicalDevice,
+                                                     VkDevice device, const bool memoryBudget, const bool verbose)
+        : mPhysicalDevice(physicalDevice), mDevice(device), mVerbose(verbose) {
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &mMemoryProperties);
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  mNonCoherentAtomSize = properties.limits.nonCoherentAtomSize;
+  mPools.resize(mMemoryProperties.memoryTypeCount * 2);
+
+  if (memoryBudget) {
+    mGetMemoryProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(
+            vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR"));
+  }
+  refreshBudget();
+
+  if (mVerbose) {
+    std::cout << "Memory allocator: " << (mGetMemoryProperties2 ? "driver-reported" : "estimated") << " budgets";
+    for (uint32_t heap = 0; heap < mMemoryProperties.memoryHeapCount; ++heap) {
+      std::cout << (heap == 0 ? ", " : " / ") << mHeapBudget[heap] / (1024.0f * 1024.0f) << " MiB";
+    }
+    std::cout << std::endl;
+  }
+}
+
+VermicelliMemoryAllocator::~VermicelliMemoryAllocator() {
+  if (mVerbose) {
+    Stats stats = this->stats();
+    std::cout << "Memory allocator: " << stats.mBlockCount << " blocks (" << stats.mBlockBytes / (1024.0f * 1024.0f)
+              << " MiB), " << stats.mDedicatedCount << " dedicated, " << stats.mAllocationCount
+              << " allocations still live" << std::endl;
+  }
+  for (auto &pool: mPools) {
+    for (auto &block: pool.mBlocks) {
+      assert(block->mTlsf.empty() && "Memory block freed while resources still live in it");
+      vkFreeMemory(mDevice, block->mMemory, nullptr);
+    }
+  }
+}
+
+VkDeviceSize VermicelliMemoryAllocator::blockSize(uint32_t memoryType) const {
+  VkDeviceSize heapSize = mMemoryProperties.memoryHeaps[mMemoryProperties.memoryTypes[memoryType].heapIndex].size;
+  return heapSize <= SMALL_HEAP_SIZE ? heapSize / 8 : LARGE_HEAP_BLOCK_SIZE;
+}
+
+bool VermicelliMemoryAllocator::isHostVisible(uint32_t memoryType) const {
+  return mMemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
+bool VermicelliMemoryAllocator::isCoherent(uint32_t memoryType) const {
+  return mMemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+}
+
+const char *VermicelliMemoryAllocator::categoryName(Category category) {
+  switch (category) {
+    case Category::GEOMETRY:
+      return "geometry";
+    case Category::UNIFORMS:
+      return "uniforms";
+    case Category::ATTACHMENTS:
+      return "attachments";
+    case Category::STAGING:
+      return "staging";
+    case Category::TEXTURES:
+      return "textures";
+    default:
+      return "other";
+  }
+}
+
+void VermicelliMemoryAllocator::refreshBudget() {
+  if (mGetMemoryProperties2) {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+    budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties.pNext = &budget;
+    mGetMemoryProperties2(mPhysicalDevice, &properties);
+    std::copy(std::begin(budget.heapUsage), std::end(budget.heapUsage), std::begin(mHeapUsage));
+    std::copy(std::begin(budget.heapBudget), std::end(budget.heapBudget), std::begin(mHeapBudget));
+    return;
+  }
+  for (uint32_t heap = 0; heap < mMemoryProperties.memoryHeapCount; ++heap) {
+    mHeapUsage[heap]  = mHeapBytes[heap];
+    mHeapBudget[heap] = static_cast<VkDeviceSize>(
+            static_cast<double>(mMemoryProperties.memoryHeaps[heap].size) * FALLBACK_BUDGET);
+  }
+}
+
+bool VermicelliMemoryAllocator::updateBudget(uint32_t heap) {
+  refreshBudget();
+  bool over    = static_cast<double>(mHeapUsage[heap]) >= mBudgetThreshold * static_cast<double>(mHeapBudget[heap]);
+  bool crossed = over && !mOverBudget[heap];
+  mOverBudget[heap] = over;
+  return crossed && mBudgetCallback;
+}
+
+void VermicelliMemoryAllocator::setBudgetCallback(BudgetCallback callback, float threshold) {
+  std::lock_guard lock{mMutex};
+  mBudgetCallback  = std::move(callback);
+  mBudgetThreshold = threshold;
+}
+
+void VermicelliMemoryAllocator::freeMemory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType) {
+  uint32_t heap = mMemoryProperties.memoryTypes[memoryType].heapIndex;
+  vkFreeMemory(mDevice, memory, nullptr);
+  mHeapBytes[heap] -= size;
+  updateBudget(heap);
+}
+
+VkDeviceMemory VermicelliMemoryAllocator::allocateMemory(VkDeviceSize size, uint32_t memoryType, void **mapped,
+                                                         bool &crossedBudget) {
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize  = size;
+  allocInfo.memoryTypeIndex = memoryType;
+
+  VkDeviceMemory memory;
+  if (vkAllocateMemory(mDevice, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate device memory!");
+  }
+
+  uint32_t heap = mMemoryProperties.memoryTypes[memoryType].heapIndex;
+  mHeapBytes[heap] += size;
+  *mapped = nullptr;
+  if (isHostVisible(memoryType) && vkMapMemory(mDevice, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS) {
+    freeMemory(memory, size, memoryType);
+    throw std::runtime_error("failed to map device memory!");
+  }
+  crossedBudget = crossedBudget || updateBudget(heap);
+  return memory;
+}
+
+VermicelliMemoryAllocator::Allocation
+VermicelliMemoryAllocator::allocate(const VkMemoryRequirements &requirements, uint32_t memoryType, bool linear,
+                                    Category category) {
+  std::unique_lock lock{mMutex};
+
+  Allocation allocation{};
+  allocation.mSize       = requirements.size;
+  allocation.mMemoryType = memoryType;
+  allocation.mCategory   = category;
+
+  uint32_t heap          = mMemoryProperties.memoryTypes[memoryType].heapIndex;
+  bool     crossedBudget = false;
+
+  VkDeviceSize blockSize = this->blockSize(memoryType);
+  if (requirements.size >= blockSize / 2) {
+    allocation.mMemory = allocateMemory(requirements.size, memoryType, &allocation.mMapped, crossedBudget);
+    ++mDedicatedCount;
+    mDedicatedBytes += requirements.size;
+    mDedicatedHeapBytes[heap] += requirements.size;
+    if (mVerbose) {
+      std::cout << "Memory allocator: dedicated " << requirements.size / (1024.0f * 1024.0f) << " MiB of type "
+                << memoryType << " for " << categoryName(category) << std::endl;
+    }
+  } else {
+    suballocate(allocation, requirements, blockSize, linear, crossedBudget);
+  }
+  mCategoryBytes[static_cast<uint32_t>(category)][heap] += requirements.size;
+
+  /// The callback may well want to look at stats() or free things, so it runs without the lock
+  if (crossedBudget) {
+    VkDeviceSize usage = mHeapUsage[heap], budget = mHeapBudget[heap];
+    BudgetCallback callback = mBudgetCallback;
+    lock.unlock();
+    callback(heap, usage, budget);
+  }
+  return allocation;
+}
+
+void VermicelliMemoryAllocator::suballocate(Allocation &allocation, const VkMemoryRequirements &requirements,
+                                            VkDeviceSize blockSize, bool linear, bool &crossedBudget) {
+  uint32_t memoryType = allocation.mMemoryType;
+
+  /// Flushing widens ranges to whole atoms, which must never reach into a neighbour's memory
+  VkDeviceSize alignment = requirements.alignment;
+  if (isHostVisible(memoryType) && !isCoherent(memoryType)) {
+    alignment = std::max(alignment, mNonCoherentAtomSize);
+  }
+
+  Pool &pool = mPools[memoryType * 2 + (linear ? 0 : 1)];
+  for (auto &block: pool.mBlocks) {
+    if (block->mTlsf.size() - block->mTlsf.used() < requirements.size) {
+      continue;
+    }
+    allocation.mNode = block->mTlsf.allocate(requirements.size, alignment, allocation.mOffset);
+    if (allocation.mNode != VermicelliTlsf::NO_NODE) {
+      allocation.mBlock = block.get();
+      break;
+    }
+  }
+
+  if (allocation.mBlock == nullptr) {
+    void           *mapped;
+    VkDeviceMemory memory = allocateMemory(blockSize, memoryType, &mapped, crossedBudget);
+    pool.mBlocks.push_back(std::make_unique<Block>(Block{memory, mapped, VermicelliTlsf{blockSize}}));
+    allocation.mBlock = pool.mBlocks.back().get();
+    allocation.mNode  = allocation.mBlock->mTlsf.allocate(requirements.size, alignment, allocation.mOffset);
+    assert(allocation.mNode != VermicelliTlsf::NO_NODE && "Fresh block too small for a non-dedicated resource");
+    if (mVerbose) {
+      std::cout << "Memory allocator: new " << blockSize / (1024.0f * 1024.0f) << " MiB block of type " << memoryType
+                << (linear ? " (linear)" : " (optimal)") << std::endl;
+    }
+  }
+
+  allocation.mMemory = allocation.mBlock->mMemory;
+  if (allocation.mBlock->mMapped) {
+    allocation.mMapped = static_cast<char *>(allocation.mBlock->mMapped) + allocation.mOffset;
+  }
+}
+
+void VermicelliMemoryAllocator::free(Allocation &allocation) {
+  if (allocation.mMemory == VK_NULL_HANDLE) {
+    return;
+  }
+  std::lock_guard lock{mMutex};
+
+  mCategoryBytes[static_cast<uint32_t>(allocation.mCategory)]
+                [mMemoryProperties.memoryTypes[allocation.mMemoryType].heapIndex] -= allocation.mSize;
+  if (allocation.mBlock == nullptr) {
+    freeMemory(allocation.mMemory, allocation.mSize, allocation.mMemoryType);
+    --mDedicatedCount;
+    mDedicatedBytes -= allocation.mSize;
+    mDedicatedHeapBytes[mMemoryProperties.memoryTypes[allocation.mMemoryType].heapIndex] -= allocation.mSize;
+  } else {
+    allocation.mBlock->mTlsf.free(allocation.mNode);
+
+    /// Keep one empty block per pool around so a resource that is recreated every so often does not thrash
+    if (allocation.mBlock->mTlsf.empty()) {
+      for (uint32_t kind = 0; kind < 2; ++kind) {
+        Pool &pool  = mPools[allocation.mMemoryType * 2 + kind];
+        auto found = std::find_if(pool.mBlocks.begin(), pool.mBlocks.end(),
+                                  [&](const auto &block) { return block.get() == allocation.mBlock; });
+        if (found == pool.mBlocks.end()) {
+          continue;
+        }
+        auto empty = std::count_if(pool.mBlocks.begin(), pool.mBlocks.end(),
+                                   [](const auto &block) { return block->mTlsf.empty(); });
+        if (empty > 1) {
+          freeMemory((*found)->mMemory, (*found)->mTlsf.size(), allocation.mMemoryType);
+          pool.mBlocks.erase(found);
+        }
+        break;
+      }
+    }
+  }
+  allocation = {};
+}
+
+VkMappedMemoryRange VermicelliMemoryAllocator::mappedRange(const Allocation &allocation, VkDeviceSize offset,
+                                                           VkDeviceSize size) const {
+  VkDeviceSize memorySize = allocation.mBlock ? allocation.mBlock->mTlsf.size() : allocation.mSize;
+  VkDeviceSize begin      = allocation.mOffset + offset;
+  VkDeviceSize end        = size == VK_WHOLE_SIZE ? allocation.mOffset + allocation.mSize : begin + size;
+
+  VkMappedMemoryRange range{};
+  range.sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+  range.memory = allocation.mMemory;
+  range.offset = begin / mNonCoherentAtomSize * mNonCoherentAtomSize;
+  end          = (end + mNonCoherentAtomSize - 1) / mNonCoherentAtomSize * mNonCoherentAtomSize;
+  range.size   = end >= memorySize ? VK_WHOLE_SIZE : end - range.offset;
+  return range;
+}
+
+VkResult VermicelliMemoryAllocator::flush(const Allocation &allocation, VkDeviceSize offset, VkDeviceSize size) {
+  if (isCoherent(allocation.mMemoryType)) {
+    return VK_SUCCESS;
+  }
+  VkMappedMemoryRange range = mappedRange(allocation, offset, size);
+  return vkFlushMappedMemoryRanges(mDevice, 1, &range);
+}
+
+VkResult VermicelliMemoryAllocator::invalidate(const Allocation &allocation, VkDeviceSize offset, VkDeviceSize size) {
+  if (isCoherent(allocation.mMemoryType)) {
+    return VK_SUCCESS;
+  }
+  VkMappedMemoryRange range = mappedRange(allocation, offset, size);
+  return vkInvalidateMappedMemoryRanges(mDevice, 1, &range);
+}
+
+VermicelliMemoryAllocator::Stats VermicelliMemoryAllocator::stats() {
+  std::lock_guard lock{mMutex};
+
+  Stats stats{};
+  stats.mDedicatedCount  = mDedicatedCount;
+  stats.mDedicatedBytes  = mDedicatedBytes;
+  stats.mAllocationCount = mDedicatedCount;
+  std::copy(std::begin(mDedicatedHeapBytes), std::end(mDedicatedHeapBytes), std::begin(stats.mHeapBytes));
+  refreshBudget();
+  std::copy(std::begin(mHeapUsage), std::end(mHeapUsage), std::begin(stats.mHeapUsage));
+  std::copy(std::begin(mHeapBudget), std::end(mHeapBudget), std::begin(stats.mHeapBudget));
+  std::copy(&mCategoryBytes[0][0], &mCategoryBytes[0][0] + CATEGORY_COUNT * VK_MAX_MEMORY_HEAPS,
+            &stats.mCategoryBytes[0][0]);
+  stats.mHeapCount    = mMemoryProperties.memoryHeapCount;
+  stats.mDriverBudget = mGetMemoryProperties2 != nullptr;
+  for (uint32_t i = 0; i < mPools.size(); ++i) {
+    uint32_t heap = mMemoryProperties.memoryTypes[i / 2].heapIndex;
+    for (const auto &block: mPools[i].mBlocks) {
+      ++stats.mBlockCount;
+      stats.mBlockBytes += block->mTlsf.size();
+      stats.mUsedBytes += block->mTlsf.used();
+      stats.mAllocationCount += block->mTlsf.allocationCount();
+      stats.mHeapBytes[heap] += block->mTlsf.size();
+    }
+  }
+  return stats;
+}
+
+}
@@ -0,0 +1,211 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Versioned binary copy of a loaded model, stored next to its source file
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_mesh_cache.h"
+#include "vermicelli_functions.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+namespace vermicelli {
+
+/// The vertex blob starts right after the header, so keep the header a multiple of 16 bytes
+static_assert(sizeof(VermicelliMeshCache::Header) == 96, "Mesh cache header layout changed, bump VERSION");
+static_assert(sizeof(VermicelliModel::Vertex) % alignof(uint32_t) == 0, "Index blob would be misaligned");
+
+VermicelliMeshCache::VermicelliMeshCache(std::unique_ptr<VermicelliMappedFile> file)
+        : mFile{std::move(file)}, mHeader{reinterpret_cast<const Header *>(mFile->data())} {}
+
+std::span<const VermicelliModel::Vertex> VermicelliMeshCache::vertices() const {
+  auto *first = reinterpret_cast<const VermicelliModel::Vertex *>(mFile->data() + sizeof(Header));
+  return {first, static_cast<size_t>(mHeader->mVertexCount)};
+}
+
+std::span<const uint32_t> VermicelliMeshCache::indices() const {
+  auto *first = reinterpret_cast<const uint32_t *>(
+          mFile->data() + sizeof(Header) + mHeader->mVertexCount * mHeader->mVertexStride);
+  return {first, static_cast<size_t>(mHeader->mIndexCount)};
+}
+
+std::span<const VermicelliModel::LodRange> VermicelliMeshCache::lods() const {
+  auto *first = reinterpret_cast<const VermicelliModel::LodRange *>(
+          mFile->data() + sizeof(Header) + mHeader->mVertexCount * mHeader->mVertexStride +
+          mHeader->mIndexCount * sizeof(uint32_t));
+  return {first, mHeader->mLodCount};
+}
+
+std::span<const VermicelliModel::Meshlet> VermicelliMeshCache::meshlets() const {
+  auto *first = reinterpret_cast<const VermicelliModel::Meshlet *>(
+          reinterpret_cast<const uint8_t *>(lods().data()) + mHeader->mLodCount * sizeof(VermicelliModel::LodRange));
+  return {first, mHeader->mMeshletCount};
+}
+
+uint64_t VermicelliMeshCache::hashFile(const std::string &filePath) {
+  VermicelliMappedFile file{filePath};
+  return hashBytes(file.data(), file.size());
+}
+
+std::unique_ptr<VermicelliMeshCache> VermicelliMeshCache::open(const std::string &sourcePath, uint32_t flags) {
+  int64_t  sourceMTime, cacheMTime;
+  uint64_t sourceSize, cacheSize;
+  if (!VermicelliMappedFile::stat(sourcePath, sourceMTime, sourceSize) ||
+      !VermicelliMappedFile::stat(cachePath(sourcePath), cacheMTime, cacheSize) ||
+      cacheSize < sizeof(Header)) {
+    return nullptr;
+  }
+
+  auto file   = std::make_unique<VermicelliMappedFile>(cachePath(sourcePath));
+  auto header = reinterpret_cast<const Header *>(file->data());
+  if (header->mMagic != MAGIC || header->mVersion != VERSION ||
+      header->mVertexStride != sizeof(VermicelliModel::Vertex) || header->mFlags != flags ||
+      header->mSourceSize != sourceSize) {
+    return nullptr;
+  }
+
+  /// Guard against truncated writes before trusting the counts in the header
+  uint64_t expectedSize = sizeof(Header) + header->mVertexCount * header->mVertexStride +
+                          header->mIndexCount * sizeof(uint32_t) +
+                          header->mLodCount * sizeof(VermicelliModel::LodRange) +
+                          header->mMeshletCount * sizeof(VermicelliModel::Meshlet);
+  if (file->size() != expectedSize) {
+    return nullptr;
+  }
+
+  /// The source was touched (checkout, copy) but might not have changed; only its contents decide
+  if (header->mSourceMTime != sourceMTime) {
+    if (header->mSourceHash != hashFile(sourcePath)) {
+      return nullptr;
+    }
+    /// Otherwise every later load would hash the source again
+    updateSourceMTime(cachePath(sourcePath), sourceMTime);
+  }
+
+  return std::unique_ptr<VermicelliMeshCache>(new VermicelliMeshCache(std::move(file)));
+}
+
+void VermicelliMeshCache::updateSourceMTime(const std::string &cachePath, int64_t sourceMTime) {
+  /// Only the one field is rewritten, in place; like write(), failing to is not an error
+  std::fstream file{cachePath, std::ios::binary | std::ios::in | std::ios::out};
+  if (file.is_open()) {
+    file.seekp(offsetof(Header, mSourceMTime));
+    file.write(reinterpret_cast<const char *>(&sourceMTime), sizeof(sourceMTime));
+  }
+}
+
+bool VermicelliMeshCache::write(const std::string &sourcePath, const VermicelliModel::Builder &builder,
+                                uint32_t flags) {
+  Header header{};
+  header.mMagic        = MAGIC;
+  header.mVersion      = VERSION;
+  header.mVertexStride = sizeof(VermicelliModel::Vertex);
+  header.mFlags        = flags;
+  header.mVertexCount  = builder.mVertices.size();
+  header.mIndexCount   = builder.mIndices.size();
+  header.mLodCount     = static_cast<uint32_t>(builder.mLods.size());
+  header.mMeshletCount = static_cast<uint32_t>(builder.mMeshlets.size());
+  if (!VermicelliMappedFile::stat(sourcePath, header.mSourceMTime, header.mSourceSize)) {
+    return false;
+  }
+  header.mSourceHash = hashFile(sourcePath);
+
+  header.mBoundsMin = glm::vec3{std::numeric_limits<float>::max()};
+  header.mBoundsMax = glm::vec3{std::numeric_limits<float>::lowest()};
+  for (const auto &vertex: builder.mVertices) {
+    header.mBoundsMin = glm::min(header.mBoundsMin, vertex.mPosition);
+    header.mBoundsMax = glm::max(header.mBoundsMax, vertex.mPosition);
+  }
+
+  /// Write to a temporary file first so a crash mid-write never leaves a cache that looks valid
+  std::string   tempPath = cachePath(sourcePath) + ".tmp";
+  std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+  if (!file.is_open()) {
+    return false;
+  }
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(builder.mVertices.data()),
+             static_cast<std::streamsize>(builder.mVertices.size() * sizeof(VermicelliModel::Vertex)));
+  file.write(reinterpret_cast<const char *>(builder.mIndices.data()),
+             static_cast<std::streamsize>(builder.mIndices.size() * sizeof(uint32_t)));
+  file.write(reinterpret_cast<const char *>(builder.mLods.data()),
+             static_cast<std::streamsize>(builder.mLods.size() * sizeof(VermicelliModel::LodRange)));
+  file.write(reinterpret_cast<const char *>(builder.mMeshlets.data()),
+             static_cast<std::streamsize>(builder.mMeshlets.size() * sizeof(VermicelliModel::Meshlet)));
+  file.close();
+
+  if (!file || std::rename(tempPath.c_str(), cachePath(sourcePath).c_str()) != 0) {
+    std::remove(tempPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+void VermicelliMeshCache::benchmark(const std::string &sourcePath) {
+  using milliseconds = std::chrono::duration<float, std::milli>;
+  auto timeBest = [](int iterations, auto &&fn) {
+    float best = std::numeric_limits<float>::max();
+    for (int i = 0; i < iterations; ++i) {
+      auto start = std::chrono::steady_clock::now();
+      fn();
+      best = std::min(best, milliseconds(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+  };
+
+  /// Built the way the application loads its models, so the cache written here is the one it would use
+  ModelLoadOptions options{};
+  options.mOptimizeMesh = true;
+  options.mGenerateLods = true;
+  const uint32_t flags  = options.cacheFlags();
+
+  VermicelliModel::Builder builder;
+  float                    parsed = timeBest(10, [&] {
+    builder = {};
+    builder.loadModel(sourcePath);
+    builder.optimize();
+    builder.generateLods();
+  });
+  if (!write(sourcePath, builder, flags)) {
+    std::cout << "Could not write the mesh cache of " << sourcePath << std::endl;
+    return;
+  }
+
+  /// Reading every byte, as uploading the model would, so the mapping's page faults are counted too
+  volatile uint64_t sink = 0;
+  auto              load = [&] {
+    auto cache = open(sourcePath, flags);
+    if (!cache) {
+      throw std::runtime_error("failed to open the mesh cache just written!");
+    }
+    sink = hashBytes(cache->vertices().data(), cache->vertices().size_bytes()) ^
+           hashBytes(cache->indices().data(), cache->indices().size_bytes());
+  };
+  float             cached = timeBest(100, load);
+
+  /// A source whose time changed but whose contents did not: hashed once, then fast again
+  int64_t  sourceMTime;
+  uint64_t sourceSize;
+  VermicelliMappedFile::stat(sourcePath, sourceMTime, sourceSize);
+  updateSourceMTime(cachePath(sourcePath), sourceMTime - 1);
+  float touched      = timeBest(1, load);
+  float afterTouched = timeBest(100, load);
+
+  std::cout << "Loading " << sourcePath << " (" << builder.mVertices.size() << " vertices, " << builder.mIndices.size()
+            << " indices over " << builder.mLods.size() << " levels):" << std::endl
+            << "  parse, weld, optimize and simplify (best of 10): " << parsed << " ms" << std::endl
+            << "  mesh cache (best of 100): " << cached << " ms" << std::endl
+            << "  mesh cache, source touched but unchanged: " << touched << " ms the first time, then "
+            << afterTouched << " ms" << std::endl;
+}
+
+}
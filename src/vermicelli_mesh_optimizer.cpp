@@ -0,0 +1,285 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Index and vertex reordering for post-transform cache reuse, overdraw and vertex fetch locality
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace vermicelli {
+
+/// Tuning from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+static constexpr uint32_t FORSYTH_CACHE_SIZE  = 32;
+static constexpr float    CACHE_DECAY_POWER   = 1.5f;
+static constexpr float    LAST_TRIANGLE_SCORE = 0.75f;
+static constexpr float    VALENCE_BOOST_SCALE = 2.0f;
+static constexpr float    VALENCE_BOOST_POWER = 0.5f;
+
+/// FIFO size used to find cluster boundaries for the overdraw pass
+static constexpr uint32_t OVERDRAW_CACHE_SIZE = 16;
+
+static float forsythScore(int32_t cachePosition, uint32_t remainingValence) {
+  if (remainingValence == 0) {
+    return -1.0f;
+  }
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    /// The three vertices of the last triangle get a flat score so the next one does not strictly prefer any edge
+    if (cachePosition < 3) {
+      score = LAST_TRIANGLE_SCORE;
+    } else {
+      float scaler = 1.0f - static_cast<float>(cachePosition - 3) / static_cast<float>(FORSYTH_CACHE_SIZE - 3);
+      score = std::pow(scaler, CACHE_DECAY_POWER);
+    }
+  }
+  return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingValence), -VALENCE_BOOST_POWER);
+}
+
+VermicelliMeshOptimizer::VertexCacheStats
+VermicelliMeshOptimizer::analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount,
+                                            uint32_t cacheSize) {
+  std::vector<uint32_t> timestamps(vertexCount, 0);
+  std::vector<bool>     used(vertexCount, false);
+  uint32_t              timestamp = cacheSize + 1;
+  size_t                misses    = 0;
+  size_t                unique    = 0;
+  for (uint32_t index: indices) {
+    if (timestamp - timestamps[index] > cacheSize) {
+      timestamps[index] = timestamp++;
+      ++misses;
+    }
+    if (!used[index]) {
+      used[index] = true;
+      ++unique;
+    }
+  }
+  size_t triangleCount = indices.size() / 3;
+  return {
+          triangleCount ? static_cast<float>(misses) / static_cast<float>(triangleCount) : 0.0f,
+          unique ? static_cast<float>(misses) / static_cast<float>(unique) : 0.0f
+  };
+}
+
+void VermicelliMeshOptimizer::optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount) {
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  /// Triangles per vertex, packed; the live ones for v are adjacency[offsets[v], offsets[v] + valence[v])
+  std::vector<uint32_t> valence(vertexCount, 0);
+  std::vector<uint32_t> offsets(vertexCount + 1, 0);
+  std::vector<uint32_t> adjacency(indices.size());
+  for (uint32_t index: indices) {
+    ++valence[index];
+  }
+  for (size_t v = 0; v < vertexCount; ++v) {
+    offsets[v + 1] = offsets[v] + valence[v];
+  }
+  std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+  for (uint32_t         t = 0; t < triangleCount; ++t) {
+    for (int k = 0; k < 3; ++k) {
+      adjacency[fill[indices[3 * t + k]]++] = t;
+    }
+  }
+
+  std::vector<int32_t> cachePosition(vertexCount, -1);
+  std::vector<float>   vertexScore(vertexCount);
+  for (size_t          v = 0; v < vertexCount; ++v) {
+    vertexScore[v] = forsythScore(-1, valence[v]);
+  }
+  std::vector<float> triangleScore(triangleCount);
+  std::vector<bool>  emitted(triangleCount, false);
+  for (size_t        t = 0; t < triangleCount; ++t) {
+    triangleScore[t] = vertexScore[indices[3 * t]] + vertexScore[indices[3 * t + 1]] + vertexScore[indices[3 * t + 2]];
+  }
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+  size_t   cacheCount = 0;
+  size_t   scanCursor = 0;
+  int64_t  best       = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+
+  while (result.size() < triangleCount * 3) {
+    /// Nothing in the cache has triangles left; fall back to the next unemitted triangle in the input
+    if (best < 0) {
+      while (emitted[scanCursor]) {
+        ++scanCursor;
+      }
+      best = static_cast<int64_t>(scanCursor);
+    }
+    const auto tri = static_cast<uint32_t>(best);
+    emitted[tri] = true;
+
+    uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+    size_t   newCount = 0;
+    for (int k        = 0; k < 3; ++k) {
+      uint32_t v = indices[3 * tri + k];
+      result.push_back(v);
+
+      uint32_t *live = &adjacency[offsets[v]];
+      for (uint32_t j = 0; j < valence[v]; ++j) {
+        if (live[j] == tri) {
+          live[j] = live[--valence[v]];
+          break;
+        }
+      }
+      if (std::find(newCache, newCache + newCount, v) == newCache + newCount) {
+        newCache[newCount++] = v;
+      }
+    }
+    const size_t emittedCount = newCount;
+    for (size_t  j            = 0; j < cacheCount; ++j) {
+      if (std::find(newCache, newCache + emittedCount, cache[j]) == newCache + emittedCount) {
+        newCache[newCount++] = cache[j];
+      }
+    }
+
+    /// Rescore everything that moved, including the vertices that just fell out of the cache
+    for (size_t j = 0; j < newCount; ++j) {
+      uint32_t v = newCache[j];
+      cachePosition[v] = j < FORSYTH_CACHE_SIZE ? static_cast<int32_t>(j) : -1;
+      float score = forsythScore(cachePosition[v], valence[v]);
+      float delta = score - vertexScore[v];
+      vertexScore[v] = score;
+      for (uint32_t i = 0; i < valence[v]; ++i) {
+        triangleScore[adjacency[offsets[v] + i]] += delta;
+      }
+    }
+
+    best = -1;
+    float bestScore = -1.0f;
+    cacheCount = std::min<size_t>(newCount, FORSYTH_CACHE_SIZE);
+    for (size_t j = 0; j < cacheCount; ++j) {
+      uint32_t v = cache[j] = newCache[j];
+      for (uint32_t i = 0; i < valence[v]; ++i) {
+        uint32_t t = adjacency[offsets[v] + i];
+        if (triangleScore[t] > bestScore) {
+          bestScore = triangleScore[t];
+          best      = t;
+        }
+      }
+    }
+  }
+
+  indices.swap(result);
+}
+
+void VermicelliMeshOptimizer::optimizeOverdraw(std::vector<uint32_t> &indices,
+                                               std::span<const VermicelliModel::Vertex> vertices, float threshold) {
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount < 2) {
+    return;
+  }
+
+  std::vector<uint32_t> timestamps(vertices.size(), 0);
+  uint32_t              timestamp = OVERDRAW_CACHE_SIZE + 1;
+  auto                  misses    = [&](size_t t) {
+    uint32_t count = 0;
+    for (int k     = 0; k < 3; ++k) {
+      uint32_t v = indices[3 * t + k];
+      if (timestamp - timestamps[v] > OVERDRAW_CACHE_SIZE) {
+        timestamps[v] = timestamp++;
+        ++count;
+      }
+    }
+    return count;
+  };
+  auto                  flush     = [&]() { timestamp += OVERDRAW_CACHE_SIZE + 1; };
+
+  /// Hard boundaries: triangles where all three vertices miss, i.e. the cache optimizer started over anyway
+  std::vector<size_t> hard{0};
+  for (size_t         t = 0; t < triangleCount; ++t) {
+    if (misses(t) == 3 && t != 0) {
+      hard.push_back(t);
+    }
+  }
+  hard.push_back(triangleCount);
+
+  /// Soft boundaries: split a hard cluster as soon as its running ACMR is within threshold of the whole cluster's
+  std::vector<size_t> clusters;
+  for (size_t         h = 0; h + 1 < hard.size(); ++h) {
+    size_t begin = hard[h], end = hard[h + 1];
+
+    flush();
+    size_t clusterMisses = 0;
+    for (size_t t = begin; t < end; ++t) {
+      clusterMisses += misses(t);
+    }
+    float limit = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+    flush();
+    clusters.push_back(begin);
+    size_t start = begin, running = 0;
+    for (size_t t = begin; t < end; ++t) {
+      running += misses(t);
+      if (t + 1 < end && static_cast<float>(running) / static_cast<float>(t - start + 1) <= limit) {
+        clusters.push_back(t + 1);
+        start   = t + 1;
+        running = 0;
+        flush();
+      }
+    }
+  }
+  clusters.push_back(triangleCount);
+
+  /// Clusters facing away from the mesh centre are likely in front of the rest, so they are drawn first
+  const size_t           clusterCount = clusters.size() - 1;
+  std::vector<glm::vec3> centroids(clusterCount, glm::vec3{0.0f});
+  std::vector<glm::vec3> normals(clusterCount, glm::vec3{0.0f});
+  glm::vec3              meshCentroid{0.0f};
+  for (size_t            c = 0; c < clusterCount; ++c) {
+    for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+      const glm::vec3 &a = vertices[indices[3 * t]].mPosition;
+      const glm::vec3 &b = vertices[indices[3 * t + 1]].mPosition;
+      const glm::vec3 &d = vertices[indices[3 * t + 2]].mPosition;
+      centroids[c] += (a + b + d) / 3.0f;
+      normals[c] += glm::cross(b - a, d - a);
+    }
+    meshCentroid += centroids[c];
+    centroids[c] /= static_cast<float>(clusters[c + 1] - clusters[c]);
+  }
+  meshCentroid /= static_cast<float>(triangleCount);
+
+  std::vector<float> sortKeys(clusterCount);
+  for (size_t        c = 0; c < clusterCount; ++c) {
+    float length = glm::length(normals[c]);
+    sortKeys[c] = length > 0.0f ? glm::dot(centroids[c] - meshCentroid, normals[c] / length) : 0.0f;
+  }
+
+  std::vector<size_t> order(clusterCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) { return sortKeys[lhs] > sortKeys[rhs]; });
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  for (size_t c: order) {
+    result.insert(result.end(), indices.begin() + 3 * clusters[c], indices.begin() + 3 * clusters[c + 1]);
+  }
+  indices.swap(result);
+}
+
+void VermicelliMeshOptimizer::optimizeVertexFetch(std::vector<VermicelliModel::Vertex> &vertices,
+                                                  std::vector<uint32_t> &indices) {
+  constexpr uint32_t                   UNUSED = UINT32_MAX;
+  std::vector<uint32_t>                remap(vertices.size(), UNUSED);
+  std::vector<VermicelliModel::Vertex> result;
+  result.reserve(vertices.size());
+  for (uint32_t &index: indices) {
+    if (remap[index] == UNUSED) {
+      remap[index] = static_cast<uint32_t>(result.size());
+      result.push_back(vertices[index]);
+    }
+    index = remap[index];
+  }
+  vertices.swap(result);
+}
+
+}
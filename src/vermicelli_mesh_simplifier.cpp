@@ -0,0 +1,299 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Quadric error edge-collapse simplification for generating levels of detail
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_mesh_simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace vermicelli {
+
+/// Relative error charged for an attribute distance of 1 (e.g. normals 60 degrees apart, or a full uv tile)
+static constexpr float ATTRIBUTE_WEIGHT = 0.05f;
+
+using Vertex = VermicelliModel::Vertex;
+
+/**
+ * Sum of squared distances to a set of planes, weighted by triangle area: Q(p) = p'Ap + 2b'p + c
+ */
+struct Quadric {
+    double mA00 = 0, mA11 = 0, mA22 = 0, mA01 = 0, mA02 = 0, mA12 = 0;
+    double mB0  = 0, mB1 = 0, mB2 = 0;
+    double mC   = 0;
+    double mWeight = 0;
+
+    void addPlane(const glm::vec3 &normal, float distance, float weight) {
+      double a = normal.x, b = normal.y, c = normal.z, d = distance;
+      mA00 += weight * a * a;
+      mA11 += weight * b * b;
+      mA22 += weight * c * c;
+      mA01 += weight * a * b;
+      mA02 += weight * a * c;
+      mA12 += weight * b * c;
+      mB0 += weight * a * d;
+      mB1 += weight * b * d;
+      mB2 += weight * c * d;
+      mC += weight * d * d;
+      mWeight += weight;
+    }
+
+    Quadric &operator+=(const Quadric &rhs) {
+      mA00 += rhs.mA00;
+      mA11 += rhs.mA11;
+      mA22 += rhs.mA22;
+      mA01 += rhs.mA01;
+      mA02 += rhs.mA02;
+      mA12 += rhs.mA12;
+      mB0 += rhs.mB0;
+      mB1 += rhs.mB1;
+      mB2 += rhs.mB2;
+      mC += rhs.mC;
+      mWeight += rhs.mWeight;
+      return *this;
+    }
+
+    /// Area-weighted mean squared distance from p to the planes
+    [[nodiscard]] double error(const glm::vec3 &p) const {
+      double x = p.x, y = p.y, z = p.z;
+      double q = mA00 * x * x + mA11 * y * y + mA22 * z * z + 2 * (mA01 * x * y + mA02 * x * z + mA12 * y * z) +
+                 2 * (mB0 * x + mB1 * y + mB2 * z) + mC;
+      return mWeight > 0 ? std::max(q, 0.0) / mWeight : 0.0;
+    }
+};
+
+static float attributeDistance(const Vertex &lhs, const Vertex &rhs) {
+  glm::vec3 normal = lhs.mNormal - rhs.mNormal;
+  glm::vec3 color  = lhs.mColor - rhs.mColor;
+  glm::vec2 uv     = lhs.mUV - rhs.mUV;
+  return glm::dot(normal, normal) + glm::dot(color, color) + glm::dot(uv, uv);
+}
+
+std::vector<uint32_t>
+VermicelliMeshSimplifier::simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+                                   size_t targetIndexCount, float targetError, float *resultError) {
+  const size_t vertexCount = vertices.size();
+
+  /// Group vertices by position; a position with several vertices sits on an attribute seam
+  std::vector<uint32_t> sorted(vertexCount);
+  std::iota(sorted.begin(), sorted.end(), 0);
+  auto lessPosition = [&](uint32_t lhs, uint32_t rhs) {
+    const glm::vec3 &a = vertices[lhs].mPosition, &b = vertices[rhs].mPosition;
+    return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+  };
+  std::sort(sorted.begin(), sorted.end(), lessPosition);
+  std::vector<uint32_t> positionOf(vertexCount);
+  std::vector<uint32_t> wedgeOffsets{0}; ///< Vertices of position p are sorted[wedgeOffsets[p], wedgeOffsets[p + 1])
+  for (size_t           i = 0; i < vertexCount; ++i) {
+    if (i > 0 && lessPosition(sorted[i - 1], sorted[i])) {
+      wedgeOffsets.push_back(static_cast<uint32_t>(i));
+    }
+    positionOf[sorted[i]] = static_cast<uint32_t>(wedgeOffsets.size() - 1);
+  }
+  wedgeOffsets.push_back(static_cast<uint32_t>(vertexCount));
+  const size_t           positionCount = wedgeOffsets.size() - 1;
+  std::vector<glm::vec3> positions(positionCount);
+  for (size_t            p = 0; p < positionCount; ++p) {
+    positions[p] = vertices[sorted[wedgeOffsets[p]]].mPosition;
+  }
+
+  glm::vec3 boundsMin{std::numeric_limits<float>::max()}, boundsMax{std::numeric_limits<float>::lowest()};
+  for (const auto &position: positions) {
+    boundsMin = glm::min(boundsMin, position);
+    boundsMax = glm::max(boundsMax, position);
+  }
+  const float  radius         = std::max(glm::length(boundsMax - boundsMin) * 0.5f, std::numeric_limits<float>::min());
+  const double errorScale     = 1.0 / (static_cast<double>(radius) * radius);
+  const double errorLimit     = static_cast<double>(targetError) * targetError;
+  const double attributeScale = static_cast<double>(ATTRIBUTE_WEIGHT) * ATTRIBUTE_WEIGHT;
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+    uint32_t a = positionOf[indices[t]], b = positionOf[indices[t + 1]], c = positionOf[indices[t + 2]];
+    if (a != b && b != c && a != c) {
+      result.insert(result.end(), {indices[t], indices[t + 1], indices[t + 2]});
+    }
+  }
+
+  std::vector<Quadric> quadrics(positionCount);
+  for (size_t          t = 0; t < result.size(); t += 3) {
+    uint32_t  a = positionOf[result[t]], b = positionOf[result[t + 1]], c = positionOf[result[t + 2]];
+    glm::vec3 normal = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+    float     length = glm::length(normal);
+    if (length > 0.0f) {
+      normal /= length;
+      float distance = -glm::dot(normal, positions[a]);
+      for (uint32_t p: {a, b, c}) {
+        quadrics[p].addPlane(normal, distance, length * 0.5f);
+      }
+    }
+  }
+
+  /// Edges used by anything but exactly two triangles are borders or non-manifold; their ends stay put
+  std::vector<bool> locked(positionCount, false);
+  {
+    std::unordered_map<uint64_t, uint32_t> edgeUses;
+    edgeUses.reserve(result.size());
+    for (size_t t = 0; t < result.size(); t += 3) {
+      for (int k = 0; k < 3; ++k) {
+        uint32_t a = positionOf[result[t + k]], b = positionOf[result[t + (k + 1) % 3]];
+        ++edgeUses[(static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b)];
+      }
+    }
+    for (const auto &[edge, uses]: edgeUses) {
+      if (uses != 2) {
+        locked[edge >> 32]        = true;
+        locked[edge & 0xffffffff] = true;
+      }
+    }
+  }
+
+  std::vector<uint32_t> triangleOffsets(positionCount + 1), adjacency, wedgeRemap(vertexCount);
+  std::vector<uint32_t> target(positionCount);
+  std::vector<double>   cost(positionCount);
+  std::vector<bool>     touched(positionCount);
+  std::vector<uint32_t> candidates;
+  double                maxError = 0.0;
+
+  /// Cost of moving every vertex at position from onto its closest counterpart at position to, or infinity
+  auto collapseCost = [&](uint32_t from, uint32_t to) {
+    Quadric combined       = quadrics[from];
+    double  attributeError = 0.0;
+    combined += quadrics[to];
+    for (uint32_t i = wedgeOffsets[from]; i < wedgeOffsets[from + 1]; ++i) {
+      float closest = std::numeric_limits<float>::max();
+      for (uint32_t j = wedgeOffsets[to]; j < wedgeOffsets[to + 1]; ++j) {
+        closest = std::min(closest, attributeDistance(vertices[sorted[i]], vertices[sorted[j]]));
+      }
+      attributeError = std::max(attributeError, static_cast<double>(closest));
+    }
+    return combined.error(positions[to]) * errorScale + attributeError * attributeScale;
+  };
+
+  /// Moving from onto to must not turn any surviving triangle around from upside down
+  auto flipsTriangle = [&](uint32_t from, uint32_t to) {
+    for (uint32_t i = triangleOffsets[from]; i < triangleOffsets[from + 1]; ++i) {
+      const uint32_t *corners = &result[3 * adjacency[i]];
+      uint32_t       p[3]     = {positionOf[corners[0]], positionOf[corners[1]], positionOf[corners[2]]};
+      if (p[0] == to || p[1] == to || p[2] == to) {
+        continue;
+      }
+      glm::vec3 before[3], after[3];
+      for (int  k = 0; k < 3; ++k) {
+        before[k] = positions[p[k]];
+        after[k]  = p[k] == from ? positions[to] : positions[p[k]];
+      }
+      glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+      glm::vec3 normalAfter  = glm::cross(after[1] - after[0], after[2] - after[0]);
+      if (glm::dot(normalBefore, normalAfter) <= 0.0f) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  while (result.size() > targetIndexCount) {
+    /// Triangles around each position, rebuilt every pass
+    std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+    for (uint32_t index: result) {
+      ++triangleOffsets[positionOf[index] + 1];
+    }
+    std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+    adjacency.resize(result.size());
+    std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+    for (size_t           t = 0; t < result.size(); ++t) {
+      adjacency[fill[positionOf[result[t]]]++] = static_cast<uint32_t>(t / 3);
+    }
+
+    /// Cheapest collapse out of every unlocked position
+    std::fill(cost.begin(), cost.end(), std::numeric_limits<double>::infinity());
+    for (size_t t = 0; t < result.size(); t += 3) {
+      for (int k = 0; k < 3; ++k) {
+        uint32_t a = positionOf[result[t + k]], b = positionOf[result[t + (k + 1) % 3]];
+        for (auto [from, to]: {std::pair{a, b}, std::pair{b, a}}) {
+          if (!locked[from]) {
+            double edgeCost = collapseCost(from, to);
+            if (edgeCost < cost[from]) {
+              cost[from]   = edgeCost;
+              target[from] = to;
+            }
+          }
+        }
+      }
+    }
+    candidates.clear();
+    for (uint32_t p = 0; p < positionCount; ++p) {
+      if (cost[p] <= errorLimit) {
+        candidates.push_back(p);
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(), [&](uint32_t lhs, uint32_t rhs) { return cost[lhs] < cost[rhs]; });
+
+    /// Each interior collapse removes two triangles; stop the pass once that would reach the target
+    std::iota(wedgeRemap.begin(), wedgeRemap.end(), 0);
+    std::fill(touched.begin(), touched.end(), false);
+    size_t collapseBudget = (result.size() - targetIndexCount) / 6 + 1;
+    size_t collapses      = 0;
+    for (uint32_t from: candidates) {
+      if (collapses >= collapseBudget) {
+        break;
+      }
+      uint32_t to = target[from];
+      if (touched[from] || touched[to] || flipsTriangle(from, to)) {
+        continue;
+      }
+
+      for (uint32_t i = wedgeOffsets[from]; i < wedgeOffsets[from + 1]; ++i) {
+        uint32_t closest         = sorted[wedgeOffsets[to]];
+        float    closestDistance = std::numeric_limits<float>::max();
+        for (uint32_t j = wedgeOffsets[to]; j < wedgeOffsets[to + 1]; ++j) {
+          float distance = attributeDistance(vertices[sorted[i]], vertices[sorted[j]]);
+          if (distance < closestDistance) {
+            closestDistance = distance;
+            closest         = sorted[j];
+          }
+        }
+        wedgeRemap[sorted[i]] = closest;
+      }
+      quadrics[to] += quadrics[from];
+      maxError = std::max(maxError, cost[from]);
+      ++collapses;
+
+      /// Neighbours' triangles just changed shape, so they wait for the next pass
+      for (uint32_t i = triangleOffsets[from]; i < triangleOffsets[from + 1]; ++i) {
+        for (int k = 0; k < 3; ++k) {
+          touched[positionOf[result[3 * adjacency[i] + k]]] = true;
+        }
+      }
+    }
+    if (collapses == 0) {
+      break;
+    }
+
+    size_t write = 0;
+    for (size_t t = 0; t < result.size(); t += 3) {
+      uint32_t a = wedgeRemap[result[t]], b = wedgeRemap[result[t + 1]], c = wedgeRemap[result[t + 2]];
+      if (positionOf[a] != positionOf[b] && positionOf[b] != positionOf[c] && positionOf[a] != positionOf[c]) {
+        result[write++] = a;
+        result[write++] = b;
+        result[write++] = c;
+      }
+    }
+    result.resize(write);
+  }
+
+  if (resultError) {
+    *resultError = static_cast<float>(std::sqrt(maxError));
+  }
+  return result;
+}
+
+}
@@ -0,0 +1,176 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Splits triangle lists into small clusters with bounding spheres and normal cones for culling
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_meshlet_builder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace vermicelli {
+
+VermicelliModel::Meshlet
+VermicelliMeshletBuilder::describe(std::span<const VermicelliModel::Vertex> vertices,
+                                   std::span<const uint32_t> triangles) {
+  glm::vec3 boundsMin{std::numeric_limits<float>::max()};
+  glm::vec3 boundsMax{std::numeric_limits<float>::lowest()};
+  for (uint32_t index: triangles) {
+    boundsMin = glm::min(boundsMin, vertices[index].mPosition);
+    boundsMax = glm::max(boundsMax, vertices[index].mPosition);
+  }
+  glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+  float     radius = 0.0f;
+  for (uint32_t index: triangles) {
+    radius = std::max(radius, glm::length(vertices[index].mPosition - center));
+  }
+
+  /// The cone axis is the mean face normal; its spread is set by the face that deviates the most
+  std::vector<glm::vec3> normals;
+  normals.reserve(triangles.size() / 3);
+  glm::vec3 axis{0.0f};
+  for (size_t t = 0; t + 2 < triangles.size(); t += 3) {
+    const glm::vec3 &a      = vertices[triangles[t]].mPosition;
+    glm::vec3       normal  = glm::cross(vertices[triangles[t + 1]].mPosition - a,
+                                         vertices[triangles[t + 2]].mPosition - a);
+    float           length  = glm::length(normal);
+    if (length > 0.0f) {
+      normals.push_back(normal / length);
+      axis += normals.back();
+    }
+  }
+  float axisLength = glm::length(axis);
+  float minDot     = -1.0f;
+  if (axisLength > 0.0f) {
+    axis /= axisLength;
+    minDot = 1.0f;
+    for (const auto &normal: normals) {
+      minDot = std::min(minDot, glm::dot(normal, axis));
+    }
+  }
+
+  /// Backfacing from every direction within 90 degrees minus the cone's half angle of the axis, so the cutoff is the
+  /// sine of that half angle; cones wider than a hemisphere get a cutoff no view direction can reach
+  float cutoff = minDot > 0.0f ? std::sqrt(1.0f - minDot * minDot) : 1.0f;
+
+  VermicelliModel::Meshlet meshlet{};
+  meshlet.mBoundingSphere = glm::vec4{center, radius};
+  meshlet.mCone           = glm::vec4{axis, cutoff};
+  meshlet.mIndexCount     = static_cast<uint32_t>(triangles.size());
+  return meshlet;
+}
+
+void VermicelliMeshletBuilder::build(std::span<const VermicelliModel::Vertex> vertices, std::span<uint32_t> indices,
+                                     uint32_t indexOffset, std::vector<VermicelliModel::Meshlet> &meshlets) {
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  /// Flat-shaded meshes share positions but hardly any vertices, so triangles are connected through positions
+  std::vector<uint32_t> byPosition(vertices.size());
+  std::iota(byPosition.begin(), byPosition.end(), 0);
+  auto positionLess = [&](uint32_t lhs, uint32_t rhs) {
+    const glm::vec3 &a = vertices[lhs].mPosition;
+    const glm::vec3 &b = vertices[rhs].mPosition;
+    return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+  };
+  std::sort(byPosition.begin(), byPosition.end(), positionLess);
+  std::vector<uint32_t> positionOf(vertices.size());
+  uint32_t              positionCount = 0;
+  for (size_t           i             = 0; i < byPosition.size(); ++i) {
+    if (i > 0 && positionLess(byPosition[i - 1], byPosition[i])) {
+      ++positionCount;
+    }
+    positionOf[byPosition[i]] = positionCount;
+  }
+  ++positionCount;
+
+  /// Triangles around each position
+  std::vector<uint32_t> offsets(positionCount + 1, 0);
+  std::vector<uint32_t> adjacency(triangleCount * 3);
+  for (size_t           i = 0; i < triangleCount * 3; ++i) {
+    ++offsets[positionOf[indices[i]] + 1];
+  }
+  for (size_t i = 0; i < positionCount; ++i) {
+    offsets[i + 1] += offsets[i];
+  }
+  std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+  for (size_t           i = 0; i < triangleCount * 3; ++i) {
+    adjacency[fill[positionOf[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+  }
+
+  constexpr uint32_t    NONE = UINT32_MAX;
+  std::vector<uint32_t> meshletOf(vertices.size(), NONE); ///< Last meshlet each vertex was added to
+  std::vector<bool>     emitted(triangleCount, false);
+  std::vector<uint32_t> result;
+  result.reserve(triangleCount * 3);
+  std::vector<uint32_t> meshletVertices;
+  meshletVertices.reserve(MAX_VERTICES);
+
+  size_t   seed = 0;
+  uint32_t id   = 0;
+  while (result.size() < triangleCount * 3) {
+    while (emitted[seed]) {
+      ++seed;
+    }
+    meshletVertices.clear();
+    const size_t first     = result.size();
+    uint32_t     triangles = 0;
+
+    for (uint32_t next = static_cast<uint32_t>(seed); next != NONE;) {
+      emitted[next] = true;
+      ++triangles;
+      for (int k = 0; k < 3; ++k) {
+        uint32_t vertex = indices[3 * next + k];
+        result.push_back(vertex);
+        if (meshletOf[vertex] != id) {
+          meshletOf[vertex] = id;
+          meshletVertices.push_back(vertex);
+        }
+      }
+      if (triangles == MAX_TRIANGLES) {
+        break;
+      }
+
+      /// Grow through the neighbour that brings the fewest new vertices; stop when none fits or none is left
+      next = NONE;
+      uint32_t fewestNew = 3;
+      for (uint32_t vertex: meshletVertices) {
+        uint32_t position = positionOf[vertex];
+        for (uint32_t i = offsets[position]; i < offsets[position + 1] && fewestNew > 0; ++i) {
+          uint32_t candidate = adjacency[i];
+          if (emitted[candidate]) {
+            continue;
+          }
+          uint32_t newVertices = 0;
+          for (int k = 0; k < 3; ++k) {
+            newVertices += meshletOf[indices[3 * candidate + k]] != id;
+          }
+          if (newVertices < fewestNew || next == NONE) {
+            fewestNew = newVertices;
+            next      = candidate;
+          }
+        }
+      }
+      if (next != NONE && meshletVertices.size() + fewestNew > MAX_VERTICES) {
+        next = NONE;
+      }
+    }
+
+    VermicelliModel::Meshlet meshlet = describe(vertices, {result.data() + first, result.size() - first});
+    meshlet.mFirstIndex  = indexOffset + static_cast<uint32_t>(first);
+    meshlet.mVertexCount = static_cast<uint32_t>(meshletVertices.size());
+    meshlets.push_back(meshlet);
+    ++id;
+  }
+
+  std::copy(result.begin(), result.end(), indices.begin());
+}
+
+}
@@ -0,0 +1,62 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Loads each model once per path and options and hands out shared references to it
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_model_registry.h"
+#include "vermicelli_functions.h"
+
+#include <filesystem>
+#include <iostream>
+
+namespace vermicelli {
+
+size_t VermicelliModelRegistry::KeyHash::operator()(const Key &key) const {
+  size_t seed = 0;
+  hashCombine(seed, key.mPath, key.mOptions.cacheFlags(), key.mOptions.mCompactVertices,
+              key.mOptions.mSplitForShortIndices);
+  return seed;
+}
+
+VermicelliModelRegistry::VermicelliModelRegistry(VermicelliGeometryArena &arena, const bool verbose)
+        : mArena{arena}, mVerbose(verbose) {}
+
+VermicelliModelRegistry::~VermicelliModelRegistry() {
+  if (mVerbose) {
+    std::cout << "Model registry: " << mModels.size() << " models loaded, " << mHits << " loads shared" << std::endl;
+  }
+}
+
+VermicelliModelRegistry::Key
+VermicelliModelRegistry::makeKey(const std::string &filePath, const ModelLoadOptions &options) {
+  /// "models/a.obj" and "../bin/../models/a.obj" are the same asset; a missing file simply keeps its spelling
+  std::error_code error;
+  auto            canonical = std::filesystem::weakly_canonical(filePath, error);
+  return {error ? filePath : canonical.string(), options};
+}
+
+std::shared_ptr<VermicelliModel>
+VermicelliModelRegistry::load(const std::string &filePath, const ModelLoadOptions &options) {
+  Key key = makeKey(filePath, options);
+  if (auto found = mModels.find(key); found != mModels.end()) {
+    ++mHits;
+    return found->second;
+  }
+
+  std::shared_ptr<VermicelliModel> model = VermicelliModel::createModelFromFile(mArena, filePath, mVerbose, options);
+  mModels.emplace(std::move(key), model);
+  return model;
+}
+
+bool VermicelliModelRegistry::unload(const std::string &filePath, const ModelLoadOptions &options) {
+  return mModels.erase(makeKey(filePath, options)) > 0;
+}
+
+size_t VermicelliModelRegistry::unloadUnused() {
+  return std::erase_if(mModels, [](const auto &entry) { return entry.second.use_count() == 1; });
+}
+
+}
@@ -0,0 +1,337 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Memory-mapped, multithreaded Wavefront OBJ reader
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_obj_reader.h"
+#include "vermicelli_mapped_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+namespace vermicelli {
+
+/// Files smaller than this per thread are parsed with fewer threads; spawning costs more than it saves
+static constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+
+/// Exactly representable powers of ten, used by the fast path of parseFloat
+static constexpr double POW10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * A face corner as written in the chunk. Positive OBJ indices are absolute; negative ones count back from the last
+ * attribute seen, which a chunk only knows relative to its own start, so those are flagged and fixed up on merge.
+ */
+struct RawIndex {
+    int32_t mValues[3];
+    uint8_t mPresent;
+    uint8_t mRelative;
+};
+
+struct VermicelliObjReader::Chunk {
+    std::vector<float>    mPositions{};
+    std::vector<float>    mColors{};
+    std::vector<float>    mNormals{};
+    std::vector<float>    mTexcoords{};
+    std::vector<RawIndex> mIndices{};
+    std::vector<RawIndex> mPolygon{};
+    std::string           mError{};
+};
+
+static inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+static inline bool isDigit(char c) { return static_cast<unsigned>(c - '0') < 10; }
+
+static inline const char *skipBlanks(const char *cursor, const char *end) {
+  while (cursor < end && isBlank(*cursor)) {
+    ++cursor;
+  }
+  return cursor;
+}
+
+/**
+ * @brief Returns true if the line at cursor starts with the given statement keyword followed by a blank
+ */
+static inline bool isStatement(const char *cursor, const char *end, const char *keyword, size_t length) {
+  return static_cast<size_t>(end - cursor) > length && std::memcmp(cursor, keyword, length) == 0 &&
+         isBlank(cursor[length]);
+}
+
+/**
+ * @brief Runs work(0..count-1), one call per thread, with the calling thread taking the first one
+ */
+static void runParallel(size_t count, const std::function<void(size_t)> &work) {
+  std::vector<std::thread> threads;
+  threads.reserve(count - 1);
+  for (size_t i = 1; i < count; ++i) {
+    threads.emplace_back(work, i);
+  }
+  work(0);
+  for (auto &thread: threads) {
+    thread.join();
+  }
+}
+
+const char *VermicelliObjReader::parseFloat(const char *cursor, const char *end, float &value) {
+  cursor = skipBlanks(cursor, end);
+  const char *start    = cursor;
+  bool       negative = false;
+  if (cursor < end && (*cursor == '-' || *cursor == '+')) {
+    negative = *cursor == '-';
+    ++cursor;
+  }
+
+  /// Collect up to 19 significant digits, which always fit in 64 bits; the rest only shift the exponent
+  uint64_t mantissa  = 0;
+  int      exponent  = 0;
+  int      digits    = 0;
+  bool     hasDigits = false;
+  for (; cursor < end && isDigit(*cursor); ++cursor, hasDigits = true) {
+    if (digits < 19) {
+      mantissa = mantissa * 10 + (*cursor - '0');
+      digits += mantissa != 0;
+    } else {
+      ++exponent;
+    }
+  }
+  if (cursor < end && *cursor == '.') {
+    for (++cursor; cursor < end && isDigit(*cursor); ++cursor, hasDigits = true) {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + (*cursor - '0');
+        digits += mantissa != 0;
+        --exponent;
+      }
+    }
+  }
+  if (!hasDigits) {
+    return nullptr;
+  }
+
+  if (cursor < end && (*cursor == 'e' || *cursor == 'E')) {
+    const char *exponentStart    = cursor++;
+    bool       negativeExponent = false;
+    if (cursor < end && (*cursor == '-' || *cursor == '+')) {
+      negativeExponent = *cursor == '-';
+      ++cursor;
+    }
+    if (cursor < end && isDigit(*cursor)) {
+      int explicitExponent = 0;
+      for (; cursor < end && isDigit(*cursor); ++cursor) {
+        explicitExponent = std::min(explicitExponent * 10 + (*cursor - '0'), 100000);
+      }
+      exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    } else {
+      cursor = exponentStart; // A lone 'e' is not part of the number
+    }
+  }
+
+  /// Both the mantissa and the power of ten are exact doubles here, so one multiply or divide rounds correctly
+  if (mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+    double result = exponent < 0 ? static_cast<double>(mantissa) / POW10[-exponent]
+                                 : static_cast<double>(mantissa) * POW10[exponent];
+    value = static_cast<float>(negative ? -result : result);
+  } else {
+    value = static_cast<float>(std::strtod(std::string(start, cursor).c_str(), nullptr));
+  }
+  return cursor;
+}
+
+const char *VermicelliObjReader::parseIndex(const char *cursor, const char *end, int32_t &value) {
+  bool negative = cursor < end && *cursor == '-';
+  cursor += negative;
+  if (cursor >= end || !isDigit(*cursor)) {
+    return nullptr;
+  }
+  int64_t result = 0;
+  for (; cursor < end && isDigit(*cursor); ++cursor) {
+    result = std::min<int64_t>(result * 10 + (*cursor - '0'), INT32_MAX);
+  }
+  value = static_cast<int32_t>(negative ? -result : result);
+  return cursor;
+}
+
+void VermicelliObjReader::parseChunk(const char *cursor, const char *end, Chunk &chunk) {
+  while (cursor < end) {
+    auto *lineEnd = static_cast<const char *>(std::memchr(cursor, '\n', end - cursor));
+    lineEnd = lineEnd ? lineEnd : end;
+    cursor  = skipBlanks(cursor, lineEnd);
+
+    if (isStatement(cursor, lineEnd, "v", 1)) {
+      /// x y z, optionally followed by an r g b vertex color
+      float       values[6];
+      int         count = 0;
+      const char *next  = cursor + 1;
+      while (count < 6 && (next = parseFloat(next, lineEnd, values[count]))) {
+        ++count;
+      }
+      if (count < 3) {
+        chunk.mError = "vertex position with fewer than three coordinates";
+        return;
+      }
+      chunk.mPositions.insert(chunk.mPositions.end(), values, values + 3);
+      if (count == 6) {
+        chunk.mColors.insert(chunk.mColors.end(), values + 3, values + 6);
+      } else {
+        chunk.mColors.insert(chunk.mColors.end(), {1.0f, 1.0f, 1.0f});
+      }
+    } else if (isStatement(cursor, lineEnd, "vn", 2)) {
+      float       values[3];
+      const char *next = cursor + 2;
+      for (float &component: values) {
+        if (!(next = parseFloat(next, lineEnd, component))) {
+          chunk.mError = "vertex normal with fewer than three coordinates";
+          return;
+        }
+      }
+      chunk.mNormals.insert(chunk.mNormals.end(), values, values + 3);
+    } else if (isStatement(cursor, lineEnd, "vt", 2)) {
+      float       values[2] = {0.0f, 0.0f};
+      const char *next      = parseFloat(cursor + 2, lineEnd, values[0]);
+      if (!next) {
+        chunk.mError = "texture coordinate without a value";
+        return;
+      }
+      parseFloat(next, lineEnd, values[1]);
+      chunk.mTexcoords.insert(chunk.mTexcoords.end(), values, values + 2);
+    } else if (isStatement(cursor, lineEnd, "f", 1)) {
+      const size_t counts[3] = {chunk.mPositions.size() / 3, chunk.mTexcoords.size() / 2, chunk.mNormals.size() / 3};
+
+      chunk.mPolygon.clear();
+      const char *next = skipBlanks(cursor + 1, lineEnd);
+      while (next < lineEnd && *next != '#') {
+        /// v, v/vt, v//vn or v/vt/vn
+        RawIndex corner{};
+        for (int slot = 0; slot < 3; ++slot) {
+          if (slot > 0) {
+            if (next >= lineEnd || *next != '/') {
+              break;
+            }
+            ++next;
+            if (next < lineEnd && *next == '/') {
+              continue;
+            }
+          }
+          int32_t value;
+          if (!(next = parseIndex(next, lineEnd, value)) || value == 0) {
+            chunk.mError = "malformed face index";
+            return;
+          }
+          if (value > 0) {
+            corner.mValues[slot] = value - 1;
+          } else {
+            corner.mValues[slot] = static_cast<int32_t>(counts[slot]) + value;
+            corner.mRelative |= 1 << slot;
+          }
+          corner.mPresent |= 1 << slot;
+        }
+        if (!(corner.mPresent & 1)) {
+          chunk.mError = "face corner without a position";
+          return;
+        }
+        chunk.mPolygon.push_back(corner);
+        next = skipBlanks(next, lineEnd);
+      }
+
+      if (chunk.mPolygon.size() < 3) {
+        chunk.mError = "face with fewer than three corners";
+        return;
+      }
+      for (size_t i = 1; i + 1 < chunk.mPolygon.size(); ++i) {
+        chunk.mIndices.push_back(chunk.mPolygon[0]);
+        chunk.mIndices.push_back(chunk.mPolygon[i]);
+        chunk.mIndices.push_back(chunk.mPolygon[i + 1]);
+      }
+    }
+    cursor = lineEnd + 1;
+  }
+}
+
+VermicelliObjReader::VermicelliObjReader(const std::string &filePath, unsigned threadCount) {
+  VermicelliMappedFile file{filePath};
+  const char           *data = file.data();
+  const size_t         size  = file.size();
+
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  const size_t chunkCount = std::clamp<size_t>(size / MIN_CHUNK_SIZE, 1, threadCount);
+
+  /// Cut at the first newline after each even split point so no statement straddles two chunks
+  std::vector<const char *> bounds(chunkCount + 1, data + size);
+  bounds[0] = data;
+  for (size_t i = 1; i < chunkCount; ++i) {
+    const char *split   = std::max(data + size * i / chunkCount, bounds[i - 1]);
+    auto       *newline = static_cast<const char *>(std::memchr(split, '\n', data + size - split));
+    bounds[i] = newline ? newline + 1 : data + size;
+  }
+
+  std::vector<Chunk> chunks(chunkCount);
+  runParallel(chunkCount, [&](size_t i) { parseChunk(bounds[i], bounds[i + 1], chunks[i]); });
+
+  /// Where each chunk's attributes land in the merged arrays
+  struct Base {
+      size_t mPositions, mTexcoords, mNormals, mIndices;
+  };
+  std::vector<Base> bases(chunkCount + 1, Base{0, 0, 0, 0});
+  for (size_t       i = 0; i < chunkCount; ++i) {
+    if (!chunks[i].mError.empty()) {
+      throw std::runtime_error("ObjReader: " + filePath + ": " + chunks[i].mError);
+    }
+    bases[i + 1].mPositions = bases[i].mPositions + chunks[i].mPositions.size() / 3;
+    bases[i + 1].mTexcoords = bases[i].mTexcoords + chunks[i].mTexcoords.size() / 2;
+    bases[i + 1].mNormals   = bases[i].mNormals + chunks[i].mNormals.size() / 3;
+    bases[i + 1].mIndices   = bases[i].mIndices + chunks[i].mIndices.size();
+  }
+  const Base &total = bases[chunkCount];
+  mPositions.resize(total.mPositions * 3);
+  mColors.resize(total.mPositions * 3);
+  mTexcoords.resize(total.mTexcoords * 2);
+  mNormals.resize(total.mNormals * 3);
+  mIndices.resize(total.mIndices);
+
+  runParallel(chunkCount, [&](size_t i) {
+    Chunk      &chunk = chunks[i];
+    const Base &base  = bases[i];
+    std::copy(chunk.mPositions.begin(), chunk.mPositions.end(), mPositions.begin() + base.mPositions * 3);
+    std::copy(chunk.mColors.begin(), chunk.mColors.end(), mColors.begin() + base.mPositions * 3);
+    std::copy(chunk.mTexcoords.begin(), chunk.mTexcoords.end(), mTexcoords.begin() + base.mTexcoords * 2);
+    std::copy(chunk.mNormals.begin(), chunk.mNormals.end(), mNormals.begin() + base.mNormals * 3);
+
+    const size_t offsets[3] = {base.mPositions, base.mTexcoords, base.mNormals};
+    const size_t limits[3]  = {total.mPositions, total.mTexcoords, total.mNormals};
+    Index        *out       = mIndices.data() + base.mIndices;
+    for (const RawIndex &raw: chunk.mIndices) {
+      int32_t resolved[3];
+      for (int slot = 0; slot < 3; ++slot) {
+        if (!(raw.mPresent & (1 << slot))) {
+          resolved[slot] = NO_INDEX;
+          continue;
+        }
+        int64_t value = raw.mValues[slot] + static_cast<int64_t>((raw.mRelative & (1 << slot)) ? offsets[slot] : 0);
+        if (value < 0 || value >= static_cast<int64_t>(limits[slot])) {
+          chunk.mError = "face index out of range";
+          return;
+        }
+        resolved[slot] = static_cast<int32_t>(value);
+      }
+      *out++ = {resolved[0], resolved[1], resolved[2]};
+    }
+    chunk.mIndices = {};
+  });
+
+  for (const auto &chunk: chunks) {
+    if (!chunk.mError.empty()) {
+      throw std::runtime_error("ObjReader: " + filePath + ": " + chunk.mError);
+    }
+  }
+}
+
+}
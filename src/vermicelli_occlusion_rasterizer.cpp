@@ -0,0 +1,570 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Masked software occlusion culling: occluders rasterized on the CPU into a coarse depth buffer
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_occlusion_rasterizer.h"
+#include "vermicelli_camera.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VERMICELLI_OCCLUSION_X86
+#endif
+
+namespace vermicelli {
+
+using Triangle = VermicelliOcclusionRasterizer::Triangle;
+
+/// Full coverage of a subtile
+static constexpr uint32_t FULL_MASK = 0xFFFFFFFFu;
+
+/**
+ * @brief Sets up the triangle between three clip-space corners in front of the near plane; false if it covers no
+ * pixel center of a width x height buffer
+ */
+static bool setupTriangle(const glm::vec4 (&clip)[3], uint32_t width, uint32_t height, Triangle &triangle) {
+  glm::vec3 corners[3];
+  for (int  corner = 0; corner < 3; ++corner) {
+    float invW = 1.0f / clip[corner].w;
+    corners[corner] = {(clip[corner].x * invW * 0.5f + 0.5f) * static_cast<float>(width),
+                       (clip[corner].y * invW * 0.5f + 0.5f) * static_cast<float>(height), clip[corner].z * invW};
+  }
+
+  glm::vec2 lower = glm::min(glm::vec2(corners[0]), glm::min(glm::vec2(corners[1]), glm::vec2(corners[2])));
+  glm::vec2 upper = glm::max(glm::vec2(corners[0]), glm::max(glm::vec2(corners[1]), glm::vec2(corners[2])));
+  /// Clamped as floats first, a corner close to the near plane can be far outside what an int holds
+  lower = glm::clamp(lower, glm::vec2(0.0f), glm::vec2(static_cast<float>(width), static_cast<float>(height)));
+  upper = glm::clamp(upper, glm::vec2(0.0f), glm::vec2(static_cast<float>(width), static_cast<float>(height)));
+  triangle.mMinX = static_cast<int32_t>(std::floor(lower.x));
+  triangle.mMinY = static_cast<int32_t>(std::floor(lower.y));
+  triangle.mMaxX = static_cast<int32_t>(std::ceil(upper.x));
+  triangle.mMaxY = static_cast<int32_t>(std::ceil(upper.y));
+  if (triangle.mMinX >= triangle.mMaxX || triangle.mMinY >= triangle.mMaxY) {
+    return false;
+  }
+
+  const glm::vec3 &v0   = corners[0], &v1 = corners[1], &v2 = corners[2];
+  float           area  = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+  if (std::abs(area) < 1e-6f) {
+    return false;
+  }
+  /// Either winding is drawn, the edges just face inwards for both
+  float           sign  = area > 0.0f ? 1.0f : -1.0f;
+  for (int        edge  = 0; edge < 3; ++edge) {
+    const glm::vec3 &from = corners[edge], &to = corners[(edge + 1) % 3];
+    float           a     = (from.y - to.y) * sign;
+    float           b     = (to.x - from.x) * sign;
+    triangle.mEdges[edge] = {a, b, -(a * from.x + b * from.y)};
+  }
+
+  float depthX = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+  float depthY = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+  triangle.mDepth    = {depthX, depthY, v0.z - depthX * v0.x - depthY * v0.y};
+  triangle.mMaxDepth = std::min(1.0f, std::max(v0.z, std::max(v1.z, v2.z)));
+  return true;
+}
+
+/**
+ * @brief Which pixel centers of the subtile at (x, y) the triangle covers, bit 8 * row + column
+ */
+static uint32_t coverageScalar(const Triangle &triangle, int32_t x, int32_t y) {
+  uint32_t mask = 0;
+  for (uint32_t row = 0; row < VermicelliOcclusionRasterizer::SUBTILE_HEIGHT; ++row) {
+    float centerY = static_cast<float>(y + static_cast<int32_t>(row)) + 0.5f;
+    float rowC[3];
+    for (int edge = 0; edge < 3; ++edge) {
+      rowC[edge] = triangle.mEdges[edge].y * centerY + triangle.mEdges[edge].z;
+    }
+    for (uint32_t column = 0; column < VermicelliOcclusionRasterizer::SUBTILE_WIDTH; ++column) {
+      float centerX = static_cast<float>(x + static_cast<int32_t>(column)) + 0.5f;
+      bool  inside  = triangle.mEdges[0].x * centerX + rowC[0] >= 0.0f &&
+                      triangle.mEdges[1].x * centerX + rowC[1] >= 0.0f &&
+                      triangle.mEdges[2].x * centerX + rowC[2] >= 0.0f;
+      mask |= static_cast<uint32_t>(inside) << (row * VermicelliOcclusionRasterizer::SUBTILE_WIDTH + column);
+    }
+  }
+  return mask;
+}
+
+/**
+ * @brief Whether nearest is in front of any of count reference depths
+ */
+static bool anyNearerScalar(const float *reference, uint32_t count, float nearest) {
+  for (uint32_t i = 0; i < count; ++i) {
+    if (nearest < reference[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+#ifdef VERMICELLI_OCCLUSION_X86
+
+/// A subtile row per instruction, one pixel per lane, with the same arithmetic as coverageScalar so both agree.
+/// Built for AVX2 on its own, so the rest of the engine still runs on CPUs without it; only called when bestPath()
+/// found it.
+__attribute__((target("avx2")))
+static uint32_t coverageAvx2(const Triangle &triangle, int32_t x, int32_t y) {
+  const __m256 centersX = _mm256_add_ps(
+          _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))),
+          _mm256_set1_ps(0.5f));
+  __m256       edgeX[3];
+  for (int     edge     = 0; edge < 3; ++edge) {
+    edgeX[edge] = _mm256_mul_ps(_mm256_set1_ps(triangle.mEdges[edge].x), centersX);
+  }
+
+  const __m256 zero = _mm256_setzero_ps();
+  uint32_t     mask = 0;
+  for (uint32_t row = 0; row < VermicelliOcclusionRasterizer::SUBTILE_HEIGHT; ++row) {
+    float  centerY = static_cast<float>(y + static_cast<int32_t>(row)) + 0.5f;
+    __m256 inside  = _mm256_cmp_ps(
+            _mm256_add_ps(edgeX[0], _mm256_set1_ps(triangle.mEdges[0].y * centerY + triangle.mEdges[0].z)), zero,
+            _CMP_GE_OQ);
+    for (int edge = 1; edge < 3; ++edge) {
+      __m256 value = _mm256_add_ps(edgeX[edge],
+                                   _mm256_set1_ps(triangle.mEdges[edge].y * centerY + triangle.mEdges[edge].z));
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(value, zero, _CMP_GE_OQ));
+    }
+    mask |= static_cast<uint32_t>(_mm256_movemask_ps(inside)) << (row * VermicelliOcclusionRasterizer::SUBTILE_WIDTH);
+  }
+  return mask;
+}
+
+/// Eight reference depths per compare
+__attribute__((target("avx2")))
+static bool anyNearerAvx2(const float *reference, uint32_t count, float nearest) {
+  const __m256 depth = _mm256_set1_ps(nearest);
+  uint32_t     i     = 0;
+  for (; i + 8 <= count; i += 8) {
+    if (_mm256_movemask_ps(_mm256_cmp_ps(depth, _mm256_loadu_ps(reference + i), _CMP_LT_OQ)) != 0) {
+      return true;
+    }
+  }
+  return anyNearerScalar(reference + i, count - i, nearest);
+}
+
+#endif
+
+VermicelliOcclusionRasterizer::VermicelliOcclusionRasterizer(uint32_t width, uint32_t height, uint32_t threadCount,
+                                                             Path path)
+        : mPath{path}, mWidth{(std::max(width, 1u) + TILE_WIDTH - 1) / TILE_WIDTH * TILE_WIDTH},
+          mHeight{(std::max(height, 1u) + TILE_HEIGHT - 1) / TILE_HEIGHT * TILE_HEIGHT} {
+  mSubtilesX = mWidth / SUBTILE_WIDTH;
+  mTilesX    = mWidth / TILE_WIDTH;
+  mTilesY    = mHeight / TILE_HEIGHT;
+  mBins.resize(mTilesX * mTilesY);
+  size_t subtiles = mSubtilesX * (mHeight / SUBTILE_HEIGHT);
+  mReference.assign(subtiles, 1.0f);
+  mWorking.assign(subtiles, 0.0f);
+  mMasks.assign(subtiles, 0);
+
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (uint32_t thread = 1; thread < threadCount; ++thread) {
+    mWorkers.emplace_back(&VermicelliOcclusionRasterizer::workerLoop, this);
+  }
+}
+
+VermicelliOcclusionRasterizer::~VermicelliOcclusionRasterizer() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mWake.notify_all();
+  for (auto &worker: mWorkers) {
+    worker.join();
+  }
+}
+
+VermicelliOcclusionRasterizer::Path VermicelliOcclusionRasterizer::bestPath() {
+#ifdef VERMICELLI_OCCLUSION_X86
+  if (__builtin_cpu_supports("avx2")) {
+    return Path::AVX2;
+  }
+#endif
+  return Path::SCALAR;
+}
+
+const char *VermicelliOcclusionRasterizer::pathName(Path path) {
+  switch (path) {
+    case Path::AVX2:
+      return "AVX2";
+    default:
+      return "scalar";
+  }
+}
+
+void VermicelliOcclusionRasterizer::begin(const glm::mat4 &viewProjection) {
+  mViewProjection = viewProjection;
+  mOccluders.clear();
+  std::fill(mReference.begin(), mReference.end(), 1.0f);
+  std::fill(mWorking.begin(), mWorking.end(), 0.0f);
+  std::fill(mMasks.begin(), mMasks.end(), 0u);
+  mStats = {};
+}
+
+void VermicelliOcclusionRasterizer::addOccluder(const glm::mat4 &model, std::span<const glm::vec3> positions,
+                                                std::span<const uint32_t> indices) {
+  mOccluders.push_back({mViewProjection * model, positions, indices, 0});
+}
+
+void VermicelliOcclusionRasterizer::render() {
+  auto start = std::chrono::high_resolution_clock::now();
+
+  size_t room = 0;
+  for (auto &occluder: mOccluders) {
+    occluder.mFirstTriangle = room;
+    room += occluder.mIndices.size() / 3 * 2;
+  }
+  mTriangles.resize(room);
+  mTriangleCounts.assign(mOccluders.size(), 0);
+  parallelFor(mOccluders.size(), [this](size_t occluder) { setupOccluder(occluder); });
+
+  /// Binned on one thread, so every tile sees its triangles in the order they were added
+  for (auto &bin: mBins) {
+    bin.clear();
+  }
+  mStats.mTriangles = 0;
+  for (size_t occluder = 0; occluder < mOccluders.size(); ++occluder) {
+    auto first = static_cast<uint32_t>(mOccluders[occluder].mFirstTriangle);
+    for (uint32_t index = first; index < first + mTriangleCounts[occluder]; ++index) {
+      const Triangle &triangle = mTriangles[index];
+      for (int32_t   tileY     = triangle.mMinY / static_cast<int32_t>(TILE_HEIGHT);
+           tileY <= (triangle.mMaxY - 1) / static_cast<int32_t>(TILE_HEIGHT); ++tileY) {
+        for (int32_t tileX = triangle.mMinX / static_cast<int32_t>(TILE_WIDTH);
+             tileX <= (triangle.mMaxX - 1) / static_cast<int32_t>(TILE_WIDTH); ++tileX) {
+          mBins[tileY * mTilesX + tileX].push_back(index);
+        }
+      }
+    }
+    mStats.mTriangles += mTriangleCounts[occluder];
+  }
+
+  parallelFor(mBins.size(), [this](size_t tile) { rasterizeTile(tile); });
+
+  mStats.mOccluders          = static_cast<uint32_t>(mOccluders.size());
+  mStats.mRenderMilliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(
+          std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void VermicelliOcclusionRasterizer::setupOccluder(size_t index) {
+  const Occluder &occluder = mOccluders[index];
+  Triangle       *out      = &mTriangles[occluder.mFirstTriangle];
+  uint32_t       written   = 0;
+  for (size_t    first     = 0; first + 3 <= occluder.mIndices.size(); first += 3) {
+    glm::vec4 clip[3];
+    uint32_t  outside = 0x3F; ///< Planes every corner is outside of: -x, +x, -y, +y, near, far
+    uint32_t  behind  = 0;    ///< Corners in front of the near plane
+    for (int  corner  = 0; corner < 3; ++corner) {
+      clip[corner] = occluder.mTransform * glm::vec4(occluder.mPositions[occluder.mIndices[first + corner]], 1.0f);
+      const glm::vec4 &c = clip[corner];
+      outside &= (c.x < -c.w ? 1u : 0u) | (c.x > c.w ? 2u : 0u) | (c.y < -c.w ? 4u : 0u) | (c.y > c.w ? 8u : 0u) |
+                 (c.z < 0.0f ? 16u : 0u) | (c.z > c.w ? 32u : 0u);
+      behind += c.z < 0.0f ? 1 : 0;
+    }
+    if (outside != 0) {
+      continue;
+    }
+
+    if (behind == 0) {
+      written += setupTriangle(clip, mWidth, mHeight, out[written]) ? 1 : 0;
+      continue;
+    }
+
+    /// Clipped against the near plane, which leaves a triangle or a quad; depth runs from 0 to 1, so it is z = 0
+    glm::vec4 polygon[4];
+    int       corners = 0;
+    for (int  corner  = 0; corner < 3; ++corner) {
+      const glm::vec4 &from = clip[corner], &to = clip[(corner + 1) % 3];
+      if (from.z >= 0.0f) {
+        polygon[corners++] = from;
+      }
+      if ((from.z >= 0.0f) != (to.z >= 0.0f)) {
+        polygon[corners++] = glm::mix(from, to, from.z / (from.z - to.z));
+      }
+    }
+    for (int fan = 2; fan < corners; ++fan) {
+      const glm::vec4 triangle[3] = {polygon[0], polygon[fan - 1], polygon[fan]};
+      written += setupTriangle(triangle, mWidth, mHeight, out[written]) ? 1 : 0;
+    }
+  }
+  mTriangleCounts[index] = written;
+}
+
+void VermicelliOcclusionRasterizer::rasterizeTile(size_t tile) {
+  const int32_t tileX = static_cast<int32_t>(tile % mTilesX * TILE_WIDTH);
+  const int32_t tileY = static_cast<int32_t>(tile / mTilesX * TILE_HEIGHT);
+  for (uint32_t index: mBins[tile]) {
+    const Triangle &triangle = mTriangles[index];
+    int32_t        minX      = std::max(triangle.mMinX, tileX);
+    int32_t        maxX      = std::min(triangle.mMaxX, tileX + static_cast<int32_t>(TILE_WIDTH));
+    int32_t        minY      = std::max(triangle.mMinY, tileY);
+    int32_t        maxY      = std::min(triangle.mMaxY, tileY + static_cast<int32_t>(TILE_HEIGHT));
+
+    for (int32_t y = minY / SUBTILE_HEIGHT * SUBTILE_HEIGHT; y < maxY; y += SUBTILE_HEIGHT) {
+      for (int32_t x = minX / SUBTILE_WIDTH * SUBTILE_WIDTH; x < maxX; x += SUBTILE_WIDTH) {
+        /// The plane's farthest over the part of the subtile the triangle can reach, which is at one of its corners
+        float    nearX   = static_cast<float>(std::max(x, minX));
+        float    farX    = static_cast<float>(std::min(x + static_cast<int32_t>(SUBTILE_WIDTH), maxX));
+        float    nearY   = static_cast<float>(std::max(y, minY));
+        float    farY    = static_cast<float>(std::min(y + static_cast<int32_t>(SUBTILE_HEIGHT), maxY));
+        float    depth   = std::min(triangle.mMaxDepth, triangle.mDepth.x * (triangle.mDepth.x > 0.0f ? farX : nearX) +
+                                                        triangle.mDepth.y * (triangle.mDepth.y > 0.0f ? farY : nearY) +
+                                                        triangle.mDepth.z);
+        uint32_t subtile = y / SUBTILE_HEIGHT * mSubtilesX + x / SUBTILE_WIDTH;
+        if (depth >= mReference[subtile]) {
+          continue; // Already hidden here, whatever it covers
+        }
+#ifdef VERMICELLI_OCCLUSION_X86
+        uint32_t coverage = mPath == Path::AVX2 ? coverageAvx2(triangle, x, y) : coverageScalar(triangle, x, y);
+#else
+        uint32_t coverage = coverageScalar(triangle, x, y);
+#endif
+        if (coverage != 0) {
+          updateSubtile(subtile, coverage, depth);
+        }
+      }
+    }
+  }
+}
+
+void VermicelliOcclusionRasterizer::updateSubtile(uint32_t subtile, uint32_t coverage, float depth) {
+  float    &reference = mReference[subtile];
+  float    &working   = mWorking[subtile];
+  uint32_t &mask      = mMasks[subtile];
+  /// A working layer further behind the triangle than it is in front of the reference is worth less than the triangle
+  if (mask != 0 && working - depth > reference - working) {
+    mask    = 0;
+    working = 0.0f;
+  }
+  mask |= coverage;
+  working = std::max(working, depth);
+  if (mask == FULL_MASK) {
+    reference = working;
+    mask      = 0;
+    working   = 0.0f;
+  }
+}
+
+bool VermicelliOcclusionRasterizer::isVisible(const glm::vec4 &sphere) const {
+  /// The same screen rectangle and nearest depth as the GPU's occlusion test, from the cube around the sphere. Its
+  /// corners are the center plus or minus each axis, which the view-projection only needs to transform once.
+  const glm::vec4 center = mViewProjection * glm::vec4(glm::vec3(sphere), 1.0f);
+  const glm::vec4 axes[3] = {mViewProjection[0] * sphere.w, mViewProjection[1] * sphere.w,
+                             mViewProjection[2] * sphere.w};
+  glm::vec2       lower{1.0f};
+  glm::vec2       upper{-1.0f};
+  float           nearest = 1.0f;
+  for (int        corner  = 0; corner < 8; ++corner) {
+    glm::vec4 clip = center + (corner & 1 ? axes[0] : -axes[0]) + (corner & 2 ? axes[1] : -axes[1]) +
+                     (corner & 4 ? axes[2] : -axes[2]);
+    if (clip.w <= 0.0f) {
+      return true; // Reaches behind the camera
+    }
+    glm::vec3 ndc = glm::vec3(clip) / clip.w;
+    lower   = glm::min(lower, glm::vec2(ndc));
+    upper   = glm::max(upper, glm::vec2(ndc));
+    nearest = std::min(nearest, ndc.z);
+  }
+  if (nearest <= 0.0f || upper.x < -1.0f || upper.y < -1.0f || lower.x > 1.0f || lower.y > 1.0f) {
+    return true; // In front of the near plane, or where nothing was rasterized
+  }
+
+  const glm::vec2 size{static_cast<float>(mWidth), static_cast<float>(mHeight)};
+  lower = glm::clamp(lower * 0.5f + 0.5f, 0.0f, 1.0f) * size;
+  upper = glm::clamp(upper * 0.5f + 0.5f, 0.0f, 1.0f) * size;
+  auto firstX = std::min(static_cast<uint32_t>(lower.x), mWidth - 1) / SUBTILE_WIDTH;
+  auto lastX  = std::min(static_cast<uint32_t>(upper.x), mWidth - 1) / SUBTILE_WIDTH;
+  auto firstY = std::min(static_cast<uint32_t>(lower.y), mHeight - 1) / SUBTILE_HEIGHT;
+  auto lastY  = std::min(static_cast<uint32_t>(upper.y), mHeight - 1) / SUBTILE_HEIGHT;
+  for (uint32_t row = firstY; row <= lastY; ++row) {
+    const float *reference = &mReference[row * mSubtilesX + firstX];
+#ifdef VERMICELLI_OCCLUSION_X86
+    bool nearer = mPath == Path::AVX2 ? anyNearerAvx2(reference, lastX - firstX + 1, nearest)
+                                      : anyNearerScalar(reference, lastX - firstX + 1, nearest);
+#else
+    bool nearer = anyNearerScalar(reference, lastX - firstX + 1, nearest);
+#endif
+    if (nearer) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void VermicelliOcclusionRasterizer::filter(std::span<const glm::vec4> spheres, std::vector<uint32_t> &indices) {
+  auto start = std::chrono::high_resolution_clock::now();
+  auto tested = static_cast<uint32_t>(indices.size());
+  std::erase_if(indices, [&](uint32_t index) { return !isVisible(spheres[index]); });
+  mStats.mTested += tested;
+  mStats.mOccluded += tested - static_cast<uint32_t>(indices.size());
+  mStats.mTestMilliseconds += std::chrono::duration<float, std::chrono::milliseconds::period>(
+          std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void VermicelliOcclusionRasterizer::parallelFor(size_t count, const std::function<void(size_t index)> &fn) {
+  if (mWorkers.empty() || count <= 1) {
+    for (size_t index = 0; index < count; ++index) {
+      fn(index);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mJob         = &fn;
+    mJobCount    = count;
+    mIndicesDone = 0;
+    mNextIndex.store(0);
+    ++mGeneration;
+  }
+  mWake.notify_all();
+
+  runJob();
+
+  /// Workers that woke up too late to take an index must still be out before the job is replaced
+  std::unique_lock<std::mutex> lock(mMutex);
+  mDone.wait(lock, [this] { return mIndicesDone == mJobCount && mActive == 0; });
+  mJob = nullptr;
+}
+
+void VermicelliOcclusionRasterizer::workerLoop() {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWake.wait(lock, [&] { return mStopping || mGeneration != seen; });
+      if (mStopping) {
+        return;
+      }
+      seen = mGeneration;
+      if (mJob == nullptr) {
+        continue; // Woke up after the job it was woken for had finished; the next one will wake it again
+      }
+      ++mActive;
+    }
+
+    runJob();
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      --mActive;
+    }
+    mDone.notify_all();
+  }
+}
+
+void VermicelliOcclusionRasterizer::runJob() {
+  /// Counted once on the way out, rather than taking the lock for every index
+  size_t done = 0;
+  for (;;) {
+    size_t index = mNextIndex.fetch_add(1);
+    if (index >= mJobCount) {
+      break;
+    }
+    (*mJob)(index);
+    ++done;
+  }
+  if (done != 0) {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mIndicesDone += done;
+    }
+    mDone.notify_all();
+  }
+}
+
+void VermicelliOcclusionRasterizer::benchmark(const uint32_t occluderCount, const uint32_t objectCount) {
+  /// Standing in a street of box buildings, twelve triangles each like the proxies a level would designate, with
+  /// objects scattered between them at street level; up is -y
+  VermicelliCamera camera{};
+  camera.setPerspectiveProjection(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+  camera.setViewYXZ(glm::vec3{0.0f, -1.7f, 0.0f}, glm::vec3{0.0f, 0.3f, 0.0f});
+  const glm::mat4 viewProjection = camera.getProjection() * camera.getView();
+
+  const std::vector<glm::vec3> cubePositions{{-0.5f, -0.5f, -0.5f}, {0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, -0.5f},
+                                             {-0.5f, 0.5f, -0.5f}, {-0.5f, -0.5f, 0.5f}, {0.5f, -0.5f, 0.5f},
+                                             {0.5f, 0.5f, 0.5f}, {-0.5f, 0.5f, 0.5f}};
+  const std::vector<uint32_t>  cubeIndices{0, 1, 2, 0, 2, 3, 5, 4, 7, 5, 7, 6, 4, 0, 3, 4, 3, 7,
+                                           1, 5, 6, 1, 6, 2, 3, 2, 6, 3, 6, 7, 4, 5, 1, 4, 1, 0};
+
+  /// Blocks of 12 units on a square grid in front of the camera, with the column it stands in left open as a street
+  std::mt19937                          random{42};
+  std::uniform_real_distribution<float> footprint{5.0f, 10.0f};
+  std::uniform_real_distribution<float> storeys{4.0f, 40.0f};
+  const auto                            side = static_cast<int32_t>(std::ceil(std::sqrt(occluderCount + 0.0f)));
+  std::vector<glm::mat4>                buildings;
+  for (int32_t                          cell = 0; buildings.size() < occluderCount; ++cell) {
+    float x = static_cast<float>(cell % (side + 1) - side / 2) * 12.0f;
+    float z = static_cast<float>(cell / (side + 1)) * 12.0f + 10.0f;
+    if (x == 0.0f) {
+      continue;
+    }
+    glm::vec3 scale{footprint(random), storeys(random), footprint(random)};
+    buildings.push_back(glm::scale(glm::translate(glm::mat4{1.0f}, {x, -scale.y * 0.5f, z}), scale));
+  }
+
+  std::uniform_real_distribution<float> across{-side * 6.0f, side * 6.0f};
+  std::uniform_real_distribution<float> along{2.0f, side * 12.0f + 10.0f};
+  std::uniform_real_distribution<float> radius{0.2f, 1.5f};
+  std::vector<glm::vec4>                spheres(objectCount);
+  for (auto                             &sphere: spheres) {
+    float r = radius(random);
+    sphere = {across(random), -r, along(random), r};
+  }
+
+  std::vector<Path> paths{Path::SCALAR};
+  if (bestPath() == Path::AVX2) {
+    paths.push_back(Path::AVX2);
+  }
+  std::vector<uint32_t> threadCounts{1};
+  if (std::thread::hardware_concurrency() > 1) {
+    threadCounts.push_back(std::thread::hardware_concurrency());
+  }
+
+  constexpr int iterations = 50;
+  std::cout << "Rasterizing " << occluderCount << " occluders and testing " << objectCount << " objects, best of "
+            << iterations << " runs:" << std::endl;
+  std::vector<uint32_t> visible;
+  for (Path path: paths) {
+    for (uint32_t threads: threadCounts) {
+      VermicelliOcclusionRasterizer rasterizer{320, 192, threads, path};
+      float                         bestRender = std::numeric_limits<float>::max();
+      float                         bestTest   = std::numeric_limits<float>::max();
+      for (int                      i          = 0; i < iterations; ++i) {
+        rasterizer.begin(viewProjection);
+        for (const auto &model: buildings) {
+          rasterizer.addOccluder(model, cubePositions, cubeIndices);
+        }
+        rasterizer.render();
+        visible.resize(spheres.size());
+        for (uint32_t index = 0; index < visible.size(); ++index) {
+          visible[index] = index;
+        }
+        rasterizer.filter(spheres, visible);
+        bestRender = std::min(bestRender, rasterizer.stats().mRenderMilliseconds);
+        bestTest   = std::min(bestTest, rasterizer.stats().mTestMilliseconds);
+      }
+      const Stats &stats = rasterizer.stats();
+      std::cout << "  " << pathName(path) << ", " << threads << (threads == 1 ? " thread: " : " threads: ")
+                << bestRender << " ms to rasterize " << stats.mTriangles << " triangles, " << bestTest
+                << " ms to test, " << stats.mOccluded << " of " << stats.mTested << " hidden" << std::endl;
+    }
+  }
+}
+
+}
@@ -42,6 +42,13 @@ void VermicelliPipeline::createGraphicsPipeline(const std::string &vertFilePath,
   createShaderModule(vertCode, &mVertShaderModule);
   createShaderModule(fragCode, &mFragShaderModule);
 
+  VkSpecializationInfo specializationInfo{};
+  specializationInfo.mapEntryCount = static_cast<uint32_t>(configInfo.mSpecializationEntries.size());
+  specializationInfo.pMapEntries   = configInfo.mSpecializationEntries.data();
+  specializationInfo.dataSize      = configInfo.mSpecializationData.size();
+  specializationInfo.pData         = configInfo.mSpecializationData.data();
+  auto *pSpecializationInfo = configInfo.mSpecializationEntries.empty() ? nullptr : &specializationInfo;
+
   VkPipelineShaderStageCreateInfo shaderStages[2];
   shaderStages[0].sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   shaderStages[0].stage               = VK_SHADER_STAGE_VERTEX_BIT;
@@ -49,7 +56,7 @@ void VermicelliPipeline::createGraphicsPipeline(const std::string &vertFilePath,
   shaderStages[0].pName               = "main";
   shaderStages[0].flags               = 0;
   shaderStages[0].pNext               = nullptr;
-  shaderStages[0].pSpecializationInfo = nullptr;
+  shaderStages[0].pSpecializationInfo = pSpecializationInfo;
 
   shaderStages[1].sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   shaderStages[1].stage               = VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -57,7 +64,7 @@ void VermicelliPipeline::createGraphicsPipeline(const std::string &vertFilePath,
   shaderStages[1].pName               = "main";
   shaderStages[1].flags               = 0;
   shaderStages[1].pNext               = nullptr;
-  shaderStages[1].pSpecializationInfo = nullptr;
+  shaderStages[1].pSpecializationInfo = pSpecializationInfo;
 
   auto                                 &attributeDescriptions = configInfo.mAttributeDescriptions;
   auto                                 &bindingDescriptions   = configInfo.mBindingDescriptions;
@@ -121,6 +128,45 @@ void VermicelliPipeline::bind(VkCommandBuffer commandBuffer) {
   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mGraphicsPipeline);
 }
 
+VermicelliComputePipeline::VermicelliComputePipeline(VermicelliDevice &device, const std::string &compFilePath,
+                                                     VkPipelineLayout pipelineLayout,
+                                                     const VkSpecializationInfo *specializationInfo)
+        : mDevice(device) {
+  assert(pipelineLayout != VK_NULL_HANDLE && "Cannot create compute pipeline: no pipelineLayout provided");
+  auto compCode = VermicelliPipeline::readFile(compFilePath);
+
+  VkShaderModuleCreateInfo moduleInfo{};
+  moduleInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  moduleInfo.codeSize = compCode.size();
+  moduleInfo.pCode    = reinterpret_cast<const uint32_t *>(compCode.data());
+  if (vkCreateShaderModule(mDevice.device(), &moduleInfo, nullptr, &mShaderModule) != VK_SUCCESS) {
+    throw std::runtime_error("Failed to create shader module");
+  }
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage               = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module              = mShaderModule;
+  pipelineInfo.stage.pName               = "main";
+  pipelineInfo.stage.pSpecializationInfo = specializationInfo;
+  pipelineInfo.layout                    = pipelineLayout;
+
+  if (vkCreateComputePipelines(mDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &mComputePipeline) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create compute pipeline!");
+  }
+}
+
+VermicelliComputePipeline::~VermicelliComputePipeline() {
+  vkDestroyShaderModule(mDevice.device(), mShaderModule, nullptr);
+  vkDestroyPipeline(mDevice.device(), mComputePipeline, nullptr);
+}
+
+void VermicelliComputePipeline::bind(VkCommandBuffer commandBuffer) {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mComputePipeline);
+}
+
 void VermicelliPipeline::defaultPipelineConfigInfo(PipelineConfigInfo &configInfo) {
   configInfo.mInputAssemblyInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
   configInfo.mInputAssemblyInfo.topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
@@ -8,13 +8,16 @@
 
 #include "vermicelli_renderer.h"
 #include "vermicelli_functions.h"
+#include "vermicelli_deletion_queue.h"
+#include "vermicelli_frame_timeline.h"
+#include "vermicelli_uploader.h"
 #include <stdexcept>
 #include <array>
 
 namespace vermicelli {
 
 VermicelliRenderer::VermicelliRenderer(VermicelliWindow &window, VermicelliDevice &device, const bool verbose)
-        : mWindow(window), mDevice(device), mVerbose(verbose) {
+        : mWindow(window), mDevice(device), mVerbose(verbose), mRecorder(device, 0, verbose) {
   recreateSwapChain();
   createCommandBuffers();
 }
@@ -32,19 +35,26 @@ void VermicelliRenderer::recreateSwapChain() {
     SDL_WaitEvent(&windowEvent);
   }
 
-  vkDeviceWaitIdle(mDevice.device());
   if (mSwapChain == nullptr) {
-    mSwapChain = std::make_unique<VermicelliSwapChain>(mDevice, extent, mVerbose);
+    mSwapChain = std::make_unique<VermicelliSwapChain>(mDevice, extent, mVerbose, mSampledDepth);
   } else {
     std::shared_ptr<VermicelliSwapChain> oldSwapChain = std::move(mSwapChain);
-    mSwapChain = std::make_unique<VermicelliSwapChain>(mDevice, extent, mVerbose, oldSwapChain);
+    mSwapChain = std::make_unique<VermicelliSwapChain>(mDevice, extent, mVerbose, mSampledDepth, oldSwapChain);
 
     if (!oldSwapChain->compareSwapFormats(*mSwapChain.get())) {
       throw std::runtime_error("Swap chain image/depth format has changed");
       // Fixme: Create callback function notifying the app that a new incompatible render pass has been created
     }
+
+    /// Frames in flight still render into its framebuffers; it goes once they are done
+    mDevice.deletionQueue().retire(std::move(oldSwapChain));
   }
 
+  /// The pyramid reads the old swap chain's depth images, so it goes with them
+  if (mDepthPyramid != nullptr) {
+    mDevice.deletionQueue().retire(std::move(mDepthPyramid));
+    mDepthPyramid = std::make_unique<VermicelliDepthPyramid>(mDevice, *mSwapChain, mVerbose);
+  }
 }
 
 void VermicelliRenderer::createCommandBuffers() {
@@ -71,6 +81,10 @@ void VermicelliRenderer::freeCommandBuffers() {
 
 VkCommandBuffer VermicelliRenderer::beginFrame() {
   assert(!mIsFrameStarted && "Cannot call beginFrame while already in progress");
+  /// The slot's command buffer and semaphores are free again once the last frame recorded in it is done
+  mDevice.frameTimeline().wait(mSlotFrames[mCurrentFrameIndex]);
+  mDevice.deletionQueue().collect();
+
   auto res = mSwapChain->acquireNextImage(&mCurrentImageIndex);
 
   if (res == VK_ERROR_OUT_OF_DATE_KHR) {
@@ -82,6 +96,9 @@ VkCommandBuffer VermicelliRenderer::beginFrame() {
     throw std::runtime_error("Failed to acquire next mSwapChain image");
   }
   mIsFrameStarted = true;
+  mSlotFrames[mCurrentFrameIndex] = ++mFrameNumber;
+  mDevice.deletionQueue().beginFrame(mFrameNumber);
+  mRecorder.beginFrame(mCurrentFrameIndex);
   auto                     cmdBuffer = getCommandBuffer();
   VkCommandBufferBeginInfo beginInfo{};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -99,7 +116,7 @@ void VermicelliRenderer::endFrame() {
     throw std::runtime_error("Failed to record command buffer");
   }
 
-  auto res = mSwapChain->submitCommandBuffers(&cmdBuffer, &mCurrentImageIndex);
+  auto res = mSwapChain->submitCommandBuffers(&cmdBuffer, &mCurrentImageIndex, mFrameNumber);
   if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR || mWindow.wasWindowResized()) {
     mWindow.resetWindowResizedFLag();
     recreateSwapChain();
@@ -110,16 +127,34 @@ void VermicelliRenderer::endFrame() {
   mCurrentFrameIndex = (mCurrentFrameIndex + 1) % VermicelliSwapChain::MAX_FRAMES_IN_FLIGHT;
 }
 
+void VermicelliRenderer::finishFrames() {
+  assert(!mIsFrameStarted && "Cannot wait for frames while one is being recorded");
+  mDevice.frameTimeline().wait(mDevice.frameTimeline().lastSubmitted());
+  mDevice.uploader().waitIdle();
+  mDevice.deletionQueue().collect();
+}
+
 void VermicelliRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
   assert(mIsFrameStarted && "Cannot call beginSwapChainRenderPass while frame is not in progress");
   assert(commandBuffer == getCommandBuffer() && "Can't begin render pass on a command buffer from a different frame");
+  beginRenderPass(commandBuffer, mSwapChain->getRenderPass());
+}
 
+void VermicelliRenderer::resumeSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+  assert(mIsFrameStarted && "Cannot call resumeSwapChainRenderPass while frame is not in progress");
+  assert(commandBuffer == getCommandBuffer() && "Can't begin render pass on a command buffer from a different frame");
+  assert(mSwapChain->isDepthSampled() && "Depth is only kept for resuming while the depth pyramid is enabled");
+  beginRenderPass(commandBuffer, mSwapChain->getResumeRenderPass());
+}
+
+void VermicelliRenderer::beginRenderPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass) {
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassInfo.renderPass        = mSwapChain->getRenderPass();
+  renderPassInfo.renderPass        = renderPass;
   renderPassInfo.framebuffer       = mSwapChain->getFrameBuffer(mCurrentImageIndex);
   renderPassInfo.renderArea.offset = {0, 0};
   renderPassInfo.renderArea.extent = mSwapChain->getSwapChainExtent();
+  /// Ignored when resuming, which loads both attachments
   std::array<VkClearValue, 2> clearValues{};
   clearValues[0].color        = {0.01f, 0.01f, 0.01f, 1.0f};
   clearValues[1].depthStencil = {1.0f, 0};
@@ -127,19 +162,9 @@ void VermicelliRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer)
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues    = clearValues.data();
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-  VkViewport viewport{};
-  viewport.x        = 0.0f;
-  viewport.y        = 0.0f;
-  viewport.width    = static_cast<float>(mSwapChain->getSwapChainExtent().width);
-  viewport.height   = static_cast<float>(mSwapChain->getSwapChainExtent().height);
-  viewport.minDepth = 0.0f;
-  viewport.maxDepth = 1.0f;
-  VkRect2D scissor{{0, 0}, mSwapChain->getSwapChainExtent()};
-  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
+  /// The viewport and scissor are set in each secondary, the primary may only execute them inside the pass
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+  mRecorder.beginRenderPass(renderPassInfo.renderPass, renderPassInfo.framebuffer, renderPassInfo.renderArea.extent);
 }
 
 void VermicelliRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) const {
@@ -149,4 +174,25 @@ void VermicelliRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) c
   vkCmdEndRenderPass(commandBuffer);
 }
 
+void VermicelliRenderer::setDepthPyramid(const bool enabled) {
+  assert(!mIsFrameStarted && "Cannot change the depth pyramid while a frame is in progress");
+  if (!enabled) {
+    mDevice.deletionQueue().retire(std::move(mDepthPyramid));
+  }
+  /// Only the pyramid reads depth after the render pass, so it is kept, and sampleable, just while there is one
+  if (enabled != mSampledDepth) {
+    mSampledDepth = enabled;
+    recreateSwapChain();
+  }
+  if (enabled && mDepthPyramid == nullptr) {
+    mDepthPyramid = std::make_unique<VermicelliDepthPyramid>(mDevice, *mSwapChain, mVerbose);
+  }
+}
+
+void VermicelliRenderer::buildDepthPyramid(VkCommandBuffer commandBuffer, const glm::mat4 &viewProjection) {
+  assert(mIsFrameStarted && "Cannot call buildDepthPyramid while frame is not in progress");
+  assert(mDepthPyramid != nullptr && "The depth pyramid is not enabled");
+  mDepthPyramid->build(commandBuffer, mCurrentImageIndex, viewProjection);
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,147 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Device-resident per-object records, indexed by a stable slot and updated only when objects change
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_scene_buffer.h"
+#include "vermicelli_model.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace vermicelli {
+
+VermicelliSceneBuffer::VermicelliSceneBuffer(VermicelliDevice &device, const uint32_t capacity, const bool verbose)
+        : mDevice{device}, mVerbose(verbose), mCapacity(capacity) {
+  mBuffer = std::make_unique<VermicelliBuffer>(
+          device,
+          sizeof(ObjectRecord),
+          capacity,
+          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+          VermicelliMemoryAllocator::Category::GEOMETRY
+                                              );
+
+  if (mVerbose) {
+    std::cout << "Scene buffer: " << capacity << " x " << sizeof(ObjectRecord) << " bytes" << std::endl;
+  }
+}
+
+VermicelliSceneBuffer::Slot VermicelliSceneBuffer::allocate() {
+  if (!mFreeSlots.empty()) {
+    Slot slot = mFreeSlots.back();
+    mFreeSlots.pop_back();
+    return slot;
+  }
+  if (mNextSlot == mCapacity) {
+    throw std::runtime_error("scene buffer out of slots, increase its capacity!");
+  }
+  return mNextSlot++;
+}
+
+void VermicelliSceneBuffer::release(Slot slot) {
+  assert(slot < mNextSlot && "Releasing a slot that was never handed out");
+  mFreeSlots.push_back(slot);
+}
+
+void VermicelliSceneBuffer::write(Slot slot, VermicelliGameObject &object) {
+  assert(slot < mNextSlot && "Writing a slot that was never handed out");
+  const VermicelliModel &model     = *object.mModel;
+  glm::mat4             transform  = object.mTransform.mat4();
+  glm::mat4             modelWorld = transform * model.dequantization();
+
+  ObjectRecord record{};
+  for (int row = 0; row < 3; ++row) {
+    record.mModelRows[row] = glm::vec4(modelWorld[0][row], modelWorld[1][row], modelWorld[2][row], modelWorld[3][row]);
+  }
+
+  /// mat3(model) is R * S * D for rotation R, scale S and the dequantization scale D, while normals need R * S^-1
+  glm::vec3 scale        = object.mTransform.mScale;
+  glm::vec3 dequantScale = {model.dequantization()[0][0], model.dequantization()[1][1],
+                            model.dequantization()[2][2]};
+  record.mNormalScale = glm::vec4(1.0f / (dequantScale * scale * scale), 0.0f);
+
+  glm::vec3 absScale = glm::abs(scale);
+  record.mBounds = glm::vec4(glm::vec3(transform * glm::vec4(model.boundingCenter(), 1.0f)),
+                             model.boundingRadius() * std::max(absScale.x, std::max(absScale.y, absScale.z)));
+  record.mMesh   = {object.mLod, modelId(object.mModel), object.getID(), object.mStatic ? STATIC_FLAG : 0u};
+
+  mPending.emplace_back(slot, record);
+}
+
+void VermicelliSceneBuffer::flush(VkCommandBuffer commandBuffer, VermicelliFrameAllocator &frameAllocator) {
+  /// A handful of models, so checking them all each frame costs nothing worth tracking unloads for
+  std::erase_if(mModelIds, [](const auto &entry) { return entry.second.mModel.expired(); });
+  mLastUploadBytes = 0;
+  if (mPending.empty()) {
+    return;
+  }
+
+  /// Regions of one copy must not overlap, so only the last write to each slot is kept
+  std::stable_sort(mPending.begin(), mPending.end(),
+                   [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+  size_t      kept = 0;
+  for (size_t i    = 0; i < mPending.size(); ++i) {
+    if (i + 1 < mPending.size() && mPending[i + 1].first == mPending[i].first) continue;
+    mPending[kept++] = mPending[i];
+  }
+  mPending.resize(kept);
+
+  auto staging = frameAllocator.allocate(mPending.size() * sizeof(ObjectRecord),
+                                         VermicelliFrameAllocator::Usage::TRANSFER);
+  auto *records = static_cast<ObjectRecord *>(staging.mData);
+
+  /// Consecutive slots are staged back to back, so runs of them become a single region
+  std::vector<VkBufferCopy> regions;
+  for (size_t               i = 0; i < mPending.size(); ++i) {
+    records[i] = mPending[i].second;
+    VkDeviceSize src = staging.mOffset + i * sizeof(ObjectRecord);
+    VkDeviceSize dst = static_cast<VkDeviceSize>(mPending[i].first) * sizeof(ObjectRecord);
+    if (!regions.empty() && regions.back().srcOffset + regions.back().size == src &&
+        regions.back().dstOffset + regions.back().size == dst) {
+      regions.back().size += sizeof(ObjectRecord);
+    } else {
+      regions.push_back({src, dst, sizeof(ObjectRecord)});
+    }
+  }
+
+  /// Earlier frames may still read the records being replaced, for drawing or culling; this waits for them
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+  vkCmdCopyBuffer(commandBuffer, frameAllocator.buffer(), mBuffer->getBuffer(), static_cast<uint32_t>(regions.size()),
+                  regions.data());
+
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask       = VK_ACCESS_SHADER_READ_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer              = mBuffer->getBuffer();
+  barrier.offset              = 0;
+  barrier.size                = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1,
+                       &barrier, 0, nullptr);
+
+  mLastUploadBytes = mPending.size() * sizeof(ObjectRecord);
+  mPending.clear();
+}
+
+uint32_t VermicelliSceneBuffer::modelId(const std::shared_ptr<VermicelliModel> &model) {
+  auto it = mModelIds.find(model.get());
+  if (it == mModelIds.end() || it->second.mModel.expired()) {
+    /// Either new, or a new model where a destroyed one used to live
+    it = mModelIds.insert_or_assign(model.get(), ModelEntry{model, mNextModelId++}).first;
+  }
+  return it->second.mId;
+}
+
+}
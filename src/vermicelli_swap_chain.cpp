@@ -7,6 +7,7 @@
  *********************************************************************************************************************/
 
 #include "vermicelli_swap_chain.h"
+#include "vermicelli_frame_timeline.h"
 // std
 #include <array>
 #include <cstring>
@@ -16,8 +17,9 @@
 
 namespace vermicelli {
 
-VermicelliSwapChain::VermicelliSwapChain(VermicelliDevice &deviceRef, VkExtent2D windowExtent, const bool verbose)
-        : mDevice{deviceRef}, mWindowExtent{windowExtent}, mVerbose{verbose} {
+VermicelliSwapChain::VermicelliSwapChain(VermicelliDevice &deviceRef, VkExtent2D windowExtent, const bool verbose,
+                                         const bool sampledDepth)
+        : mDevice{deviceRef}, mWindowExtent{windowExtent}, mVerbose{verbose}, mSampledDepth{sampledDepth} {
   init();
 }
 
@@ -31,10 +33,9 @@ void VermicelliSwapChain::init() {
 }
 
 VermicelliSwapChain::VermicelliSwapChain(vermicelli::VermicelliDevice &deviceRef, VkExtent2D windowExtent, bool verbose,
-                                         std::shared_ptr<VermicelliSwapChain> previous) : mDevice{deviceRef},
-                                                                                          mWindowExtent{windowExtent},
-                                                                                          mVerbose{verbose},
-                                                                                          mPreviousSwapChain{previous} {
+                                         bool sampledDepth, std::shared_ptr<VermicelliSwapChain> previous)
+        : mDevice{deviceRef}, mWindowExtent{windowExtent}, mVerbose{verbose}, mSampledDepth{sampledDepth},
+          mPreviousSwapChain{previous} {
   init();
 
   /// Clean up old swap chain since it's no longer needed
@@ -55,7 +56,7 @@ VermicelliSwapChain::~VermicelliSwapChain() {
   for (int i = 0; i < mDepthImages.size(); i++) {
     vkDestroyImageView(mDevice.device(), mDepthImageViews[i], nullptr);
     vkDestroyImage(mDevice.device(), mDepthImages[i], nullptr);
-    vkFreeMemory(mDevice.device(), mDepthImageMemoryVec[i], nullptr);
+    mDevice.allocator().free(mDepthImageMemoryVec[i]);
   }
 
   for (auto framebuffer: mSwapChainFrameBuffers) {
@@ -63,23 +64,16 @@ VermicelliSwapChain::~VermicelliSwapChain() {
   }
 
   vkDestroyRenderPass(mDevice.device(), mRenderPass, nullptr);
+  vkDestroyRenderPass(mDevice.device(), mResumeRenderPass, nullptr);
 
   // cleanup synchronization objects
   for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     vkDestroySemaphore(mDevice.device(), mRenderFinishedSemaphores[i], nullptr);
     vkDestroySemaphore(mDevice.device(), mImageAvailableSemaphores[i], nullptr);
-    vkDestroyFence(mDevice.device(), mInFlightFences[i], nullptr);
   }
 }
 
 VkResult VermicelliSwapChain::acquireNextImage(uint32_t *imageIndex) {
-  vkWaitForFences(
-          mDevice.device(),
-          1,
-          &mInFlightFences[mCurrentFrame],
-          VK_TRUE,
-          std::numeric_limits<uint64_t>::max());
-
   VkResult result = vkAcquireNextImageKHR(
           mDevice.device(),
           mSwapChain,
@@ -92,11 +86,10 @@ VkResult VermicelliSwapChain::acquireNextImage(uint32_t *imageIndex) {
 }
 
 VkResult VermicelliSwapChain::submitCommandBuffers(
-        const VkCommandBuffer *buffers, const uint32_t *imageIndex) {
-  if (mImagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-    vkWaitForFences(mDevice.device(), 1, &mImagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
-  }
-  mImagesInFlight[*imageIndex] = mInFlightFences[mCurrentFrame];
+        const VkCommandBuffer *buffers, const uint32_t *imageIndex, uint64_t frame) {
+  /// The image may come back before the frame that last rendered into it is done, if there are more images than slots
+  mDevice.frameTimeline().wait(mImageFrames[*imageIndex]);
+  mImageFrames[*imageIndex] = frame;
 
   VkSubmitInfo submitInfo = {};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -114,11 +107,7 @@ VkResult VermicelliSwapChain::submitCommandBuffers(
   submitInfo.signalSemaphoreCount = 1;
   submitInfo.pSignalSemaphores    = signalSemaphores;
 
-  vkResetFences(mDevice.device(), 1, &mInFlightFences[mCurrentFrame]);
-  if (vkQueueSubmit(mDevice.graphicsQueue(), 1, &submitInfo, mInFlightFences[mCurrentFrame]) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to submit draw command buffer!");
-  }
+  mDevice.frameTimeline().submit(mDevice.graphicsQueue(), submitInfo, frame);
 
   VkPresentInfoKHR presentInfo = {};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -226,7 +215,7 @@ void VermicelliSwapChain::createRenderPass() {
   depthAttachment.format         = findDepthFormat();
   depthAttachment.samples        = VK_SAMPLE_COUNT_1_BIT;
   depthAttachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  depthAttachment.storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.storeOp        = mSampledDepth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
   depthAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   depthAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -280,6 +269,26 @@ void VermicelliSwapChain::createRenderPass() {
   if (vkCreateRenderPass(mDevice.device(), &renderPassInfo, nullptr, &mRenderPass) != VK_SUCCESS) {
     throw std::runtime_error("failed to create render pass!");
   }
+  if (!mSampledDepth) {
+    return;
+  }
+
+  /// Same attachments, loaded in the layouts the first pass leaves them in; the depth pyramid is built in between
+  attachments[0].loadOp        = VK_ATTACHMENT_LOAD_OP_LOAD;
+  attachments[0].initialLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  attachments[1].loadOp        = VK_ATTACHMENT_LOAD_OP_LOAD;
+  attachments[1].storeOp       = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  dependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependency.dstAccessMask =
+          VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  if (vkCreateRenderPass(mDevice.device(), &renderPassInfo, nullptr, &mResumeRenderPass) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create render pass!");
+  }
 }
 
 void VermicelliSwapChain::createFrameBuffers() {
@@ -328,7 +337,8 @@ void VermicelliSwapChain::createDepthResources() {
     imageInfo.format        = depthFormat;
     imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage         = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    imageInfo.usage         = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                              (mSampledDepth ? VK_IMAGE_USAGE_SAMPLED_BIT : 0);
     imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
     imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
     imageInfo.flags         = 0;
@@ -337,7 +347,8 @@ void VermicelliSwapChain::createDepthResources() {
             imageInfo,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
             mDepthImages[i],
-            mDepthImageMemoryVec[i]);
+            mDepthImageMemoryVec[i],
+            VermicelliMemoryAllocator::Category::ATTACHMENTS);
 
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -359,22 +370,16 @@ void VermicelliSwapChain::createDepthResources() {
 void VermicelliSwapChain::createSyncObjects() {
   mImageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
   mRenderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  mInFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-  mImagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+  mImageFrames.resize(imageCount(), 0);
 
   VkSemaphoreCreateInfo semaphoreInfo = {};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-  VkFenceCreateInfo fenceInfo = {};
-  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-  fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
   for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     if (vkCreateSemaphore(mDevice.device(), &semaphoreInfo, nullptr, &mImageAvailableSemaphores[i]) !=
         VK_SUCCESS ||
         vkCreateSemaphore(mDevice.device(), &semaphoreInfo, nullptr, &mRenderFinishedSemaphores[i]) !=
-        VK_SUCCESS ||
-        vkCreateFence(mDevice.device(), &fenceInfo, nullptr, &mInFlightFences[i]) != VK_SUCCESS) {
+        VK_SUCCESS) {
       throw std::runtime_error("failed to create synchronization objects for a frame!");
     }
   }
@@ -435,7 +440,7 @@ VkFormat VermicelliSwapChain::findDepthFormat() {
   return mDevice.findSupportedFormat(
           {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
           VK_IMAGE_TILING_OPTIMAL,
-          VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+          VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | (mSampledDepth ? VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT : 0));
 }
 
 }  // namespace vermicelli
\ No newline at end of file
@@ -0,0 +1,179 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Two-level segregated fit allocator over an abstract range of bytes
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_tlsf.h"
+
+#include <bit>
+#include <cassert>
+
+namespace vermicelli {
+
+VermicelliTlsf::VermicelliTlsf(uint64_t size) : mSize(size) {
+  for (auto &heads: mHeads) {
+    heads.fill(NO_NODE);
+  }
+  if (size > 0) {
+    insertFree(createNode(0, size, NO_NODE, NO_NODE));
+  }
+}
+
+void VermicelliTlsf::mapping(uint64_t size, uint32_t &firstLevel, uint32_t &secondLevel) {
+  if (size < SMALL_SIZE) {
+    firstLevel  = 0;
+    secondLevel = static_cast<uint32_t>(size / (SMALL_SIZE / SL_COUNT));
+  } else {
+    auto log = static_cast<uint32_t>(std::bit_width(size) - 1);
+    firstLevel  = log - (SMALL_BITS - 1);
+    secondLevel = static_cast<uint32_t>(size >> (log - SL_BITS)) & (SL_COUNT - 1);
+  }
+}
+
+uint32_t VermicelliTlsf::createNode(uint64_t offset, uint64_t size, uint32_t previousPhysical,
+                                    uint32_t nextPhysical) {
+  Node node{offset, size, previousPhysical, nextPhysical, NO_NODE, NO_NODE, false};
+  if (!mUnusedNodes.empty()) {
+    uint32_t index = mUnusedNodes.back();
+    mUnusedNodes.pop_back();
+    mNodes[index] = node;
+    return index;
+  }
+  mNodes.push_back(node);
+  return static_cast<uint32_t>(mNodes.size() - 1);
+}
+
+void VermicelliTlsf::insertFree(uint32_t index) {
+  Node     &node = mNodes[index];
+  uint32_t firstLevel, secondLevel;
+  mapping(node.mSize, firstLevel, secondLevel);
+
+  node.mFree         = true;
+  node.mPreviousFree = NO_NODE;
+  node.mNextFree     = mHeads[firstLevel][secondLevel];
+  if (node.mNextFree != NO_NODE) {
+    mNodes[node.mNextFree].mPreviousFree = index;
+  }
+  mHeads[firstLevel][secondLevel] = index;
+  mFirstLevelMap |= 1ull << firstLevel;
+  mSecondLevelMaps[firstLevel] |= 1u << secondLevel;
+}
+
+void VermicelliTlsf::removeFree(uint32_t index) {
+  Node     &node = mNodes[index];
+  uint32_t firstLevel, secondLevel;
+  mapping(node.mSize, firstLevel, secondLevel);
+
+  if (node.mPreviousFree != NO_NODE) {
+    mNodes[node.mPreviousFree].mNextFree = node.mNextFree;
+  } else {
+    mHeads[firstLevel][secondLevel] = node.mNextFree;
+    if (node.mNextFree == NO_NODE) {
+      mSecondLevelMaps[firstLevel] &= ~(1u << secondLevel);
+      if (mSecondLevelMaps[firstLevel] == 0) {
+        mFirstLevelMap &= ~(1ull << firstLevel);
+      }
+    }
+  }
+  if (node.mNextFree != NO_NODE) {
+    mNodes[node.mNextFree].mPreviousFree = node.mPreviousFree;
+  }
+  node.mFree = false;
+}
+
+uint32_t VermicelliTlsf::findFree(uint64_t size) {
+  /// Round up to the next bucket boundary, so every range in the bucket found is large enough
+  if (size < SMALL_SIZE) {
+    size = (size + SMALL_SIZE / SL_COUNT - 1) & ~(SMALL_SIZE / SL_COUNT - 1);
+  } else {
+    auto log = static_cast<uint32_t>(std::bit_width(size) - 1);
+    size += (1ull << (log - SL_BITS)) - 1;
+  }
+  uint32_t firstLevel, secondLevel;
+  mapping(size, firstLevel, secondLevel);
+  if (firstLevel >= FL_COUNT) {
+    return NO_NODE;
+  }
+
+  uint32_t secondLevelMap = mSecondLevelMaps[firstLevel] & (~0u << secondLevel);
+  if (secondLevelMap == 0) {
+    uint64_t firstLevelMap = firstLevel + 1 < 64 ? mFirstLevelMap & (~0ull << (firstLevel + 1)) : 0;
+    if (firstLevelMap == 0) {
+      return NO_NODE;
+    }
+    firstLevel     = static_cast<uint32_t>(std::countr_zero(firstLevelMap));
+    secondLevelMap = mSecondLevelMaps[firstLevel];
+  }
+  secondLevel = static_cast<uint32_t>(std::countr_zero(secondLevelMap));
+  return mHeads[firstLevel][secondLevel];
+}
+
+uint32_t VermicelliTlsf::allocate(uint64_t size, uint64_t alignment, uint64_t &offset) {
+  assert(size > 0 && std::has_single_bit(alignment) && "Allocation needs a size and a power of two alignment");
+
+  /// Worst case the start has to move alignment - 1 bytes forward
+  uint32_t index = findFree(size + alignment - 1);
+  if (index == NO_NODE) {
+    return NO_NODE;
+  }
+  removeFree(index);
+
+  uint64_t aligned = (mNodes[index].mOffset + alignment - 1) & ~(alignment - 1);
+  if (uint64_t padding = aligned - mNodes[index].mOffset; padding > 0) {
+    uint32_t front = createNode(mNodes[index].mOffset, padding, mNodes[index].mPreviousPhysical, index);
+    if (mNodes[front].mPreviousPhysical != NO_NODE) {
+      mNodes[mNodes[front].mPreviousPhysical].mNextPhysical = front;
+    }
+    mNodes[index].mPreviousPhysical = front;
+    mNodes[index].mOffset           = aligned;
+    mNodes[index].mSize -= padding;
+    insertFree(front);
+  }
+  if (uint64_t remainder = mNodes[index].mSize - size; remainder > 0) {
+    uint32_t back = createNode(aligned + size, remainder, index, mNodes[index].mNextPhysical);
+    if (mNodes[back].mNextPhysical != NO_NODE) {
+      mNodes[mNodes[back].mNextPhysical].mPreviousPhysical = back;
+    }
+    mNodes[index].mNextPhysical = back;
+    mNodes[index].mSize         = size;
+    insertFree(back);
+  }
+
+  mUsed += size;
+  ++mAllocationCount;
+  offset = aligned;
+  return index;
+}
+
+void VermicelliTlsf::free(uint32_t index) {
+  assert(index < mNodes.size() && !mNodes[index].mFree && "Node freed twice");
+  mUsed -= mNodes[index].mSize;
+  --mAllocationCount;
+
+  /// Absorb free neighbours; the merged range keeps this node
+  if (uint32_t previous = mNodes[index].mPreviousPhysical; previous != NO_NODE && mNodes[previous].mFree) {
+    removeFree(previous);
+    mNodes[index].mOffset = mNodes[previous].mOffset;
+    mNodes[index].mSize += mNodes[previous].mSize;
+    mNodes[index].mPreviousPhysical = mNodes[previous].mPreviousPhysical;
+    if (mNodes[index].mPreviousPhysical != NO_NODE) {
+      mNodes[mNodes[index].mPreviousPhysical].mNextPhysical = index;
+    }
+    mUnusedNodes.push_back(previous);
+  }
+  if (uint32_t next = mNodes[index].mNextPhysical; next != NO_NODE && mNodes[next].mFree) {
+    removeFree(next);
+    mNodes[index].mSize += mNodes[next].mSize;
+    mNodes[index].mNextPhysical = mNodes[next].mNextPhysical;
+    if (mNodes[index].mNextPhysical != NO_NODE) {
+      mNodes[mNodes[index].mNextPhysical].mPreviousPhysical = index;
+    }
+    mUnusedNodes.push_back(next);
+  }
+  insertFree(index);
+}
+
+}
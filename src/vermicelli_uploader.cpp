@@ -0,0 +1,326 @@
+/*!********************************************************************************************************************
+ * @author  Ghassan Younes
+ * @email   22338451+ghassanyounes\@users.noreply.github.com
+ * @date    10/16/26
+ * @brief   Copies data into device-local buffers on the transfer queue without stalling the caller or the GPU
+ * Copyright (c) 2026 Ghassan Younes. All rights reserved.
+ *********************************************************************************************************************/
+
+#include "vermicelli_uploader.h"
+#include "vermicelli_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace vermicelli {
+
+VermicelliUploader::VermicelliUploader(VermicelliDevice &device, const bool verbose)
+        : mDevice{device}, mVerbose(verbose), mTimeline{device, device.timelineSemaphores()} {
+  QueueFamilyIndices indices = mDevice.findPhysicalQueueFamilies();
+  mGraphicsFamily = indices.mGraphicsFamily;
+  mTransferFamily = indices.mTransferFamilyHasValue ? indices.mTransferFamily : indices.mGraphicsFamily;
+  mTransferQueue  = mDevice.transferQueue();
+
+  VkCommandPoolCreateInfo poolInfo = {};
+  poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = mTransferFamily;
+  poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  if (vkCreateCommandPool(mDevice.device(), &poolInfo, nullptr, &mTransferPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create transfer command pool!");
+  }
+  if (hasTransferQueue()) {
+    poolInfo.queueFamilyIndex = mGraphicsFamily;
+    if (vkCreateCommandPool(mDevice.device(), &poolInfo, nullptr, &mAcquirePool) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create transfer command pool!");
+    }
+  }
+
+  mRing = std::make_unique<VermicelliBuffer>(
+          mDevice,
+          RING_SIZE,
+          1,
+          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+          VermicelliMemoryAllocator::Category::STAGING
+                                            );
+  mRing->map();
+
+  if (mVerbose) {
+    std::cout << "Uploader: " << (hasTransferQueue() ? "dedicated transfer queue family " : "graphics queue family ")
+              << mTransferFamily << ", " << (RING_SIZE >> 20) << " MiB staging ring, completion on "
+              << (mTimeline.usesTimelineSemaphore() ? "a timeline semaphore" : "fences") << std::endl;
+  }
+}
+
+VermicelliUploader::~VermicelliUploader() {
+  waitIdle();
+  for (auto &batch: mIdleBatches) {
+    destroyBatch(*batch);
+  }
+  vkDestroyCommandPool(mDevice.device(), mTransferPool, nullptr);
+  if (mAcquirePool != VK_NULL_HANDLE) {
+    vkDestroyCommandPool(mDevice.device(), mAcquirePool, nullptr);
+  }
+}
+
+std::unique_ptr<VermicelliUploader::Batch> VermicelliUploader::createBatch() {
+  auto batch = std::make_unique<Batch>();
+
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool        = mTransferPool;
+  allocInfo.commandBufferCount = 1;
+  if (vkAllocateCommandBuffers(mDevice.device(), &allocInfo, &batch->mTransferCommands) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate upload command buffer!");
+  }
+
+  if (hasTransferQueue()) {
+    allocInfo.commandPool = mAcquirePool;
+    if (vkAllocateCommandBuffers(mDevice.device(), &allocInfo, &batch->mAcquireCommands) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    if (vkCreateSemaphore(mDevice.device(), &semaphoreInfo, nullptr, &batch->mReleased) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create upload semaphore!");
+    }
+  }
+  return batch;
+}
+
+void VermicelliUploader::destroyBatch(Batch &batch) {
+  if (batch.mReleased != VK_NULL_HANDLE) {
+    vkDestroySemaphore(mDevice.device(), batch.mReleased, nullptr);
+  }
+}
+
+bool VermicelliUploader::reserveRing(VkDeviceSize size, VkDeviceSize &offset) {
+  if (mRingUsed == 0) {
+    mRingHead = mRingTail = 0;
+  }
+
+  VkDeviceSize skipped = 0;
+  if (mRingUsed == 0 || mRingHead > mRingTail) {
+    /// Free space is [head, end) and [0, tail); an upload never straddles the end of the ring
+    if (RING_SIZE - mRingHead < size) {
+      if (mRingTail < size) {
+        return false;
+      }
+      skipped   = RING_SIZE - mRingHead;
+      mRingHead = 0;
+    }
+  } else if (mRingTail - mRingHead < size) {
+    return false;
+  }
+
+  offset = mRingHead;
+  mRingHead = (mRingHead + size + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1);
+  if (mRingHead > RING_SIZE) {
+    mRingHead = RING_SIZE;
+  }
+  mRingUsed += skipped + (mRingHead - offset);
+  mOpenBatch->mRingBytes += skipped + (mRingHead - offset);
+  mOpenBatch->mRingEnd = mRingHead;
+  return true;
+}
+
+VermicelliUploader::Ticket
+VermicelliUploader::upload(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void *data, VkDeviceSize size) {
+  if (!mOpenBatch) {
+    if (mIdleBatches.empty()) {
+      mOpenBatch = createBatch();
+    } else {
+      mOpenBatch = std::move(mIdleBatches.back());
+      mIdleBatches.pop_back();
+    }
+    mOpenBatch->mSerial    = mNextSerial++;
+    mOpenBatch->mRingBytes = 0;
+    mOpenBatch->mRingEnd   = 0;
+  }
+
+  Copy copy{};
+  copy.mDstBuffer        = dstBuffer;
+  copy.mRegion.dstOffset = dstOffset;
+  copy.mRegion.size      = size;
+  if (size <= RING_SIZE) {
+    VkDeviceSize offset;
+    while (!reserveRing(size, offset)) {
+      /// Everything left in the ring belongs to batches in flight, or to the open one; free the oldest
+      if (mBatches.empty()) {
+        Ticket serial = mOpenBatch->mSerial;
+        submit();
+        wait(serial);
+        return upload(dstBuffer, dstOffset, data, size);
+      }
+      retire(mBatches.front()->mSerial);
+    }
+    std::memcpy(static_cast<uint8_t *>(mRing->getMappedMemory()) + offset, data, size);
+    copy.mSrcBuffer        = mRing->getBuffer();
+    copy.mRegion.srcOffset = offset;
+  } else {
+    auto staging = std::make_unique<VermicelliBuffer>(
+            mDevice,
+            size,
+            1,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            VermicelliMemoryAllocator::Category::STAGING
+                                                     );
+    staging->map();
+    staging->writeToBuffer(const_cast<void *>(data));
+    copy.mSrcBuffer        = staging->getBuffer();
+    copy.mRegion.srcOffset = 0;
+    mOpenBatch->mStaging.push_back(std::move(staging));
+  }
+  mOpenBatch->mCopies.push_back(copy);
+
+  /// Released to the graphics family if the copy ran on another one, otherwise just made visible to it
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask       = hasTransferQueue() ? 0 : VK_ACCESS_MEMORY_READ_BIT;
+  barrier.srcQueueFamilyIndex = hasTransferQueue() ? mTransferFamily : VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = hasTransferQueue() ? mGraphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer              = dstBuffer;
+  barrier.offset              = dstOffset;
+  barrier.size                = size;
+  mOpenBatch->mBarriers.push_back(barrier);
+
+  return mOpenBatch->mSerial;
+}
+
+void VermicelliUploader::submit() {
+  if (!mOpenBatch) {
+    return;
+  }
+  Batch &batch = *mOpenBatch;
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(batch.mTransferCommands, &beginInfo);
+
+  /// One vkCmdCopyBuffer per source and destination pair, however many uploads went into it
+  std::stable_sort(batch.mCopies.begin(), batch.mCopies.end(), [](const Copy &a, const Copy &b) {
+    return a.mSrcBuffer != b.mSrcBuffer ? a.mSrcBuffer < b.mSrcBuffer : a.mDstBuffer < b.mDstBuffer;
+  });
+  std::vector<VkBufferCopy> regions{};
+  uint32_t                  copyCommands = 0;
+  for (size_t first = 0; first < batch.mCopies.size();) {
+    size_t last = first;
+    regions.clear();
+    while (last < batch.mCopies.size() && batch.mCopies[last].mSrcBuffer == batch.mCopies[first].mSrcBuffer &&
+           batch.mCopies[last].mDstBuffer == batch.mCopies[first].mDstBuffer) {
+      regions.push_back(batch.mCopies[last++].mRegion);
+    }
+    vkCmdCopyBuffer(batch.mTransferCommands, batch.mCopies[first].mSrcBuffer, batch.mCopies[first].mDstBuffer,
+                    static_cast<uint32_t>(regions.size()), regions.data());
+    ++copyCommands;
+    first = last;
+  }
+
+  vkCmdPipelineBarrier(batch.mTransferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       hasTransferQueue() ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                       0, 0, nullptr, static_cast<uint32_t>(batch.mBarriers.size()), batch.mBarriers.data(), 0,
+                       nullptr);
+  vkEndCommandBuffer(batch.mTransferCommands);
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers    = &batch.mTransferCommands;
+
+  if (!hasTransferQueue()) {
+    mTimeline.submit(mTransferQueue, submitInfo, batch.mSerial);
+  } else {
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &batch.mReleased;
+    if (vkQueueSubmit(mTransferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+      throw std::runtime_error("failed to submit upload!");
+    }
+
+    /// The matching acquire: same ranges and families, nothing left to make available on this side
+    for (auto &barrier: batch.mBarriers) {
+      barrier.srcAccessMask = 0;
+      barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    }
+    vkBeginCommandBuffer(batch.mAcquireCommands, &beginInfo);
+    vkCmdPipelineBarrier(batch.mAcquireCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+                         static_cast<uint32_t>(batch.mBarriers.size()), batch.mBarriers.data(), 0, nullptr);
+    vkEndCommandBuffer(batch.mAcquireCommands);
+
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    VkSubmitInfo         acquireInfo{};
+    acquireInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    acquireInfo.waitSemaphoreCount = 1;
+    acquireInfo.pWaitSemaphores    = &batch.mReleased;
+    acquireInfo.pWaitDstStageMask  = &waitStage;
+    acquireInfo.commandBufferCount = 1;
+    acquireInfo.pCommandBuffers    = &batch.mAcquireCommands;
+    mTimeline.submit(mDevice.graphicsQueue(), acquireInfo, batch.mSerial);
+  }
+
+  if (mVerbose) {
+    std::cout << "Uploader: submitted batch " << batch.mSerial << " with " << batch.mCopies.size() << " uploads in "
+              << copyCommands << " copy commands, " << batch.mRingBytes << " ring bytes" << std::endl;
+  }
+  mBatches.push_back(std::move(mOpenBatch));
+}
+
+void VermicelliUploader::retire(Ticket block) {
+  size_t retired = 0;
+  for (; retired < mBatches.size(); ++retired) {
+    Batch &batch = *mBatches[retired];
+    if (batch.mSerial <= block) {
+      mTimeline.wait(batch.mSerial);
+    } else if (!mTimeline.isComplete(batch.mSerial)) {
+      break;
+    }
+    mCompletedSerial = batch.mSerial;
+    /// Batches retire in order, so the ring space they held is exactly what follows the tail; one that staged
+    /// everything in dedicated buffers held none, and its mRingEnd means nothing
+    if (batch.mRingBytes != 0) {
+      mRingUsed -= batch.mRingBytes;
+      mRingTail = batch.mRingEnd;
+    }
+    batch.mRingBytes = 0;
+    batch.mRingEnd   = 0;
+    batch.mCopies.clear();
+    batch.mStaging.clear();
+    batch.mBarriers.clear();
+    mIdleBatches.push_back(std::move(mBatches[retired]));
+  }
+  mBatches.erase(mBatches.begin(), mBatches.begin() + static_cast<std::ptrdiff_t>(retired));
+}
+
+bool VermicelliUploader::isComplete(Ticket ticket) {
+  if (ticket <= mCompletedSerial) {
+    return true;
+  }
+  if (mOpenBatch && ticket >= mOpenBatch->mSerial) {
+    submit();
+  }
+  retire(0);
+  return ticket <= mCompletedSerial;
+}
+
+void VermicelliUploader::wait(Ticket ticket) {
+  if (ticket <= mCompletedSerial) {
+    return;
+  }
+  if (mOpenBatch && ticket >= mOpenBatch->mSerial) {
+    submit();
+  }
+  retire(ticket);
+}
+
+void VermicelliUploader::waitIdle() {
+  submit();
+  retire(mNextSerial);
+}
+
+}